@@ -217,6 +217,41 @@ int32_t db_upperbound_i64(account_name code, account_name scope, table_name tabl
   */
 int32_t db_end_i64(account_name code, account_name scope, table_name table);
 
+/**
+  *
+  *  Copy a number of rows of a primary 64-bit integer index table in a single call
+  *
+  *  @brief Copy a number of rows of a primary 64-bit integer index table in a single call
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The table name
+  *  @param primaries - The primary keys of the rows to copy
+  *  @param count - Number of primary keys
+  *  @param buffer - The buffer the rows are copied to, one after the other
+  *  @param buffer_size - Size of the buffer
+  *  @param offsets - Receives the offset of each row into the buffer, row i spans [offsets[i], offsets[i+1])
+  *  @param offsets_len - Number of entries in offsets, at least count + 1
+  *  @post A row that doesn't exist gets an empty span, a row that doesn't fit in the buffer is not copied
+  *  @return the size the buffer needs to hold all the rows
+  */
+int32_t db_get_i64_many(account_name code, account_name scope, table_name table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len);
+
+/**
+  *
+  *  Walk the primary keys of a primary 64-bit integer index table within [lower, upper] in a single call
+  *
+  *  @brief Walk a range of a primary 64-bit integer index table in a single call
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The table name
+  *  @param lower - The smallest primary key to return
+  *  @param upper - The largest primary key to return
+  *  @param primaries - Receives the primary keys, in index order
+  *  @param primaries_len - Number of entries in primaries
+  *  @return number of primary keys written, at most primaries_len
+  */
+int32_t db_i64_range(account_name code, account_name scope, table_name table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len);
+
 //for ipc & rpc
 void db_remove_i64_ex( uint64_t scope, uint64_t payer, uint64_t table, uint64_t id );
 void db_update_i64_ex( uint64_t scope, uint64_t payer, uint64_t table, uint64_t id, const char* buffer, size_t buffer_size );
@@ -362,6 +397,24 @@ int32_t db_idx64_upperbound(account_name code, account_name scope, table_name ta
   */
 int32_t db_idx64_end(account_name code, account_name scope, table_name table);
 
+/**
+  *
+  *  Walk the table rows of a secondary 64-bit integer index table whose secondary key is within [lower, upper] in a single call
+  *
+  *  @brief Walk a range of a secondary 64-bit integer index table in a single call
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The table name
+  *  @param lower - The smallest secondary key to return
+  *  @param upper - The largest secondary key to return
+  *  @param secondaries - Receives the secondary keys, in index order, may be null if secondaries_len is 0
+  *  @param secondaries_len - Number of entries in secondaries
+  *  @param primaries - Receives the primary keys, parallel to secondaries, may be null if primaries_len is 0
+  *  @param primaries_len - Number of entries in primaries
+  *  @return number of table rows written, at most the smaller of the lengths that aren't 0
+  */
+int32_t db_idx64_range(account_name code, account_name scope, table_name table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len);
+
 
 
 /**
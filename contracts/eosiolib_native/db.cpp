@@ -69,6 +69,14 @@ int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
    return get_vm_api()->db_end_i64(code, scope, table);
 }
 
+int32_t db_get_i64_many(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len) {
+   return get_vm_api()->db_get_i64_many(code, scope, table, primaries, count, buffer, buffer_size, offsets, offsets_len);
+}
+
+int32_t db_i64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len) {
+   return get_vm_api()->db_i64_range(code, scope, table, lower, upper, primaries, primaries_len);
+}
+
 int32_t db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const uint64_t* secondary) {
    return get_vm_api()->db_idx64_store(scope, table, payer, id, secondary);
 }
@@ -109,6 +117,10 @@ int32_t db_idx64_end(uint64_t code, uint64_t scope, uint64_t table) {
    return get_vm_api()->db_idx64_end(code, scope, table);
 }
 
+int32_t db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len) {
+   return get_vm_api()->db_idx64_range(code, scope, table, lower, upper, secondaries, secondaries_len, primaries, primaries_len);
+}
+
 int32_t db_idx128_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const uint128_t* secondary) {
    return get_vm_api()->db_idx128_store(scope, table, payer, id, secondary);
 }
@@ -280,7 +280,12 @@ struct vm_api {
    int (*vm_apply)(int type, uint64_t receiver, uint64_t account, uint64_t act);
 
    int (*is_contracts_console_enabled)();
-   char reserved[sizeof(char*)*128]; //for forward compatibility
+
+   //batched reads, one call per range instead of one per row
+   int32_t (*db_idx64_range)(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len);
+   int32_t (*db_get_i64_many)(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len);
+   int32_t (*db_i64_range)(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len);
+   char reserved[sizeof(char*)*(128-3)]; //for forward compatibility, shrunk by the three batched reads above
 };
 
 int32_t uint64_to_string(uint64_t n, char* out, int size);
@@ -296,6 +301,7 @@ typedef void (*fn_vm_init)(struct vm_api* api);
 typedef void (*fn_vm_deinit)(void);
 typedef int (*fn_preload)(uint64_t account);
 typedef int (*fn_unload)(uint64_t account);
+typedef int (*fn_load_code)(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size);
 
 
 void vm_init(struct vm_api* api);
@@ -308,6 +314,7 @@ int vm_apply(uint64_t receiver, uint64_t account, uint64_t act);
 int vm_call(uint64_t account, uint64_t func);
 
 int vm_preload(uint64_t account);
+int vm_load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size);
 
 int vm_load(uint64_t account);
 int vm_unload(uint64_t account);
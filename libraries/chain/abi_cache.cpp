@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/abi_cache.hpp>
+#include <eosio/chain/account_object.hpp>
+
+#include <string.h>
+
+namespace eosio { namespace chain {
+
+abi_cache& abi_cache::instance() {
+   static abi_cache cache;
+   return cache;
+}
+
+cached_abi_ptr abi_cache::get( const chainbase::database& db, account_name account, const fc::microseconds& max_serialization_time ) {
+   const auto* accnt = db.find<account_object, by_name>( account );
+   if( accnt == nullptr || abi_serializer::is_empty_abi( accnt->abi ) ) {
+      return cached_abi_ptr();
+   }
+   const auto& seq = db.get<account_sequence_object, by_name>( account );
+
+   {
+      std::lock_guard<std::mutex> g( _mtx );
+      auto itr = _entries.find( account );
+      if( itr != _entries.end() ) {
+         const auto& e = *itr->second;
+         if( e.abi_sequence == seq.abi_sequence && e.packed.size() == accnt->abi.size() &&
+             memcmp( e.packed.data(), accnt->abi.data(), e.packed.size() ) == 0 ) {
+            return itr->second;
+         }
+      }
+   }
+
+   // parse outside of the lock, two threads missing on the same account both parse and the last one wins
+   auto e = std::make_shared<cached_abi>();
+   e->abi_sequence = seq.abi_sequence;
+   e->packed.assign( accnt->abi.data(), accnt->abi.data() + accnt->abi.size() );
+   abi_serializer::to_abi( e->packed, e->abi );
+   e->serializer.set_abi( e->abi, max_serialization_time );
+   for( const auto& t : e->abi.tables ) {
+      e->table_index_types[t.name] = t.index_type;
+   }
+
+   std::lock_guard<std::mutex> g( _mtx );
+   if( _entries.size() >= _max_size && _entries.find( account ) == _entries.end() ) {
+      // an arbitrary entry, the first one would always be the same few system accounts
+      _entries.erase( _entries.begin() + (account.value % _entries.size()) );
+   }
+   _entries[account] = e;
+   return e;
+}
+
+std::shared_ptr<const abi_serializer> abi_cache::get_serializer( const chainbase::database& db, account_name account,
+                                                                 const fc::microseconds& max_serialization_time ) {
+   auto e = get( db, account, max_serialization_time );
+   if( !e ) {
+      return std::shared_ptr<const abi_serializer>();
+   }
+   return std::shared_ptr<const abi_serializer>( e, &e->serializer );
+}
+
+void abi_cache::erase( account_name account ) {
+   std::lock_guard<std::mutex> g( _mtx );
+   _entries.erase( account );
+}
+
+void abi_cache::clear() {
+   std::lock_guard<std::mutex> g( _mtx );
+   _entries.clear();
+}
+
+void abi_cache::set_max_size( size_t accounts ) {
+   std::lock_guard<std::mutex> g( _mtx );
+   _max_size = std::max<size_t>( accounts, 1 );
+   while( _entries.size() > _max_size ) {
+      _entries.erase( _entries.begin() );
+   }
+}
+
+size_t abi_cache::size() {
+   std::lock_guard<std::mutex> g( _mtx );
+   return _entries.size();
+}
+
+} } /// namespace eosio::chain
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 #include <eosio/chain/apply_context.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction_context.hpp>
@@ -64,15 +65,33 @@ void apply_context::exec_one( action_trace& trace )
    current_context = this;
    auto start = fc::time_point::now();
 
+   if( trx_context.footprint ) {
+      trx_context.footprint->add_account( receiver );
+      for( const auto& auth : act.authorization ) {
+         trx_context.footprint->add_account( auth.actor );
+      }
+   }
+
+   // act is the same for every receiver notified from this context, hash it once
+   if( !_act_digest_valid ) {
+      _act_digest = digest_type::hash(act);
+      _act_digest_valid = true;
+   }
+
    action_receipt r;
    r.receiver         = receiver;
-   r.act_digest       = digest_type::hash(act);
+   r.act_digest       = _act_digest;
 
    trace.trx_id = trx_context.id;
    trace.block_num = control.pending_block_state()->block_num;
    trace.block_time = control.pending_block_time();
    trace.producer_block_id = control.pending_producer_block_id();
-   trace.act = act;
+   if( control.get_trace_verbosity() == trace_verbosity::FULL ) {
+      trace.act = act;
+   } else {
+      trace.act.account = act.account;
+      trace.act.name = act.name;
+   }
    trace.context_free = context_free;
 
    const auto& cfg = control.get_global_properties().configuration;
@@ -86,6 +105,7 @@ void apply_context::exec_one( action_trace& trace )
                control.check_contract_list( receiver );
                control.check_action_list( act.account, act.name );
             }
+            if( trx_context.footprint ) trx_context.footprint->exclusive = true;
             (*native)( *this );
          }
 
@@ -135,8 +155,12 @@ void apply_context::finalize_trace( action_trace& trace, const fc::time_point& s
    trace.account_ram_deltas = std::move( _account_ram_deltas );
    _account_ram_deltas.clear();
 
-   trace.console = _pending_console_output.str();
-   reset_console();
+   if( _pending_console_output.tellp() != 0 ) {
+      if( control.contracts_console() || control.get_trace_verbosity() == trace_verbosity::FULL ) {
+         trace.console = _pending_console_output.str();
+      }
+      reset_console();
+   }
 
    trace.elapsed = fc::time_point::now() - start;
 }
@@ -277,6 +301,7 @@ void apply_context::execute_context_free_inline( action&& a ) {
 
 
 void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, account_name payer, transaction&& trx, bool replace_existing ) {
+   if( trx_context.footprint ) trx_context.footprint->exclusive = true;
    EOS_ASSERT( trx.context_free_actions.size() == 0, cfa_inside_generated_tx, "context free actions are not currently allowed in generated transactions" );
    trx.expiration = control.pending_block_time() + fc::microseconds(999'999); // Rounds up to nearest second (makes expiration check unnecessary)
    trx.set_reference_block(control.head_block_id()); // No TaPoS check necessary
@@ -357,6 +382,7 @@ void apply_context::schedule_deferred_transaction( const uint128_t& sender_id, a
 }
 
 bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, account_name sender ) {
+   if( trx_context.footprint ) trx_context.footprint->exclusive = true;
    auto& generated_transaction_idx = db.get_mutable_index<generated_transaction_multi_index>();
    const auto* gto = db.find<generated_transaction_object,by_sender_id>(boost::make_tuple(sender, sender_id));
    if ( gto ) {
@@ -366,27 +392,64 @@ bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, acc
    return gto;
 }
 
+const table_id_object* apply_context::find_table_memo( name code, name scope, name table )const {
+   for( const auto* tid : _table_memo ) {
+      if( tid && tid->code == code && tid->scope == scope && tid->table == table ) {
+         return tid;
+      }
+   }
+   return nullptr;
+}
+
+void apply_context::add_table_memo( const table_id_object& tid ) {
+   _table_memo[_table_memo_next] = &tid;
+   _table_memo_next = (_table_memo_next + 1) % table_memo_size;
+}
+
 const table_id_object* apply_context::find_table( name code, name scope, name table ) {
-   return db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   // a memoised table has already been recorded in the footprint, as a read or as a write
+   if( const auto* tid = find_table_memo( code, scope, table ) ) {
+      return tid;
+   }
+   if( trx_context.footprint ) trx_context.footprint->record_read( code, scope, table );
+   const auto* tid = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   if( tid ) {
+      add_table_memo( *tid );
+   }
+   return tid;
 }
 
 const table_id_object& apply_context::find_or_create_table( name code, name scope, name table, const account_name &payer ) {
+   if( trx_context.footprint ) trx_context.footprint->record_write( code, scope, table );
+   if( const auto* tid = find_table_memo( code, scope, table ) ) {
+      return *tid;
+   }
    const auto* existing_tid =  db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
    if (existing_tid != nullptr) {
+      add_table_memo( *existing_tid );
       return *existing_tid;
    }
 
    update_db_usage(payer, config::billable_size_v<table_id_object>);
 
-   return db.create<table_id_object>([&](table_id_object &t_id){
+   const auto& tid = db.create<table_id_object>([&](table_id_object &t_id){
       t_id.code = code;
       t_id.scope = scope;
       t_id.table = table;
       t_id.payer = payer;
    });
+   add_table_memo( tid );
+   return tid;
+}
+
+void apply_context::record_write( const table_id_object& tid ) {
+   if( trx_context.footprint ) trx_context.footprint->record_write( tid.code, tid.scope, tid.table );
 }
 
 void apply_context::remove_table( const table_id_object& tid ) {
+   for( auto& memo : _table_memo ) {
+      if( memo == &tid ) memo = nullptr;
+   }
    update_db_usage(tid.payer, - config::billable_size_v<table_id_object>);
    db.remove(tid);
 }
@@ -512,6 +575,7 @@ void apply_context::db_update_i64( int iterator, account_name payer, const char*
    }
 
 //   require_write_lock( table_obj.scope );
+   record_write( table_obj );
 
    const int64_t overhead = config::billable_size_v<key_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
@@ -545,6 +609,7 @@ void apply_context::db_remove_i64( int iterator, bool check_code ) {
    }
 
 //   require_write_lock( table_obj.scope );
+   record_write( table_obj );
 
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key_value_object>) );
 
@@ -688,6 +753,46 @@ int apply_context::db_end_i64( uint64_t code, uint64_t scope, uint64_t table ) {
    return keyval_cache.cache_table( *tab );
 }
 
+int apply_context::db_get_i64_many( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count,
+                                    char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len ) {
+   EOS_ASSERT( offsets_len > count, db_api_exception, "offsets must have one more entry than primaries" );
+
+   const auto* tab = find_table( code, scope, table );
+
+   size_t total = 0;
+   offsets[0] = 0;
+   for( size_t i = 0; i < count; i++ ) {
+      const key_value_object* obj = tab ? db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, primaries[i] ) ) : nullptr;
+      if( obj ) {
+         auto s = obj->value.size();
+         // the total is returned as int32_t and stored in uint32_t offsets
+         EOS_ASSERT( total + s <= size_t(std::numeric_limits<int32_t>::max()), db_api_exception,
+                     "rows total more than ${max} bytes", ("max", std::numeric_limits<int32_t>::max()) );
+         if( total + s <= buffer_size ) {
+            memcpy( buffer + total, obj->value.data(), s );
+         }
+         total += s;
+      }
+      offsets[i+1] = total;
+   }
+   return total;
+}
+
+int apply_context::db_i64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len ) {
+   const auto* tab = find_table( code, scope, table );
+   if( !tab ) return 0;
+
+   const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+   auto itr = idx.lower_bound( boost::make_tuple( tab->id, lower ) );
+
+   size_t limit = std::min( primaries_len, size_t(std::numeric_limits<int32_t>::max()) );
+   size_t count = 0;
+   for( ; count < limit && itr != idx.end() && itr->t_id == tab->id && itr->primary_key <= upper; ++itr, ++count ) {
+      primaries[count] = itr->primary_key;
+   }
+   return count;
+}
+
 
 int apply_context::db_store_i256( uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size ) {
    return db_store_i256( get_receiver(), scope, table, payer, id, buffer, buffer_size);
@@ -728,6 +833,7 @@ void apply_context::db_update_i256( int iterator, account_name payer, const char
    }
 
 //   require_write_lock( table_obj.scope );
+   record_write( table_obj );
 
    const int64_t overhead = config::billable_size_v<key256_value_object>;
    int64_t old_size = (int64_t)(obj.value.size() + overhead);
@@ -761,6 +867,7 @@ void apply_context::db_remove_i256( int iterator, bool check_code ) {
    }
 
 //   require_write_lock( table_obj.scope );
+   record_write( table_obj );
 
    update_db_usage( obj.payer,  -(obj.value.size() + config::billable_size_v<key256_value_object>) );
 
@@ -876,6 +983,7 @@ int apply_context::get_table_item_count(name code, name scope, name table) {
 }
 
 void apply_context::add_ram_usage( account_name account, int64_t ram_delta ) {
+   if( trx_context.footprint ) trx_context.footprint->add_account( account );
    trx_context.add_ram_usage( account, ram_delta );
 
    auto p = _account_ram_deltas.emplace( account, ram_delta );
@@ -1,5 +1,6 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/transaction_context.hpp>
+#include <eosio/chain/parallel_schedule.hpp>
 
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/fork_database.hpp>
@@ -115,6 +116,8 @@ struct pending_state {
 
    optional<block_id_type>            _producer_block_id;
 
+   parallel_schedule                  _parallel_schedule; ///< footprints of the transactions applied so far
+
    void push() {
       _db_session.push();
    }
@@ -140,6 +143,8 @@ struct controller_impl {
    optional<fc::microseconds>     subjective_cpu_leeway;
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
+   parallel_stats                 parallel; ///< how the committed blocks could have been executed in parallel
+   bool                           record_footprints = false;
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
@@ -706,6 +711,10 @@ struct controller_impl {
          }
 
          emit( self.accepted_block, pending->_pending_block_state );
+
+         if( conf.record_parallel_stats ) {
+            parallel.add( pending->_parallel_schedule );
+         }
       } catch (...) {
          // dont bother resetting pending, instead abort the block
          reset_pending_on_exit.cancel();
@@ -886,9 +895,15 @@ struct controller_impl {
 
          fc::move_append( pending->_actions, move(trx_context.executed) );
 
+         trace->footprint = trx_context.footprint;
+
          emit( self.accepted_transaction, trx );
          emit( self.applied_transaction, trace );
 
+         if( conf.record_parallel_stats ) {
+            pending->_parallel_schedule.add( trx_context.footprint, trace->elapsed.count() );
+         }
+
          trx_context.squash();
          undo_session.squash();
 
@@ -1054,6 +1069,10 @@ struct controller_impl {
 
             fc::move_append(pending->_actions, move(trx_context.executed));
 
+            trace->footprint = trx_context.footprint;
+            trx->footprint = trx_context.footprint;
+            trx->elapsed = trace->elapsed;
+
             // call the accept signal but only once for this transaction
             if (!trx->accepted) {
                trx->accepted = true;
@@ -1068,6 +1087,9 @@ struct controller_impl {
                trx_context.undo();
             } else {
                restore.cancel();
+               if( conf.record_parallel_stats ) {
+                  pending->_parallel_schedule.add( trx_context.footprint, trace->elapsed.count() );
+               }
                trx_context.squash();
             }
 
@@ -1967,6 +1989,14 @@ db_read_mode controller::get_read_mode()const {
    return my->read_mode;
 }
 
+void controller::set_trace_verbosity( trace_verbosity v ) {
+   my->conf.trace_level = v;
+}
+
+trace_verbosity controller::get_trace_verbosity()const {
+   return my->conf.trace_level;
+}
+
 validation_mode controller::get_validation_mode()const {
    return my->conf.block_validation_mode;
 }
@@ -2122,6 +2152,22 @@ void controller::set_subjective_cpu_leeway(fc::microseconds leeway) {
    my->subjective_cpu_leeway = leeway;
 }
 
+const parallel_stats& controller::get_parallel_stats()const {
+   return my->parallel;
+}
+
+void controller::reset_parallel_stats() {
+   my->parallel = parallel_stats();
+}
+
+void controller::set_record_footprints( bool record ) {
+   my->record_footprints = record;
+}
+
+bool controller::records_footprints()const {
+   return my->record_footprints || my->conf.record_parallel_stats;
+}
+
 void controller::add_resource_greylist(const account_name &name) {
    my->conf.resource_greylist.insert(name);
 }
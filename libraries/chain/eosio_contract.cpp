@@ -20,6 +20,7 @@
 
 #include <eosio/chain/wasm_interface.hpp>
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/abi_cache.hpp>
 
 #include <eosio/chain/authorization_manager.hpp>
 #include <eosio/chain/resource_limits.hpp>
@@ -272,6 +273,7 @@ void apply_eosio_setabi(apply_context& context) {
    db.modify( account_sequence, [&]( auto& aso ) {
       aso.abi_sequence += 1;
    });
+   abi_cache::instance().erase( act.account );
 
    if (new_size != old_size) {
       context.add_ram_usage( act.account, new_size - old_size );
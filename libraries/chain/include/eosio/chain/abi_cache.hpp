@@ -0,0 +1,68 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/abi_serializer.hpp>
+#include <chainbase/chainbase.hpp>
+
+#include <memory>
+#include <mutex>
+
+namespace eosio { namespace chain {
+
+   /**
+    *  The abi of an account, parsed once and shared by everyone reading it
+    */
+   struct cached_abi {
+      uint64_t                   abi_sequence = 0;
+      bytes                      packed;      ///< the abi as stored on the account
+      abi_def                    abi;
+      abi_serializer             serializer;
+      flat_map<name, type_name>  table_index_types;
+
+      optional<type_name> get_table_index_type( name table )const {
+         auto itr = table_index_types.find( table );
+         if( itr == table_index_types.end() ) {
+            return optional<type_name>();
+         }
+         return itr->second;
+      }
+   };
+
+   using cached_abi_ptr = std::shared_ptr<const cached_abi>;
+
+   /**
+    *  Process wide cache of parsed abis, keyed by account and abi_sequence.
+    *
+    *  An entry is handed out only if its abi_sequence and bytes still match the ones of the account, a block
+    *  applied on another fork can reuse an abi_sequence for a different abi. It can be used from any thread.
+    */
+   class abi_cache {
+      public:
+         static abi_cache& instance();
+
+         /**
+          *  @return the abi of account, null if the account doesn't exist or has no abi
+          */
+         cached_abi_ptr get( const chainbase::database& db, account_name account, const fc::microseconds& max_serialization_time );
+
+         /**
+          *  @return the serializer of the abi of account, null if the account doesn't exist or has no abi
+          */
+         std::shared_ptr<const abi_serializer> get_serializer( const chainbase::database& db, account_name account,
+                                                              const fc::microseconds& max_serialization_time );
+
+         void erase( account_name account );
+         void clear();
+
+         void   set_max_size( size_t accounts );
+         size_t size();
+
+      private:
+         std::mutex                              _mtx;
+         flat_map<account_name, cached_abi_ptr>  _entries;
+         size_t                                  _max_size = 1024;
+   };
+
+} } /// namespace eosio::chain
@@ -9,6 +9,8 @@
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
+#include <array>
+#include <memory>
 #include <set>
 
 namespace chainbase { class database; }
@@ -20,50 +22,133 @@ class transaction_context;
 
 class apply_context {
    private:
+      /**
+       *  Open addressing hash map from a 64 bit key to a non negative int, with linear probing and backward shift
+       *  deletion. clear() keeps the slots so a cache that is reused doesn't allocate again.
+       */
+      class flat_index {
+         public:
+            int find( uint64_t key )const {
+               if( _size == 0 ) return -1;
+               for( size_t i = home( key ); ; i = (i + 1) & _mask ) {
+                  const auto& s = _slots[i];
+                  if( s.value < 0 ) return -1;
+                  if( s.key == key ) return s.value;
+               }
+            }
+
+            /// Precondition: key is not in the map
+            void insert( uint64_t key, int value ) {
+               if( (_size + 1) * 4 > _slots.size() * 3 ) grow();
+               place( key, value );
+               ++_size;
+            }
+
+            void erase( uint64_t key ) {
+               if( _size == 0 ) return;
+               size_t i = home( key );
+               for( ; ; i = (i + 1) & _mask ) {
+                  if( _slots[i].value < 0 ) return;
+                  if( _slots[i].key == key ) break;
+               }
+               for( size_t j = (i + 1) & _mask; _slots[j].value >= 0; j = (j + 1) & _mask ) {
+                  size_t h = home( _slots[j].key );
+                  // move the entry back unless its home slot lies cyclically in (i, j]
+                  if( (i < j) ? (h <= i || h > j) : (h <= i && h > j) ) {
+                     _slots[i] = _slots[j];
+                     i = j;
+                  }
+               }
+               _slots[i].value = -1;
+               --_size;
+            }
+
+            void clear() {
+               if( _size == 0 ) return;
+               for( auto& s : _slots ) s.value = -1;
+               _size = 0;
+            }
+
+            size_t capacity()const { return _slots.size(); }
+
+         private:
+            struct slot {
+               uint64_t key   = 0;
+               int      value = -1;
+            };
+
+            size_t home( uint64_t key )const {
+               return (key * 0x9E3779B97F4A7C15ULL) >> _shift;
+            }
+
+            void place( uint64_t key, int value ) {
+               size_t i = home( key );
+               while( _slots[i].value >= 0 ) i = (i + 1) & _mask;
+               _slots[i].key   = key;
+               _slots[i].value = value;
+            }
+
+            void grow() {
+               vector<slot> old( _slots.empty() ? 16 : _slots.size() * 2 );
+               old.swap( _slots );
+               _mask  = _slots.size() - 1;
+               _shift = 64 - __builtin_ctzll( _slots.size() );
+               for( const auto& s : old ) {
+                  if( s.value >= 0 ) place( s.key, s.value );
+               }
+            }
+
+            vector<slot> _slots;
+            size_t       _size  = 0;
+            size_t       _mask  = 0;
+            uint32_t     _shift = 64;
+      };
+
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
-               _end_iterator_to_table.reserve(8);
-               _iterator_to_object.reserve(32);
-            }
+            iterator_cache() : _s( acquire() ) {}
+            ~iterator_cache() { release( std::move(_s) ); }
+
+            iterator_cache( const iterator_cache& ) = delete;
+            iterator_cache& operator=( const iterator_cache& ) = delete;
 
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
-               auto itr = _table_cache.find(tobj.id);
-               if( itr != _table_cache.end() )
-                  return itr->second.second;
-
-               auto ei = index_to_end_iterator(_end_iterator_to_table.size());
-               _end_iterator_to_table.push_back( &tobj );
-               _table_cache.emplace( tobj.id, make_pair(&tobj, ei) );
-               return ei;
+               auto indx = _s->table_to_index.find( tobj.id._id );
+               if( indx >= 0 )
+                  return index_to_end_iterator(indx);
+
+               indx = _s->end_iterator_to_table.size();
+               _s->end_iterator_to_table.push_back( &tobj );
+               _s->table_to_index.insert( tobj.id._id, indx );
+               return index_to_end_iterator(indx);
             }
 
             const table_id_object& get_table( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return *itr->second.first;
+               auto indx = _s->table_to_index.find( i._id );
+               EOS_ASSERT( indx >= 0, table_not_in_cache, "an invariant was broken, table should be in cache" );
+               return *_s->end_iterator_to_table[indx];
             }
 
             int get_end_iterator_by_table_id( table_id_object::id_type i )const {
-               auto itr = _table_cache.find(i);
-               EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-               return itr->second.second;
+               auto indx = _s->table_to_index.find( i._id );
+               EOS_ASSERT( indx >= 0, table_not_in_cache, "an invariant was broken, table should be in cache" );
+               return index_to_end_iterator(indx);
             }
 
             const table_id_object* find_table_by_end_iterator( int ei )const {
                EOS_ASSERT( ei < -1, invalid_table_iterator, "not an end iterator" );
                auto indx = end_iterator_to_index(ei);
-               if( indx >= _end_iterator_to_table.size() ) return nullptr;
-               return _end_iterator_to_table[indx];
+               if( indx >= _s->end_iterator_to_table.size() ) return nullptr;
+               return _s->end_iterator_to_table[indx];
             }
 
             const T& get( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "dereference of end iterator" );
-               EOS_ASSERT( iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
-               auto result = _iterator_to_object[iterator];
+               EOS_ASSERT( iterator < _s->iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               auto result = _s->iterator_to_object[iterator];
                EOS_ASSERT( result, table_operation_not_permitted, "dereference of deleted object" );
                return *result;
             }
@@ -71,34 +156,75 @@ class apply_context {
             void remove( int iterator ) {
                EOS_ASSERT( iterator != -1, invalid_table_iterator, "invalid iterator" );
                EOS_ASSERT( iterator >= 0, table_operation_not_permitted, "cannot call remove on end iterators" );
-               EOS_ASSERT( iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
-               auto obj_ptr = _iterator_to_object[iterator];
+               EOS_ASSERT( iterator < _s->iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
+               auto obj_ptr = _s->iterator_to_object[iterator];
                if( !obj_ptr ) return;
-               _iterator_to_object[iterator] = nullptr;
-               _object_to_iterator.erase( obj_ptr );
+               _s->iterator_to_object[iterator] = nullptr;
+               _s->object_to_iterator.erase( key_of(obj_ptr) );
             }
 
             int add( const T& obj ) {
-               auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               auto itr = _s->object_to_iterator.find( key_of(&obj) );
+               if( itr >= 0 )
+                    return itr;
 
-               _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+               _s->iterator_to_object.push_back( &obj );
+               _s->object_to_iterator.insert( key_of(&obj), _s->iterator_to_object.size() - 1 );
 
-               return _iterator_to_object.size() - 1;
+               return _s->iterator_to_object.size() - 1;
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            /// The containers of a cache, handed from one action to the next on the same thread
+            struct storage {
+               vector<const table_id_object*>  end_iterator_to_table;
+               flat_index                      table_to_index; ///< table id -> index into end_iterator_to_table
+               vector<const T*>                iterator_to_object;
+               flat_index                      object_to_iterator;
+
+               void clear() {
+                  end_iterator_to_table.clear();
+                  table_to_index.clear();
+                  iterator_to_object.clear();
+                  object_to_iterator.clear();
+               }
+            };
+
+            /// storage that grew past this is freed instead of being reused
+            static constexpr size_t max_pooled_iterators = 4096;
+
+            static vector<std::unique_ptr<storage>>& pool() {
+               static thread_local vector<std::unique_ptr<storage>> p;
+               return p;
+            }
+
+            static std::unique_ptr<storage> acquire() {
+               auto& p = pool();
+               if( p.empty() ) {
+                  auto s = std::make_unique<storage>();
+                  s->end_iterator_to_table.reserve(8);
+                  s->iterator_to_object.reserve(32);
+                  return s;
+               }
+               auto s = std::move( p.back() );
+               p.pop_back();
+               return s;
+            }
+
+            static void release( std::unique_ptr<storage> s ) {
+               if( !s || s->object_to_iterator.capacity() > max_pooled_iterators * 2 ) return;
+               s->clear();
+               pool().push_back( std::move(s) );
+            }
+
+            static uint64_t key_of( const T* obj ) { return reinterpret_cast<uintptr_t>(obj); }
+
+            std::unique_ptr<storage> _s;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
             inline size_t end_iterator_to_index( int ei )const { return (-ei - 2); }
-            /// Precondition: indx < _end_iterator_to_table.size() <= std::numeric_limits<int>::max()
+            /// Precondition: indx < end_iterator_to_table.size() <= std::numeric_limits<int>::max()
             inline int index_to_end_iterator( size_t indx )const { return -(indx + 2); }
       }; /// class iterator_cache
 
@@ -210,6 +336,7 @@ class apply_context {
                EOS_ASSERT( table_obj.code == context.get_receiver(), table_access_violation, "db access violation" );
 
 //               context.require_write_lock( table_obj.scope );
+               context.record_write( table_obj );
 
                context.db.modify( table_obj, [&]( auto& t ) {
                   --t.count;
@@ -230,6 +357,7 @@ class apply_context {
                EOS_ASSERT( table_obj.code == context.get_receiver(), table_access_violation, "db access violation" );
 
 //               context.require_write_lock( table_obj.scope );
+               context.record_write( table_obj );
 
                if( payer == account_name() ) payer = obj.payer;
 
@@ -443,6 +571,26 @@ class apply_context {
                secondary_key_helper_t::get(secondary, obj.secondary_key);
             }
 
+            /**
+             *  Copies the entries with lower <= secondary <= upper in index order, no iterator is created for them
+             *  @return the number of entries copied, at most limit
+             */
+            uint32_t range_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_const_type lower, secondary_key_proxy_const_type upper,
+                                      secondary_key_type* secondaries, uint64_t* primaries, size_t limit ) {
+               auto tab = context.find_table( code, scope, table );
+               if( !tab ) return 0;
+
+               const auto& idx = context.db.get_index< typename chainbase::get_index_type<ObjectType>::type, by_secondary >();
+               auto itr = idx.lower_bound( secondary_key_helper_t::create_tuple( *tab, lower ) );
+
+               uint32_t count = 0;
+               for( ; count < limit && itr != idx.end() && itr->t_id == tab->id && !(upper < itr->secondary_key); ++itr, ++count ) {
+                  if( secondaries ) secondaries[count] = itr->secondary_key;
+                  if( primaries ) primaries[count] = itr->primary_key;
+               }
+               return count;
+            }
+
          private:
             apply_context&              context;
             iterator_cache<ObjectType>  itr_cache;
@@ -562,6 +710,20 @@ class apply_context {
       int  db_upperbound_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
       int  db_end_i64( uint64_t code, uint64_t scope, uint64_t table );
 
+      /**
+       *  Copies the rows with the given primary keys one after the other into buffer, row i spans [offsets[i], offsets[i+1]).
+       *  A missing row gets an empty span, a row that doesn't fit is not copied.
+       *  @return the size buffer needs to hold all the rows
+       */
+      int  db_get_i64_many( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count,
+                            char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len );
+
+      /**
+       *  Copies the primary keys of the rows with lower <= primary <= upper in index order, no iterator is created for them
+       *  @return the number of keys copied, at most primaries_len
+       */
+      int  db_i64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len );
+
 
       int  db_store_i256( uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size );
       int  db_store_i256( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size );
@@ -590,6 +752,10 @@ class apply_context {
       const table_id_object* find_table( name code, name scope, name table );
       const table_id_object& find_or_create_table( name code, name scope, name table, const account_name &payer );
       void                   remove_table( const table_id_object& tid );
+      void                   record_write( const table_id_object& tid );
+
+      const table_id_object* find_table_memo( name code, name scope, name table )const;
+      void                   add_table_memo( const table_id_object& tid );
 
 
 
@@ -635,12 +801,19 @@ class apply_context {
       generic_index<index_long_double_object>                        idx_long_double;
 
    private:
+      /// the last tables this action looked up, find_table goes to chainbase once per table
+      static constexpr uint32_t table_memo_size = 8;
+      std::array<const table_id_object*, table_memo_size> _table_memo = {};
+      uint32_t                            _table_memo_next = 0;
+
       iterator_cache<key256_value_object>    key256val_cache;
       iterator_cache<key_value_object>    keyval_cache;
       vector<account_name>                _notified; ///< keeps track of new accounts to be notifed of current message
       vector<action>                      _inline_actions; ///< queued inline messages
       vector<action>                      _cfa_inline_actions; ///< queued inline messages
       std::ostringstream                  _pending_console_output;
+      digest_type                         _act_digest;
+      bool                                _act_digest_valid = false;
       flat_set<account_delta>             _account_ram_deltas; ///< flat_set of account_delta so json is an array of objects
 
       //bytes                               _cached_trx;
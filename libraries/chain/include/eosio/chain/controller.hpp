@@ -5,6 +5,7 @@
 #include <boost/signals2/signal.hpp>
 
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/abi_cache.hpp>
 #include <eosio/chain/account_object.hpp>
 #include <eosio/chain/snapshot.hpp>
 
@@ -17,6 +18,7 @@ namespace eosio { namespace chain {
 
    class authorization_manager;
    class apply_context;
+   struct parallel_stats;
 
    namespace resource_limits {
       class resource_limits_manager;
@@ -47,6 +49,11 @@ namespace eosio { namespace chain {
       LIGHT
    };
 
+   enum class trace_verbosity {
+      MINIMAL, ///< action traces carry the receipt and the account and name of their action
+      FULL     ///< action traces carry a copy of their action and the console output of the contract
+   };
+
    class controller {
       public:
 
@@ -69,12 +76,14 @@ namespace eosio { namespace chain {
             bool                     contracts_console      =  false;
             bool                     skip_signature_check   =  false;
             bool                     allow_ram_billing_in_notify = false;
+            bool                     record_parallel_stats  =  false;
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
+            trace_verbosity          trace_level            = trace_verbosity::FULL;
 
             flat_set<account_name>   resource_greylist;
             flat_set<account_name>   trusted_producers;
@@ -244,8 +253,28 @@ namespace eosio { namespace chain {
          db_read_mode get_read_mode()const;
          validation_mode get_validation_mode()const;
 
+         /**
+          *  Plugins that keep action data or console output of the traces they are handed ask for FULL
+          */
+         void set_trace_verbosity( trace_verbosity v );
+         trace_verbosity get_trace_verbosity()const;
+
          void set_subjective_cpu_leeway(fc::microseconds leeway);
 
+         /**
+          *  Read and write sets of the transactions in the committed blocks, with a simulated schedule on 1 to 16
+          *  cores. This is instrumentation, the blocks are still executed serially.
+          *  Only collected with config::record_parallel_stats.
+          */
+         const parallel_stats& get_parallel_stats()const;
+         void                  reset_parallel_stats();
+
+         /**
+          *  Transactions only record their footprint when this is set or parallel stats are collected
+          */
+         void set_record_footprints( bool record );
+         bool records_footprints()const;
+
          signal<void(const signed_block_ptr&)>         pre_accepted_block;
          signal<void(const block_state_ptr&)>          accepted_block_header;
          signal<void(const block_state_ptr&)>          accepted_block;
@@ -281,11 +310,23 @@ namespace eosio { namespace chain {
             return optional<abi_serializer>();
          }
 
+         /**
+          *  Same as get_abi_serializer, but the serializer comes from the process wide abi_cache
+          */
+         std::shared_ptr<const abi_serializer> get_cached_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
+            if( n.good() ) {
+               try {
+                  return abi_cache::instance().get_serializer( db(), n, max_serialization_time );
+               } FC_CAPTURE_AND_LOG((n))
+            }
+            return std::shared_ptr<const abi_serializer>();
+         }
+
          template<typename T>
          fc::variant to_variant_with_abi( const T& obj, const fc::microseconds& max_serialization_time ) {
             fc::variant pretty_output;
             abi_serializer::to_variant( obj, pretty_output,
-                                        [&]( account_name n ){ return get_abi_serializer( n, max_serialization_time ); },
+                                        [&]( account_name n ){ return get_cached_abi_serializer( n, max_serialization_time ); },
                                         max_serialization_time);
             return pretty_output;
          }
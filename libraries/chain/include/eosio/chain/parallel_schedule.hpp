@@ -0,0 +1,60 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/transaction_footprint.hpp>
+
+namespace eosio { namespace chain {
+
+   /**
+    *  Instrumentation only: estimates how the transactions of a block could have been spread over a number of
+    *  cores. Nothing is executed from this schedule, the controller still applies every transaction serially.
+    *
+    *  Transactions are taken in block order and each one is started on the first free core as soon as every
+    *  earlier transaction it conflicts with has finished, then committed in block order. Since a transaction
+    *  only ever runs after the ones it depends on, the committed state is the one of the serial path.
+    */
+   class parallel_schedule {
+      public:
+         static const vector<uint32_t>& core_counts();
+
+         void add( std::shared_ptr<const transaction_footprint> footprint, int64_t cost_us );
+         void clear() { entries.clear(); }
+
+         size_t   size()const { return entries.size(); }
+         uint64_t serial_us()const;
+
+         /**
+          *  @return the simulated time it would take to execute the transactions on cores threads
+          */
+         uint64_t makespan_us( uint32_t cores )const;
+
+         /**
+          *  @return the number of transactions that had to wait on an earlier one
+          */
+         uint32_t conflicts()const;
+
+      private:
+         struct entry {
+            std::shared_ptr<const transaction_footprint> footprint;
+            uint64_t                                     cost_us = 0;
+         };
+
+         vector<entry> entries;
+   };
+
+   struct parallel_stats {
+      uint64_t                   blocks = 0;
+      uint64_t                   transactions = 0;
+      uint64_t                   conflicts = 0;
+      uint64_t                   serial_us = 0;
+      vector<uint32_t>           cores;
+      vector<uint64_t>           makespan_us; ///< parallel to cores
+
+      void add( const parallel_schedule& s );
+   };
+
+} } /// namespace eosio::chain
+
+FC_REFLECT( eosio::chain::parallel_stats, (blocks)(transactions)(conflicts)(serial_us)(cores)(makespan_us) )
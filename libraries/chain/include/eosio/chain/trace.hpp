@@ -7,6 +7,7 @@
 #include <eosio/chain/action.hpp>
 #include <eosio/chain/action_receipt.hpp>
 #include <eosio/chain/block.hpp>
+#include <eosio/chain/transaction_footprint.hpp>
 
 namespace eosio { namespace chain {
 
@@ -57,6 +58,7 @@ namespace eosio { namespace chain {
       uint64_t                                   net_usage = 0;
       bool                                       scheduled = false;
       vector<action_trace>                       action_traces; ///< disposable
+      std::shared_ptr<const transaction_footprint> footprint; ///< contract tables the transaction read and wrote, if the controller records them, not serialized
 
       transaction_trace_ptr                      failed_dtrx_trace;
       fc::optional<fc::exception>                except;
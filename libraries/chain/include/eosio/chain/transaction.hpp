@@ -66,6 +66,11 @@ namespace eosio { namespace chain {
                                                      bool allow_duplicate_keys = false,
                                                      bool use_cache = true )const;
 
+      /**
+       *  Sets how many recovered keys get_signature_keys keeps, it is shared by every thread recovering keys
+       */
+      static void set_recovery_cache_size( uint32_t entries );
+
       uint32_t total_actions()const { return context_free_actions.size() + actions.size(); }
       account_name first_authorizor()const {
          for( const auto& a : actions ) {
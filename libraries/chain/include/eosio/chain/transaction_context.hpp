@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
+#include <eosio/chain/transaction_footprint.hpp>
 #include <signal.h>
 
 namespace eosio { namespace chain {
@@ -89,6 +90,7 @@ namespace eosio { namespace chain {
          flat_set<account_name>        bill_to_accounts;
          flat_set<account_name>        validate_ram_usage;
          int32_t                       ram_usage = 0;
+         std::shared_ptr<transaction_footprint> footprint; ///< tables and accounts touched so far, null unless the controller records footprints
 
          /// the maximum number of virtual CPU instructions of the transaction that can be safely billed to the billable accounts
          uint64_t                      initial_max_billable_cpu = 0;
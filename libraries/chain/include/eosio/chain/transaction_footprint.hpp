@@ -0,0 +1,80 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+namespace eosio { namespace chain {
+
+   struct table_access_key {
+      account_name code;
+      scope_name   scope;
+      table_name   table;
+
+      friend bool operator < ( const table_access_key& a, const table_access_key& b ) {
+         return std::tie(a.code, a.scope, a.table) < std::tie(b.code, b.scope, b.table);
+      }
+      friend bool operator == ( const table_access_key& a, const table_access_key& b ) {
+         return a.code == b.code && a.scope == b.scope && a.table == b.table;
+      }
+   };
+
+   /**
+    *  The contract tables a transaction read and wrote, plus the receivers, authorizers and ram payers of its actions.
+    *
+    *  Two transactions whose footprints don't conflict can be executed in any order, or at the same time,
+    *  with the same result. Per account counters (action sequences, cpu, net and ram billing) don't make a
+    *  conflict, they are applied when a transaction is committed, in block order. A transaction that ran a
+    *  native handler or touched deferred transactions changed chain state outside of contract tables and is
+    *  exclusive, it conflicts with everything.
+    */
+   struct transaction_footprint {
+      flat_set<table_access_key> reads;
+      flat_set<table_access_key> writes;
+      flat_set<account_name>     accounts;
+      bool                       exclusive = false;
+
+      void record_read( account_name code, scope_name scope, table_name table ) {
+         reads.insert( table_access_key{code, scope, table} );
+      }
+      void record_write( account_name code, scope_name scope, table_name table ) {
+         writes.insert( table_access_key{code, scope, table} );
+      }
+      void add_account( account_name a ) {
+         accounts.insert( a );
+      }
+
+      void clear() {
+         reads.clear();
+         writes.clear();
+         accounts.clear();
+         exclusive = false;
+      }
+
+      /**
+       *  true if one of the two writes something the other one reads or writes
+       */
+      bool conflicts_with( const transaction_footprint& other )const {
+         return exclusive || other.exclusive ||
+                intersects( writes, other.writes ) || intersects( writes, other.reads ) || intersects( reads, other.writes );
+      }
+
+   private:
+      template<typename Set>
+      static bool intersects( const Set& a, const Set& b ) {
+         auto i = a.begin();
+         auto j = b.begin();
+         while( i != a.end() && j != b.end() ) {
+            if( *i < *j ) ++i;
+            else if( *j < *i ) ++j;
+            else return true;
+         }
+         return false;
+      }
+   };
+
+} } /// namespace eosio::chain
+
+FC_REFLECT( eosio::chain::table_access_key, (code)(scope)(table) )
+FC_REFLECT( eosio::chain::transaction_footprint, (reads)(writes)(accounts)(exclusive) )
@@ -23,6 +23,8 @@ class transaction_metadata {
       bool                                                       accepted = false;
       bool                                                       implicit = false;
       bool                                                       scheduled = false;
+      std::shared_ptr<const transaction_footprint>               footprint; ///< recorded the last time the transaction was applied
+      fc::microseconds                                           elapsed;   ///< execution time of that run
 
       explicit transaction_metadata( const signed_transaction& t, packed_transaction::compression_type c = packed_transaction::none )
       :trx(t),packed_trx(t, c) {
@@ -1,6 +1,7 @@
 #pragma once
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/types.hpp>
+#include <eosio/chain/webassembly/instance_cache.hpp>
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
@@ -54,6 +55,13 @@ namespace eosio { namespace chain {
             wavm,
             wabt
          };
+         struct compile_metrics {
+            uint32_t queue_depth = 0;       //modules waiting for a background compile
+            uint64_t compiled = 0;          //modules compiled in the background so far
+            uint64_t total_compile_us = 0;
+            uint64_t max_compile_us = 0;
+         };
+
          static wasm_interface& get();
          ~wasm_interface();
 
@@ -65,8 +73,13 @@ namespace eosio { namespace chain {
          int apply(uint64_t receiver, uint64_t account, uint64_t act);
          bool init();
          int preload(uint64_t account);
+         //loads code handed over by the caller, unlike preload it never reads chain state and may run on any thread
+         int load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size);
          int unload(uint64_t account);
 
+         compile_metrics get_compile_metrics() const;
+         webassembly::common::instance_cache::stats get_cache_stats() const;
+
          //Immediately exits currently running wasm. UB is called when no wasm running
          void exit();
 
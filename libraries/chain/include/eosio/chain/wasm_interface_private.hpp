@@ -12,10 +12,13 @@
 #endif
 
 #include <eosio/chain/webassembly/runtime_interface.hpp>
+#include <eosio/chain/webassembly/module_cache.hpp>
+#include <eosio/chain/webassembly/instance_cache.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/asio.hpp>
 #include <boost/bind.hpp>
 
 #include <fc/scoped_exit.hpp>
@@ -27,6 +30,8 @@
 #include "WAST/WAST.h"
 #include "IR/Validate.h"
 
+#include <algorithm>
+#include <atomic>
 #include <mutex>
 
 #include <dlfcn.h>
@@ -64,6 +69,45 @@ namespace eosio { namespace chain {
    #error unkown mode
 #endif
          //init_native_contract();
+         open_module_cache();
+
+         char cache_size[32];
+         int size_len = get_vm_api()->get_option("wasm-cache-size-mb", cache_size, sizeof(cache_size) - 1);
+         if (size_len > 0) {
+            cache_size[size_len] = 0;
+            instances.set_budget(strtoull(cache_size, nullptr, 10) * 1024 * 1024);
+         }
+#if defined(_WAVM)
+         //only the jit is worth compiling in the background, wabt instantiates fast enough on the spot.
+         //compiles are serialized on runtime_lock anyway, a second thread would only wait on the first one
+         char threads[16];
+         int n = get_vm_api()->get_option("wasm-compile-threads", threads, sizeof(threads) - 1);
+         if (n > 0) {
+            threads[n] = 0;
+            int count = atoi(threads);
+            EOS_ASSERT( count <= 1, wasm_exception, "wasm-compile-threads must be 0 or 1, got ${n}", ("n", count) );
+            start_compile_pool(count);
+         } else {
+            start_compile_pool(1);
+         }
+#endif
+      }
+
+      ~wasm_interface_impl() {
+         stop_compile_pool();
+      }
+
+      void open_module_cache() {
+         char dir[256];
+         int n = get_vm_api()->get_option("wasm-module-cache-dir", dir, sizeof(dir));
+         if (n > 0 && n < (int)sizeof(dir)) {
+            module_cache.open(std::string(dir, n), runtime_name);
+            return;
+         }
+         n = get_vm_api()->get_option("data-dir", dir, sizeof(dir));
+         if (n > 0 && n < (int)sizeof(dir)) {
+            module_cache.open(std::string(dir, n) + "/wasm_cache", runtime_name);
+         }
       }
 
       std::vector<uint8_t> parse_initial_memory(const Module& module) {
@@ -84,29 +128,25 @@ namespace eosio { namespace chain {
          return mem_image;
       }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const uint64_t& receiver, bool preload = false )
+      std::shared_ptr<wasm_instantiated_module_interface> get_instantiated_module( const uint64_t& receiver, bool preload = false )
       {
          size_t size = 0;
          const char* code;
          char code_id[8*4];
 
-         {
-            std::lock_guard<std::mutex> lock(m);
-
-            code = get_code( receiver, &size );
-            get_code_id(receiver, code_id, sizeof(code_id));
-            if (size <= 0) {
-               EOS_ASSERT(false, asset_type_exception, "code size should not be zero");
-            }
+         //the code_version is all a hit needs, the code itself is only fetched on a miss
+         get_code_id(receiver, code_id, sizeof(code_id));
+         auto instance = instances.find(receiver, code_id);
+         if (instance) {
+            return instance;
+         }
 
-            auto it = instantiation_cache.find(receiver);
-            if (it != instantiation_cache.end()) {
-               if (0 == memcmp(code_id, it->second->code_id, sizeof(code_id))) {
-                  return it->second;
-               }
-            }
+         code = get_code( receiver, &size );
+         if (size <= 0) {
+            EOS_ASSERT(false, asset_type_exception, "code size should not be zero");
          }
 
+         //a background compile of the same code may be under way, load_module waits for it and picks its result up
          auto timer_pause = fc::make_scoped_exit([&](){
             if (!preload) {
                resume_billing_timer();
@@ -115,16 +155,108 @@ namespace eosio { namespace chain {
          if (!preload) {
             pause_billing_timer();
          }
-         return load_module(receiver, code, size);
+         return load_module(receiver, code_id, code, size);
+      }
+
+      void start_compile_pool(int threads) {
+         if (threads <= 0) {
+            return;
+         }
+         compile_pool = std::make_unique<boost::asio::io_service>();
+         compile_pool_work = std::make_unique<boost::asio::io_service::work>(*compile_pool);
+         for (int i = 0; i < threads; i++) {
+            compile_threads.create_thread( boost::bind( &boost::asio::io_service::run, compile_pool.get() ) );
+         }
+      }
+
+      void stop_compile_pool() {
+         if (!compile_pool) {
+            return;
+         }
+         compile_pool_work.reset();
+         compile_pool->stop();
+         compile_threads.join_all();
+         compile_pool.reset();
       }
 
+      /**
+       * Queues the compilation of a module on the compile pool, code and code_id are copied so that the
+       * worker never touches chain state
+       */
+      void load_module_async(uint64_t receiver, const char* code_id, const char* code, size_t size) {
+         std::string id(code_id, 8*4);
+         {
+            std::lock_guard<std::mutex> lock(m);
+            auto it = pending_modules.find(receiver);
+            if (it != pending_modules.end() && it->second == id) {
+               return;
+            }
+            pending_modules[receiver] = id;
+         }
 
-       void load_module_async(uint64_t receiver, const char* code, size_t size) {
-          load_module(receiver, code, size);
-          //send a transaction to indicate that module is loaded by BP.
-       }
+         compile_metrics.queue_depth++;
+         compile_pool->post([this, receiver, id, bytes = std::vector<char>(code, code + size)]() {
+            compile_metrics.queue_depth--;
+            auto start = fc::time_point::now();
+            try {
+               load_module(receiver, id.data(), bytes.data(), bytes.size());
+            } catch ( const fc::exception& e ) {
+               elog("background compile of ${a} failed: ${e}", ("a", name(receiver))("e", e.to_detail_string()));
+            } catch ( const std::exception& e ) {
+               elog("background compile of ${a} failed: ${e}", ("a", name(receiver))("e", e.what()));
+            } catch ( ... ) {
+               elog("background compile of ${a} failed", ("a", name(receiver)));
+            }
+            uint64_t cost = (fc::time_point::now() - start).count();
+
+            {
+               std::lock_guard<std::mutex> lock(m);
+               auto it = pending_modules.find(receiver);
+               if (it != pending_modules.end() && it->second == id) {
+                  pending_modules.erase(it);
+               }
+            }
+            compile_metrics.compiled++;
+            compile_metrics.total_compile_us += cost;
+            uint64_t max_cost = compile_metrics.max_compile_us;
+            while (cost > max_cost && !compile_metrics.max_compile_us.compare_exchange_weak(max_cost, cost)) {
+            }
+            ilog("compiled ${a} in ${t} us, ${n} module(s) still queued", ("a", name(receiver))("t", cost)("n", compile_metrics.queue_depth.load()));
+         });
+      }
+
+      /**
+       * Every call into the runtime goes through here. WAVM compiles in one global LLVMContext and tracks its
+       * objects in an unlocked global list, so a background compile must neither overlap another compile nor
+       * an apply running jitted code. The time an apply waits for a compile isn't billed to its action
+       */
+      std::unique_lock<std::recursive_mutex> lock_runtime(bool billed) {
+         std::unique_lock<std::recursive_mutex> lock(runtime_lock, std::try_to_lock);
+         if (!lock.owns_lock()) {
+            if (billed) {
+               pause_billing_timer();
+            }
+            lock.lock();
+            if (billed) {
+               resume_billing_timer();
+            }
+         }
+         return lock;
+      }
+
+      std::shared_ptr<wasm_instantiated_module_interface> load_module(uint64_t receiver, const char* code_id, const char* code, size_t size) {
+         auto lock = lock_runtime(false);
+         auto instance = instances.find(receiver, code_id);
+         if (instance) {
+            return instance;
+         }
+
+         auto cached = module_cache.load(receiver, code_id, 8*4);
+         if (cached) {
+            instance = runtime_interface->instantiate_module(cached->wasm(), cached->wasm_size(), cached->initial_memory());
+            return install_module(receiver, code_id, std::move(instance), cached->wasm_size() + cached->initial_memory_size());
+         }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& load_module(uint64_t receiver, const char* code, size_t size) {
          IR::Module module;
          try {
             Serialization::MemoryInputStream stream((const U8*)code, size);
@@ -149,36 +281,43 @@ namespace eosio { namespace chain {
          } catch(const IR::ValidationException& e) {
             EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
          }
-         {
-            std::lock_guard<std::mutex> lock(m);
-            instantiation_cache[receiver] = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module));
-            auto it = instantiation_cache.find(receiver);
-            char code_id[8*4];
-            get_code_id(receiver, code_id, sizeof(code_id));
-            memcpy(it->second->code_id, code_id, sizeof(code_id));
-            return it->second;
+         std::vector<uint8_t> initial_memory = parse_initial_memory(module);
+         module_cache.store(receiver, code_id, 8*4, bytes, initial_memory);
+         const size_t cost = bytes.size() + initial_memory.size();
+         instance = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), std::move(initial_memory));
+         return install_module(receiver, code_id, std::move(instance), cost);
+      }
+
+      /**
+       * Called with the runtime locked. An apply that already holds the previous instance keeps it alive until
+       * it returns, the runtime frees it in a later collection
+       */
+      std::shared_ptr<wasm_instantiated_module_interface> install_module(uint64_t receiver, const char* code_id, std::shared_ptr<wasm_instantiated_module_interface> instance, size_t cost) {
+         memcpy(instance->code_id, code_id, sizeof(instance->code_id));
+         if (instances.insert(receiver, instance, cost + instance->footprint())) {
+            runtime_interface->collect_instances();
          }
+         return instance;
       }
 
+      //the on-disk entry stays, a later load of the same code_version picks it up again
       int unload_module(uint64_t account) {
-         std::lock_guard<std::mutex> lock(m);
-         auto it = instantiation_cache.find(account);
-         if (it != instantiation_cache.end()) {
-            instantiation_cache.erase(it);
-            return 1;
+         auto lock = lock_runtime(false);
+         if (!instances.erase(account)) {
+            return 0;
          }
-         return 0;
+         runtime_interface->collect_instances();
+         return 1;
       }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module()
+      std::shared_ptr<wasm_instantiated_module_interface> get_instantiated_module()
       {
          const uint64_t receiver = 0;
-         {
-            std::lock_guard<std::mutex> lock(m);
-            auto it = instantiation_cache.find(receiver);
-            if (it != instantiation_cache.end()) {
-               return it->second;
-            }
+         const char lab_code_id[8*4] = {0};
+         auto lock = lock_runtime(false);
+         auto instance = instances.find(receiver, lab_code_id);
+         if (instance) {
+            return instance;
          }
 
          string wast;
@@ -210,15 +349,36 @@ namespace eosio { namespace chain {
             EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
          }
 
-         {
-            std::lock_guard<std::mutex> lock(m);
-            instantiation_cache[receiver] = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module));
-            return instantiation_cache.find(receiver)->second;
-         }
+         std::vector<uint8_t> initial_memory = parse_initial_memory(module);
+         const size_t cost = bytes.size() + initial_memory.size();
+         instance = runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), std::move(initial_memory));
+         return install_module(receiver, lab_code_id, std::move(instance), cost);
       }
-      std::mutex m;
+#if defined(_WAVM)
+      static constexpr const char* runtime_name = "wavm";
+#elif defined(_WABT)
+      static constexpr const char* runtime_name = "wabt";
+#else
+      static constexpr const char* runtime_name = "wasm";
+#endif
+
+      struct {
+         std::atomic<uint32_t> queue_depth{0};
+         std::atomic<uint64_t> compiled{0};
+         std::atomic<uint64_t> total_compile_us{0};
+         std::atomic<uint64_t> max_compile_us{0};
+      } compile_metrics;
+
+      std::mutex m; //guards pending_modules
+      std::recursive_mutex runtime_lock; //see lock_runtime, recursive for contracts calling into other contracts
+      common::module_cache module_cache;
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
-      map<uint64_t, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+      common::instance_cache instances; //after runtime_interface, the instances point into its compartments and modules
+      map<uint64_t, std::string> pending_modules; //account => code_id queued on the compile pool
+
+      std::unique_ptr<boost::asio::io_service> compile_pool;
+      std::unique_ptr<boost::asio::io_service::work> compile_pool_work;
+      boost::thread_group compile_threads;
    };
 
 #if defined(_WAVM)
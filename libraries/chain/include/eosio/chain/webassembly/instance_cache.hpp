@@ -0,0 +1,74 @@
+#pragma once
+#include <eosio/chain/webassembly/runtime_interface.hpp>
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   /**
+    * @class instance_cache
+    *
+    * Memory budgeted LRU cache of instantiated modules, keyed by account.
+    *
+    * The cache is split into shards with a lock each so that the apply thread and the compile/preload
+    * threads rarely contend, every shard gets an equal part of the budget. An entry carries the code_id it
+    * was built from, a lookup with a different code_id counts as a miss.
+    */
+   class instance_cache {
+      public:
+         struct stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t evictions = 0;
+            uint64_t entries = 0;
+            uint64_t bytes = 0;
+         };
+
+         /**
+          * @param budget - approximate number of bytes the cached modules may use, 0 for no limit
+          */
+         explicit instance_cache(size_t budget = 0);
+
+         void set_budget(size_t budget);
+
+         std::shared_ptr<wasm_instantiated_module_interface> find(uint64_t account, const char* code_id);
+         /**
+          * @return the number of entries the new one replaced or pushed out of the budget
+          */
+         size_t insert(uint64_t account, std::shared_ptr<wasm_instantiated_module_interface> instance, size_t cost);
+         bool erase(uint64_t account);
+
+         stats get_stats() const;
+
+      private:
+         struct entry {
+            uint64_t                                            account;
+            std::shared_ptr<wasm_instantiated_module_interface> instance;
+            size_t                                              cost;
+         };
+
+         struct shard {
+            mutable std::mutex                                      lock;
+            std::list<entry>                                        lru; //most recently used first
+            std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+            size_t                                                  bytes = 0;
+         };
+
+         static constexpr size_t shard_count = 16;
+
+         shard& shard_of(uint64_t account) { return _shards[(account ^ (account >> 32)) % shard_count]; }
+         size_t evict(shard& s, size_t shard_budget);
+
+         std::array<shard, shard_count> _shards;
+         std::atomic<size_t>            _budget;
+         std::atomic<uint64_t>          _hits{0};
+         std::atomic<uint64_t>          _misses{0};
+         std::atomic<uint64_t>          _evictions{0};
+   };
+
+} } } } // eosio::chain::webassembly::common
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   enum class memory_reset_mode {
+      copy, //zero the whole linear memory and copy the data segments back on every apply
+      cow   //drop the pages dirtied by the last apply and let the kernel fault the pristine image back in
+   };
+
+   /**
+    * @class memory_image
+    *
+    * Holds the pristine linear memory image (the data segments) of an instantiated module and
+    * knows how to bring a sandbox memory back to it between applies.
+    *
+    * In cow mode the image is written once into an anonymous memfd. For WAVM, whose linear memory is
+    * page aligned and reserved by the runtime, the memfd is mapped MAP_PRIVATE over the start of the
+    * memory, so restoring it is a single madvise(MADV_DONTNEED): private copies of the pages the previous
+    * apply wrote are discarded and the next touch faults in the file (or zero) page again. The cost of a
+    * reset therefore scales with the number of pages touched instead of the size of the memory.
+    * For WABT, whose memory lives in a heap buffer, only the zeroing is done lazily and the data
+    * segments are still copied back.
+    *
+    * cow mode is only available on linux, everywhere else the image silently falls back to copy mode.
+    */
+   class memory_image {
+      public:
+         explicit memory_image(std::vector<uint8_t> initial_memory);
+         ~memory_image();
+
+         memory_image(const memory_image&) = delete;
+         memory_image& operator=(const memory_image&) = delete;
+
+         const std::vector<uint8_t>& data() const { return _data; }
+         size_t size() const { return _data.size(); }
+
+         /**
+          * Resets an arbitrary buffer of memory_size bytes to the pristine image
+          */
+         void restore(char* memory, size_t memory_size) const;
+
+         /**
+          * Resets a page aligned, runtime owned memory region of memory_size committed bytes to the
+          * pristine image. In cow mode the image is mapped over the start of the region.
+          */
+         void restore_mapped(char* memory, size_t memory_size) const;
+
+         /**
+          * Called before the runtime frees or reuses a memory that restore_mapped was used on. Unmaps the image
+          * from it and forgets the mapping, so a new memory at the same address doesn't look like it holds an image.
+          */
+         static void release_mapped(char* memory, size_t memory_size);
+
+         static void set_mode(memory_reset_mode mode);
+         static memory_reset_mode get_mode();
+         static bool cow_supported();
+
+      private:
+         bool use_cow() const;
+
+         std::vector<uint8_t>  _data;
+         uint64_t              _id = 0;
+         int                   _fd = -1;
+         size_t                _mapped_size = 0; //_data.size() rounded up to the os page size
+   };
+
+} } } } // eosio::chain::webassembly::common
@@ -0,0 +1,69 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   /**
+    * @class module_cache
+    *
+    * Persists the injected wasm and the initial memory image of every loaded contract so that a restarted
+    * node doesn't have to re-parse and re-inject code it has already seen.
+    *
+    * Entries live in <dir>/<runtime>-<build id>/<account>-<code_id>.mod and are keyed by the code_version digest of the
+    * account, so a setcode naturally misses. The build id is derived from the sources of the parser and the injection
+    * passes, directories of other builds and older entries of an account are evicted as soon as they are noticed.
+    *
+    * Entries are instantiated without running the injection passes again, so each one carries an HMAC under a
+    * random key kept next to the build directories. An entry that doesn't authenticate is dropped and rebuilt.
+    */
+   class module_cache {
+      public:
+         /**
+          * A cached module, the wasm and memory image point into a read only mapping of the cache file
+          */
+         class entry {
+            public:
+               entry(void* mapping, size_t mapping_size, const char* wasm, size_t wasm_size, const uint8_t* memory, size_t memory_size);
+               ~entry();
+
+               const char* wasm() const { return _wasm; }
+               size_t wasm_size() const { return _wasm_size; }
+               std::vector<uint8_t> initial_memory() const { return std::vector<uint8_t>(_memory, _memory + _memory_size); }
+               size_t initial_memory_size() const { return _memory_size; }
+
+            private:
+               void*          _mapping;
+               size_t         _mapping_size;
+               const char*    _wasm;
+               size_t         _wasm_size;
+               const uint8_t* _memory;
+               size_t         _memory_size;
+         };
+
+         module_cache() = default;
+
+         /**
+          * Opens the cache of the given runtime in dir, an empty dir disables the cache
+          */
+         void open(const std::string& dir, const std::string& runtime);
+         bool is_open() const { return !_dir.empty(); }
+
+         std::unique_ptr<entry> load(uint64_t account, const char* code_id, size_t code_id_size) const;
+         void store(uint64_t account, const char* code_id, size_t code_id_size,
+                    const std::vector<uint8_t>& wasm, const std::vector<uint8_t>& initial_memory);
+
+         static const char* build_id();
+
+      private:
+         std::string entry_path(uint64_t account, const char* code_id, size_t code_id_size) const;
+         void evict(uint64_t account, const std::string& keep);
+
+         std::string       _dir;
+         std::vector<char> _key;
+   };
+
+} } } } // eosio::chain::webassembly::common
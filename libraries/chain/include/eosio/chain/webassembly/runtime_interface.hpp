@@ -11,6 +11,8 @@ class wasm_instantiated_module_interface {
    public:
       virtual void apply(uint64_t receiver, uint64_t account, uint64_t act) = 0;
       virtual uint64_t call(const std::string &entry_point, const std::vector <uint64_t> & _args) = 0;
+      //bytes held by the instance on top of its wasm and initial memory, e.g. committed linear memory and jitted code
+      virtual size_t footprint() const { return 0; }
 
       virtual ~wasm_instantiated_module_interface();
    char code_id[8*4];
@@ -23,6 +25,10 @@ class wasm_runtime_interface {
       //immediately exit the currently running wasm_instantiated_module_interface. Yep, this assumes only one can possibly run at a time.
       virtual void immediately_exit_currently_running_module() = 0;
 
+      //free what the runtime keeps of instances that have been destroyed. Not thread safe, the caller has to
+      //make sure nothing else uses the runtime meanwhile
+      virtual void collect_instances() {}
+
       virtual ~wasm_runtime_interface();
 };
 
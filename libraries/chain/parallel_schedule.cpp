@@ -0,0 +1,125 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/parallel_schedule.hpp>
+
+#include <functional>
+#include <queue>
+
+namespace eosio { namespace chain {
+
+const vector<uint32_t>& parallel_schedule::core_counts() {
+   static const vector<uint32_t> counts = {1, 2, 4, 8, 16};
+   return counts;
+}
+
+void parallel_schedule::add( std::shared_ptr<const transaction_footprint> footprint, int64_t cost_us ) {
+   entries.emplace_back();
+   entries.back().footprint = std::move(footprint);
+   entries.back().cost_us = cost_us > 0 ? cost_us : 0;
+}
+
+uint64_t parallel_schedule::serial_us()const {
+   uint64_t total = 0;
+   for( const auto& e : entries ) {
+      total += e.cost_us;
+   }
+   return total;
+}
+
+uint64_t parallel_schedule::makespan_us( uint32_t cores )const {
+   if( cores == 0 || entries.empty() ) {
+      return 0;
+   }
+
+   map<table_access_key, uint64_t> write_end; // finish time of the last writer of a table
+   map<table_access_key, uint64_t> read_end;  // finish time of the last reader of a table
+   uint64_t exclusive_end = 0;
+   uint64_t end = 0;
+
+   std::priority_queue<uint64_t, vector<uint64_t>, std::greater<uint64_t>> free_at;
+   for( uint32_t i = 0; i < cores; i++ ) {
+      free_at.push(0);
+   }
+
+   for( const auto& e : entries ) {
+      const auto& fp = *e.footprint;
+
+      uint64_t ready = fp.exclusive ? end : exclusive_end;
+      for( const auto& key : fp.reads ) {
+         auto itr = write_end.find(key);
+         if( itr != write_end.end() ) ready = std::max(ready, itr->second);
+      }
+      for( const auto& key : fp.writes ) {
+         auto itr = write_end.find(key);
+         if( itr != write_end.end() ) ready = std::max(ready, itr->second);
+         itr = read_end.find(key);
+         if( itr != read_end.end() ) ready = std::max(ready, itr->second);
+      }
+
+      uint64_t start = std::max(ready, free_at.top());
+      uint64_t finish = start + e.cost_us;
+      free_at.pop();
+      free_at.push(finish);
+
+      for( const auto& key : fp.reads ) {
+         auto& t = read_end[key];
+         t = std::max(t, finish);
+      }
+      for( const auto& key : fp.writes ) {
+         auto& t = write_end[key];
+         t = std::max(t, finish);
+      }
+      if( fp.exclusive ) {
+         exclusive_end = finish;
+      }
+      end = std::max(end, finish);
+   }
+   return end;
+}
+
+uint32_t parallel_schedule::conflicts()const {
+   flat_set<table_access_key> read;
+   flat_set<table_access_key> written;
+   bool after_exclusive = false;
+   uint32_t count = 0;
+
+   for( size_t i = 0; i < entries.size(); i++ ) {
+      const auto& fp = *entries[i].footprint;
+
+      bool conflict = after_exclusive || (fp.exclusive && i > 0);
+      for( auto itr = fp.reads.begin(); !conflict && itr != fp.reads.end(); ++itr ) {
+         conflict = written.find(*itr) != written.end();
+      }
+      for( auto itr = fp.writes.begin(); !conflict && itr != fp.writes.end(); ++itr ) {
+         conflict = written.find(*itr) != written.end() || read.find(*itr) != read.end();
+      }
+      if( conflict ) {
+         count++;
+      }
+
+      read.insert(fp.reads.begin(), fp.reads.end());
+      written.insert(fp.writes.begin(), fp.writes.end());
+      after_exclusive = after_exclusive || fp.exclusive;
+   }
+   return count;
+}
+
+void parallel_stats::add( const parallel_schedule& s ) {
+   const auto& counts = parallel_schedule::core_counts();
+   if( cores != counts ) {
+      cores = counts;
+      makespan_us.assign(counts.size(), 0);
+   }
+
+   blocks++;
+   transactions += s.size();
+   conflicts += s.conflicts();
+   serial_us += s.serial_us();
+   for( size_t i = 0; i < counts.size(); i++ ) {
+      makespan_us[i] += s.makespan_us(counts[i]);
+   }
+}
+
+} } /// namespace eosio::chain
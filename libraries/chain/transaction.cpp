@@ -6,6 +6,9 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
 
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/multi_index_container.hpp>
@@ -48,6 +51,62 @@ typedef multi_index_container<
    >
 > recovery_cache_type;
 
+/**
+ *  Keys recovered from signatures, split in shards picked by the hash of the signature so that threads
+ *  recovering keys of different transactions rarely wait on each other. A shard is only locked to look up
+ *  or insert a key, never while a key is being recovered.
+ */
+class recovery_cache {
+   public:
+      static constexpr size_t shard_count = 16;
+
+      bool find( const signature_type& sig, const transaction_id_type& trx_id, public_key_type& key ) {
+         auto& s = shard_of( sig );
+         std::lock_guard<std::mutex> g( s.mtx );
+         auto it = s.cache.get<by_sig>().find( sig );
+         if( it == s.cache.get<by_sig>().end() || it->trx_id != trx_id ) {
+            return false;
+         }
+         key = it->pub_key;
+         return true;
+      }
+
+      void insert( const signature_type& sig, const transaction_id_type& trx_id, const public_key_type& key ) {
+         auto& s = shard_of( sig );
+         std::lock_guard<std::mutex> g( s.mtx );
+         s.cache.emplace_back( cached_pub_key{trx_id, key, sig} ); //could fail on dup signatures; not a problem
+         const size_t capacity = _shard_capacity.load( std::memory_order_relaxed );
+         while( s.cache.size() > capacity )
+            s.cache.erase( s.cache.begin() );
+      }
+
+      void set_size( uint32_t entries ) {
+         _shard_capacity.store( std::max<size_t>( 1, (entries + shard_count - 1) / shard_count ), std::memory_order_relaxed );
+      }
+
+   private:
+      struct shard {
+         std::mutex          mtx;
+         recovery_cache_type cache;
+      };
+
+      shard& shard_of( const signature_type& sig ) {
+         return _shards[std::hash<signature_type>()( sig ) % shard_count];
+      }
+
+      std::array<shard, shard_count> _shards;
+      std::atomic<size_t>            _shard_capacity{ (1000 + shard_count - 1) / shard_count };
+};
+
+static recovery_cache& get_recovery_cache() {
+   static recovery_cache cache;
+   return cache;
+}
+
+void transaction::set_recovery_cache_size( uint32_t entries ) {
+   get_recovery_cache().set_size( entries );
+}
+
 void transaction_header::set_reference_block( const block_id_type& reference_block ) {
    ref_block_num    = fc::endian_reverse_u32(reference_block._hash[0]);
    ref_block_prefix = reference_block._hash[1];
@@ -86,20 +145,17 @@ flat_set<public_key_type> transaction::get_signature_keys( const vector<signatur
 { try {
    using boost::adaptors::transformed;
 
-   constexpr size_t recovery_cache_size = 1000;
-   static recovery_cache_type recovery_cache;
+   auto& cache = get_recovery_cache();
    const digest_type digest = sig_digest(chain_id, cfd);
+   const transaction_id_type trx_id = use_cache ? id() : transaction_id_type();
 
    flat_set<public_key_type> recovered_pub_keys;
    for(const signature_type& sig : signatures) {
       public_key_type recov;
       if( use_cache ) {
-         recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
-         if( it == recovery_cache.get<by_sig>().end() || it->trx_id != id()) {
+         if( !cache.find( sig, trx_id, recov ) ) {
             recov = public_key_type( sig, digest );
-            recovery_cache.emplace_back(cached_pub_key{id(), recov, sig} ); //could fail on dup signatures; not a problem
-         } else {
-            recov = it->pub_key;
+            cache.insert( sig, trx_id, recov );
          }
       } else {
          recov = public_key_type( sig, digest );
@@ -112,11 +168,6 @@ flat_set<public_key_type> transaction::get_signature_keys( const vector<signatur
                );
    }
 
-   if( use_cache ) {
-      while ( recovery_cache.size() > recovery_cache_size )
-         recovery_cache.erase( recovery_cache.begin() );
-   }
-
    return recovered_pub_keys;
 } FC_CAPTURE_AND_RETHROW() }
 
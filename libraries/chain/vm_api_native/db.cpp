@@ -76,6 +76,14 @@ int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
    return ctx().db_end_i64(code, scope, table);
 }
 
+int32_t db_get_i64_many(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len) {
+   return ctx().db_get_i64_many(code, scope, table, primaries, count, buffer, buffer_size, offsets, offsets_len);
+}
+
+int32_t db_i64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len) {
+   return ctx().db_i64_range(code, scope, table, lower, upper, primaries, primaries_len);
+}
+
 #define DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY_(IDX, TYPE)\
       int db_##IDX##_store( uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const TYPE* secondary ) {\
          return ctx().IDX.store( scope, table, payer, id, *secondary );\
@@ -207,6 +215,12 @@ DB_API_METHOD_WRAPPERS_ARRAY_SECONDARY_(idx256, 2, uint128_t)
 DB_API_METHOD_WRAPPERS_FLOAT_SECONDARY_(idx_double, float64_t)
 DB_API_METHOD_WRAPPERS_FLOAT_SECONDARY_(idx_long_double, float128_t)
 
+int32_t db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len) {
+   //an array given with a length of 0 is not filled
+   size_t limit = std::min( secondaries_len ? secondaries_len : primaries_len, primaries_len ? primaries_len : secondaries_len );
+   return ctx().idx64.range_secondary(code, scope, table, lower, upper, secondaries_len ? secondaries : nullptr, primaries_len ? primaries : nullptr, limit);
+}
+
 int get_table_item_count(uint64_t code, uint64_t scope, uint64_t table) {
    return ctx().get_table_item_count(code, scope, table);
 }
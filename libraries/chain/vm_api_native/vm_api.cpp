@@ -734,6 +734,10 @@ extern "C" void vm_api_init() {
       _vm_api.ethaddr2n = nullptr;
       _vm_api.n2ethaddr = nullptr;
       _vm_api.is_contracts_console_enabled = is_contracts_console_enabled;
+
+      _vm_api.db_idx64_range = db_idx64_range;
+      _vm_api.db_get_i64_many = db_get_i64_many;
+      _vm_api.db_i64_range = db_i64_range;
    }
    vm_register_api(&_vm_api);
 
@@ -0,0 +1,95 @@
+#include <eosio/chain/webassembly/instance_cache.hpp>
+
+#include <string.h>
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   instance_cache::instance_cache(size_t budget) : _budget(budget) {}
+
+   void instance_cache::set_budget(size_t budget) {
+      _budget = budget;
+      if (budget == 0) {
+         return;
+      }
+      for (auto& s : _shards) {
+         std::lock_guard<std::mutex> guard(s.lock);
+         evict(s, budget / shard_count);
+      }
+   }
+
+   std::shared_ptr<wasm_instantiated_module_interface> instance_cache::find(uint64_t account, const char* code_id) {
+      shard& s = shard_of(account);
+      std::lock_guard<std::mutex> guard(s.lock);
+      auto it = s.index.find(account);
+      if (it == s.index.end() || memcmp(it->second->instance->code_id, code_id, sizeof(it->second->instance->code_id)) != 0) {
+         _misses++;
+         return nullptr;
+      }
+      s.lru.splice(s.lru.begin(), s.lru, it->second);
+      _hits++;
+      return it->second->instance;
+   }
+
+   size_t instance_cache::insert(uint64_t account, std::shared_ptr<wasm_instantiated_module_interface> instance, size_t cost) {
+      shard& s = shard_of(account);
+      std::lock_guard<std::mutex> guard(s.lock);
+      size_t dropped = 0;
+      auto it = s.index.find(account);
+      if (it != s.index.end()) {
+         s.bytes -= it->second->cost;
+         s.lru.erase(it->second);
+         s.index.erase(it);
+         dropped++;
+      }
+      s.lru.push_front(entry{account, std::move(instance), cost});
+      s.index[account] = s.lru.begin();
+      s.bytes += cost;
+
+      const size_t budget = _budget;
+      if (budget > 0) {
+         dropped += evict(s, budget / shard_count);
+      }
+      return dropped;
+   }
+
+   bool instance_cache::erase(uint64_t account) {
+      shard& s = shard_of(account);
+      std::lock_guard<std::mutex> guard(s.lock);
+      auto it = s.index.find(account);
+      if (it == s.index.end()) {
+         return false;
+      }
+      s.bytes -= it->second->cost;
+      s.lru.erase(it->second);
+      s.index.erase(it);
+      return true;
+   }
+
+   size_t instance_cache::evict(shard& s, size_t shard_budget) {
+      size_t evicted = 0;
+      //the most recently inserted module always stays, even if it alone exceeds the budget
+      while (s.bytes > shard_budget && s.lru.size() > 1) {
+         const entry& e = s.lru.back();
+         s.bytes -= e.cost;
+         s.index.erase(e.account);
+         s.lru.pop_back();
+         _evictions++;
+         evicted++;
+      }
+      return evicted;
+   }
+
+   instance_cache::stats instance_cache::get_stats() const {
+      stats result;
+      result.hits = _hits;
+      result.misses = _misses;
+      result.evictions = _evictions;
+      for (const auto& s : _shards) {
+         std::lock_guard<std::mutex> guard(s.lock);
+         result.entries += s.lru.size();
+         result.bytes += s.bytes;
+      }
+      return result;
+   }
+
+} } } } // eosio::chain::webassembly::common
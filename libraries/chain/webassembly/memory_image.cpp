@@ -0,0 +1,176 @@
+#include <eosio/chain/webassembly/memory_image.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   static std::atomic<memory_reset_mode> s_mode{memory_reset_mode::cow};
+   static std::atomic<uint64_t> s_next_image_id{1};
+
+   struct mapped_image {
+      uint64_t id = 0;
+      size_t   size = 0;
+   };
+
+   //which image is currently mapped at the start of each runtime owned memory
+   static std::map<char*, mapped_image> s_mapped_images;
+   static std::mutex s_mapped_images_lock;
+
+   static size_t os_page_size() {
+      static const size_t page_size = sysconf(_SC_PAGESIZE);
+      return page_size;
+   }
+
+   static int create_image_fd(const std::vector<uint8_t>& data, size_t mapped_size) {
+#if defined(__linux__) && defined(SYS_memfd_create)
+      int fd = syscall(SYS_memfd_create, "wasm_memory_image", MFD_CLOEXEC);
+      if (fd < 0) {
+         return -1;
+      }
+      if (ftruncate(fd, mapped_size) != 0) {
+         close(fd);
+         return -1;
+      }
+      size_t written = 0;
+      while (written < data.size()) {
+         ssize_t n = pwrite(fd, data.data() + written, data.size() - written, written);
+         if (n <= 0) {
+            close(fd);
+            return -1;
+         }
+         written += n;
+      }
+      return fd;
+#else
+      return -1;
+#endif
+   }
+
+   //gives the range of a mapped image back to plain anonymous memory, whatever lies past memory_size must stay
+   //inaccessible as the runtime relies on the guard pages for bounds checking
+   static void unmap_image(char* memory, size_t mapped_size, size_t memory_size) {
+      void* r = mmap(memory, mapped_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+      EOS_ASSERT( r != MAP_FAILED, wasm_execution_error, "failed to unmap WASM memory image" );
+      if (memory_size > 0) {
+         EOS_ASSERT( mprotect(memory, std::min(mapped_size, memory_size), PROT_READ | PROT_WRITE) == 0,
+                     wasm_execution_error, "failed to unprotect WASM memory" );
+      }
+   }
+
+   memory_image::memory_image(std::vector<uint8_t> initial_memory) :
+      _data(std::move(initial_memory)),
+      _id(s_next_image_id++)
+   {
+      if (!cow_supported() || _data.empty()) {
+         return;
+      }
+      const size_t page_size = os_page_size();
+      _mapped_size = (_data.size() + page_size - 1) & ~(page_size - 1);
+      _fd = create_image_fd(_data, _mapped_size);
+      if (_fd < 0) {
+         _mapped_size = 0;
+      }
+   }
+
+   memory_image::~memory_image() {
+      //a mapping that is still in place keeps its own reference to the file
+      if (_fd >= 0) {
+         close(_fd);
+      }
+   }
+
+   void memory_image::set_mode(memory_reset_mode mode) {
+      s_mode = mode;
+   }
+
+   memory_reset_mode memory_image::get_mode() {
+      return s_mode;
+   }
+
+   bool memory_image::cow_supported() {
+#if defined(__linux__)
+      //only linux guarantees that MADV_DONTNEED refills private pages from the backing file or with zeros
+      return true;
+#else
+      return false;
+#endif
+   }
+
+   bool memory_image::use_cow() const {
+      return get_mode() == memory_reset_mode::cow && cow_supported();
+   }
+
+   void memory_image::restore(char* memory, size_t memory_size) const {
+      EOS_ASSERT( _data.size() <= memory_size, wasm_execution_error, "WASM memory image larger than memory" );
+      if (!use_cow()) {
+         memset(memory, 0, memory_size);
+         memcpy(memory, _data.data(), _data.size());
+         return;
+      }
+
+      //the heap buffer can't be remapped, so only hand the page aligned interior back to the kernel
+      const size_t page_size = os_page_size();
+      char* begin = (char*)(((uintptr_t)memory + page_size - 1) & ~(page_size - 1));
+      char* end = (char*)(((uintptr_t)memory + memory_size) & ~(page_size - 1));
+      if (end > begin && madvise(begin, end - begin, MADV_DONTNEED) == 0) {
+         memset(memory, 0, begin - memory);
+         memset(end, 0, memory + memory_size - end);
+      } else {
+         memset(memory, 0, memory_size);
+      }
+      memcpy(memory, _data.data(), _data.size());
+   }
+
+   void memory_image::restore_mapped(char* memory, size_t memory_size) const {
+      const size_t page_size = os_page_size();
+      if (!use_cow() || (_fd < 0 && !_data.empty()) || ((uintptr_t)memory & (page_size - 1)) || _mapped_size > memory_size) {
+         restore(memory, memory_size);
+         return;
+      }
+
+      std::lock_guard<std::mutex> lock(s_mapped_images_lock);
+      auto& current = s_mapped_images[memory];
+      if (current.id != _id) {
+         if (current.size > 0) {
+            unmap_image(memory, current.size, memory_size);
+            current = mapped_image();
+         }
+         if (_mapped_size > 0) {
+            void* r = mmap(memory, _mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, _fd, 0);
+            EOS_ASSERT( r != MAP_FAILED, wasm_execution_error, "failed to map WASM memory image" );
+         }
+         current.id = _id;
+         current.size = _mapped_size;
+      }
+
+      //drops the private copies made by the previous apply, both of image pages and of zero pages
+      EOS_ASSERT( madvise(memory, memory_size, MADV_DONTNEED) == 0, wasm_execution_error, "failed to reset WASM memory" );
+   }
+
+   void memory_image::release_mapped(char* memory, size_t memory_size) {
+      std::lock_guard<std::mutex> lock(s_mapped_images_lock);
+      auto itr = s_mapped_images.find(memory);
+      if (itr == s_mapped_images.end()) {
+         return;
+      }
+      if (itr->second.size > 0) {
+         unmap_image(memory, itr->second.size, memory_size);
+      }
+      s_mapped_images.erase(itr);
+   }
+
+} } } } // eosio::chain::webassembly::common
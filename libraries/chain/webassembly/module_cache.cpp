@@ -0,0 +1,259 @@
+#include <eosio/chain/webassembly/module_cache.hpp>
+#include <eosio/chain/name.hpp>
+
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/log/logger.hpp>
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace bfs = boost::filesystem;
+
+namespace eosio { namespace chain { namespace webassembly { namespace common {
+
+   static const uint32_t module_cache_magic = 0x6d6f6477; //"wdom"
+   //bump whenever the layout of an entry or the meaning of its contents changes in a way the source hash can't see
+   static const uint32_t module_cache_version = 2;
+
+#ifndef MODULE_CACHE_SOURCES_HASH
+#error MODULE_CACHE_SOURCES_HASH has to be defined by the build
+#endif
+
+   struct module_cache_header {
+      uint32_t magic;
+      uint32_t version;
+      char     code_id[32];
+      uint64_t wasm_size;
+      uint64_t memory_size;
+      char     mac[32];     ///< HMAC-SHA256 of the rest of the header and the payload under the key of the cache
+   };
+
+   //HMAC-SHA256 of the header with a zeroed mac and the payload
+   static fc::sha256 entry_mac(const std::vector<char>& key, const module_cache_header& header,
+                               const char* wasm, size_t wasm_size, const uint8_t* memory, size_t memory_size) {
+      const size_t block_size = 64;
+      char ipad[block_size];
+      char opad[block_size];
+      memset(ipad, 0x36, block_size);
+      memset(opad, 0x5c, block_size);
+      for (size_t i = 0; i < key.size() && i < block_size; i++) {
+         ipad[i] ^= key[i];
+         opad[i] ^= key[i];
+      }
+
+      module_cache_header unsigned_header = header;
+      memset(unsigned_header.mac, 0, sizeof(unsigned_header.mac));
+
+      fc::sha256::encoder inner;
+      inner.write(ipad, block_size);
+      inner.write((const char*)&unsigned_header, sizeof(unsigned_header));
+      inner.write(wasm, wasm_size);
+      inner.write((const char*)memory, memory_size);
+      fc::sha256 inner_digest = inner.result();
+
+      fc::sha256::encoder outer;
+      outer.write(opad, block_size);
+      outer.write(inner_digest.data(), inner_digest.data_size());
+      return outer.result();
+   }
+
+   static bool load_key_file(const std::string& path, std::vector<char>& key) {
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+         return false;
+      }
+      bool ok = read(fd, key.data(), key.size()) == (ssize_t)key.size();
+      close(fd);
+      return ok;
+   }
+
+   //reads the key of the cache in dir, or creates it for a new cache
+   static bool load_key(const bfs::path& dir, std::vector<char>& key) {
+      const std::string path = (dir / "cache.key").string();
+      key.resize(32);
+      if (load_key_file(path, key)) {
+         return true;
+      }
+
+      int rnd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+      if (rnd < 0) {
+         return false;
+      }
+      bool ok = read(rnd, key.data(), key.size()) == (ssize_t)key.size();
+      close(rnd);
+      int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+      if (fd < 0 && errno == EEXIST) {
+         //another library instance created it in the meantime
+         return load_key_file(path, key);
+      }
+      if (!ok || fd < 0) {
+         return false;
+      }
+      ok = write(fd, key.data(), key.size()) == (ssize_t)key.size();
+      ok = (close(fd) == 0) && ok;
+      if (!ok) {
+         ::unlink(path.c_str());
+      }
+      return ok;
+   }
+
+   module_cache::entry::entry(void* mapping, size_t mapping_size, const char* wasm, size_t wasm_size, const uint8_t* memory, size_t memory_size) :
+      _mapping(mapping), _mapping_size(mapping_size),
+      _wasm(wasm), _wasm_size(wasm_size),
+      _memory(memory), _memory_size(memory_size)
+   {}
+
+   module_cache::entry::~entry() {
+      munmap(_mapping, _mapping_size);
+   }
+
+   const char* module_cache::build_id() {
+      //MODULE_CACHE_SOURCES_HASH is a hash of the sources of the parser, the serializer and the injection passes
+      static std::string id = "v" + std::to_string(module_cache_version) + "-" + MODULE_CACHE_SOURCES_HASH;
+      return id.c_str();
+   }
+
+   void module_cache::open(const std::string& dir, const std::string& runtime) {
+      _dir.clear();
+      if (dir.empty()) {
+         return;
+      }
+      try {
+         bfs::path root(dir);
+         const std::string prefix = runtime + "-";
+         const std::string current_name = prefix + build_id();
+         bfs::create_directories(root);
+         //entries built by any other build of the same runtime are useless
+         for (bfs::directory_iterator it(root); it != bfs::directory_iterator(); ++it) {
+            const std::string filename = it->path().filename().string();
+            if (filename.compare(0, prefix.size(), prefix) == 0 && filename != current_name) {
+               bfs::remove_all(it->path());
+            }
+         }
+         bfs::path current = root / current_name;
+         bfs::create_directories(current);
+         if (!load_key(root, _key)) {
+            elog("wasm module cache disabled: can't read or create the key in ${d}", ("d", root.string()));
+            return;
+         }
+         _dir = current.string();
+      } catch (const std::exception& e) {
+         elog("wasm module cache disabled: ${e}", ("e", e.what()));
+      }
+   }
+
+   std::string module_cache::entry_path(uint64_t account, const char* code_id, size_t code_id_size) const {
+      static const char* hex = "0123456789abcdef";
+      std::string path = _dir + "/" + name(account).to_string() + "-";
+      for (size_t i = 0; i < code_id_size; i++) {
+         path += hex[(uint8_t)code_id[i] >> 4];
+         path += hex[(uint8_t)code_id[i] & 0xf];
+      }
+      return path + ".mod";
+   }
+
+   std::unique_ptr<module_cache::entry> module_cache::load(uint64_t account, const char* code_id, size_t code_id_size) const {
+      if (!is_open() || code_id_size != sizeof(module_cache_header::code_id)) {
+         return nullptr;
+      }
+      std::string path = entry_path(account, code_id, code_id_size);
+      int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+         return nullptr;
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(module_cache_header)) {
+         close(fd);
+         return nullptr;
+      }
+      void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (mapping == MAP_FAILED) {
+         return nullptr;
+      }
+
+      const module_cache_header* header = (const module_cache_header*)mapping;
+      const size_t payload_size = st.st_size - sizeof(module_cache_header);
+      if (header->magic != module_cache_magic || header->version != module_cache_version ||
+          memcmp(header->code_id, code_id, code_id_size) != 0 ||
+          header->wasm_size > payload_size || header->memory_size != payload_size - header->wasm_size) {
+         //truncated or foreign file, drop it so that the next load rebuilds it
+         munmap(mapping, st.st_size);
+         ::unlink(path.c_str());
+         return nullptr;
+      }
+
+      //the entry is instantiated as is, without the injection passes, so it has to be one this node wrote
+      const char* wasm = (const char*)mapping + sizeof(module_cache_header);
+      const uint8_t* memory = (const uint8_t*)wasm + header->wasm_size;
+      fc::sha256 mac = entry_mac(_key, *header, wasm, header->wasm_size, memory, header->memory_size);
+      if (memcmp(mac.data(), header->mac, sizeof(header->mac)) != 0) {
+         wlog("wasm module cache entry ${p} failed authentication, rebuilding it", ("p", path));
+         munmap(mapping, st.st_size);
+         ::unlink(path.c_str());
+         return nullptr;
+      }
+
+      return std::make_unique<entry>(mapping, st.st_size, wasm, header->wasm_size, memory, header->memory_size);
+   }
+
+   void module_cache::store(uint64_t account, const char* code_id, size_t code_id_size,
+                            const std::vector<uint8_t>& wasm, const std::vector<uint8_t>& initial_memory) {
+      if (!is_open() || code_id_size != sizeof(module_cache_header::code_id)) {
+         return;
+      }
+      module_cache_header header;
+      memset(&header, 0, sizeof(header));
+      header.magic = module_cache_magic;
+      header.version = module_cache_version;
+      memcpy(header.code_id, code_id, code_id_size);
+      header.wasm_size = wasm.size();
+      header.memory_size = initial_memory.size();
+      fc::sha256 mac = entry_mac(_key, header, (const char*)wasm.data(), wasm.size(), initial_memory.data(), initial_memory.size());
+      memcpy(header.mac, mac.data(), sizeof(header.mac));
+
+      //write to a temporary file first so that a crash never leaves a half written entry behind
+      std::string path = entry_path(account, code_id, code_id_size);
+      std::string tmp_path = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+      FILE* f = fopen(tmp_path.c_str(), "wb");
+      if (!f) {
+         return;
+      }
+      bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+      ok = ok && (wasm.empty() || fwrite(wasm.data(), wasm.size(), 1, f) == 1);
+      ok = ok && (initial_memory.empty() || fwrite(initial_memory.data(), initial_memory.size(), 1, f) == 1);
+      ok = (fclose(f) == 0) && ok;
+      if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+         ::unlink(tmp_path.c_str());
+         return;
+      }
+      //entries of code the account has since replaced are never hit again
+      evict(account, bfs::path(path).filename().string());
+   }
+
+   void module_cache::evict(uint64_t account, const std::string& keep) {
+      if (!is_open()) {
+         return;
+      }
+      const std::string prefix = name(account).to_string() + "-";
+      try {
+         for (bfs::directory_iterator it(_dir); it != bfs::directory_iterator(); ++it) {
+            const std::string filename = it->path().filename().string();
+            if (filename.compare(0, prefix.size(), prefix) == 0 && filename != keep && bfs::path(filename).extension() == ".mod") {
+               bfs::remove(it->path());
+            }
+         }
+      } catch (const std::exception& e) {
+         elog("failed to evict wasm module cache entry of ${a}: ${e}", ("a", name(account))("e", e.what()));
+      }
+   }
+
+} } } } // eosio::chain::webassembly::common
@@ -1,4 +1,5 @@
 #include <eosio/chain/webassembly/wabt.hpp>
+#include <eosio/chain/webassembly/memory_image.hpp>
 #include <eosio/chain/apply_context.hpp>
 #include <eosio/chain/wasm_eosio_constraints.hpp>
 
@@ -14,12 +15,13 @@ static wabt_apply_instance_vars* static_wabt_vars;
 
 using namespace wabt;
 using namespace wabt::interp;
+using eosio::chain::webassembly::common::memory_image;
 namespace wasm_constraints = eosio::chain::wasm_constraints;
 
 class wabt_instantiated_module : public wasm_instantiated_module_interface {
    public:
       wabt_instantiated_module(std::unique_ptr<interp::Environment> e, std::vector<uint8_t> initial_mem, interp::DefinedModule* mod) :
-         _env(move(e)), _instatiated_module(mod), _initial_memory(initial_mem),
+         _env(move(e)), _instatiated_module(mod), _initial_memory(std::move(initial_mem)),
          _executor(_env.get(), nullptr, Thread::Options(64*1024,
                                                         wasm_constraints::maximum_call_depth+2))
       {
@@ -45,8 +47,7 @@ class wabt_instantiated_module : public wasm_instantiated_module_interface {
             Memory* memory = this_run_vars.memory = _env->GetMemory(0);
             memory->page_limits = _initial_memory_configuration;
             memory->data.resize(_initial_memory_configuration.initial * WABT_PAGE_SIZE);
-            memset(memory->data.data(), 0, memory->data.size());
-            memcpy(memory->data.data(), _initial_memory.data(), _initial_memory.size());
+            _initial_memory.restore((char*)memory->data.data(), memory->data.size());
          }
 
          _params[0].set_i64(receiver);
@@ -74,8 +75,7 @@ class wabt_instantiated_module : public wasm_instantiated_module_interface {
             Memory* memory = this_run_vars.memory = _env->GetMemory(0);
             memory->page_limits = _initial_memory_configuration;
             memory->data.resize(_initial_memory_configuration.initial * WABT_PAGE_SIZE);
-            memset(memory->data.data(), 0, memory->data.size());
-            memcpy(memory->data.data(), _initial_memory.data(), _initial_memory.size());
+            _initial_memory.restore((char*)memory->data.data(), memory->data.size());
          }
          TypedValues                                       _params{_args.size(), TypedValue(Type::I64)};
          for (int i=0;i<_args.size();i++) {
@@ -92,7 +92,7 @@ class wabt_instantiated_module : public wasm_instantiated_module_interface {
    private:
       std::unique_ptr<interp::Environment>              _env;
       DefinedModule*                                    _instatiated_module;  //this is owned by the Environment
-      std::vector<uint8_t>                              _initial_memory;
+      memory_image                                      _initial_memory;
       TypedValues                                       _params{3, TypedValue(Type::I64)};
       std::vector<std::pair<Global*, TypedValue>>       _initial_globals;
       Limits                                            _initial_memory_configuration;
@@ -121,7 +121,7 @@ std::unique_ptr<wasm_instantiated_module_interface> wabt_runtime::instantiate_mo
    wabt::Result res = ReadBinaryInterp(env.get(), code_bytes, code_size, read_binary_options, &errors, &instantiated_module);
    EOS_ASSERT( Succeeded(res), wasm_execution_error, "Error building wabt interp: ${e}", ("e", wabt::FormatErrorsToString(errors, Location::Type::Binary)) );
 
-   return std::make_unique<wabt_instantiated_module>(std::move(env), initial_memory, instantiated_module);
+   return std::make_unique<wabt_instantiated_module>(std::move(env), std::move(initial_memory), instantiated_module);
 }
 
 void wabt_runtime::immediately_exit_currently_running_module() {
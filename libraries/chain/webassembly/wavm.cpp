@@ -1,6 +1,7 @@
 //#include <eosio/chain/apply_context.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/webassembly/wavm.hpp>
+#include <eosio/chain/webassembly/memory_image.hpp>
 #include <eosio/chain/wasm_eosio_constraints.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
 
@@ -13,22 +14,53 @@
 #include "Runtime/Intrinsics.h"
 
 #include <mutex>
+#include <set>
 
 using namespace IR;
 using namespace Runtime;
 using namespace eosio::chain;
+using eosio::chain::webassembly::common::memory_image;
+using eosio::chain::webassembly::common::memory_reset_mode;
 
 namespace eosio { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+//WAVM only frees a ModuleInstance, its memory and its jitted code in a garbage collection, the instances of the
+//wavm_instantiated_modules still alive are its roots
+static std::set<ModuleInstance*> __live_instances;
+static std::mutex __live_instances_lock;
+
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
       wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
-         _initial_memory(initial_mem),
+         _initial_memory(std::move(initial_mem)),
          _instance(instance),
          _module(std::move(module))
-      {}
+      {
+         std::lock_guard<std::mutex> l(__live_instances_lock);
+         __live_instances.insert(_instance);
+      }
+
+      ~wavm_instantiated_module() {
+         //the memory lives on until WAVM collects the instance, after that its address can be handed to another one
+         MemoryInstance* default_mem = getDefaultMemory(_instance);
+         if(default_mem) {
+            memory_image::release_mapped((char*)getMemoryBaseAddress(default_mem),
+                                         getMemoryNumPages(default_mem) << IR::numBytesPerPageLog2);
+         }
+         std::lock_guard<std::mutex> l(__live_instances_lock);
+         __live_instances.erase(_instance);
+      }
+
+      size_t footprint() const override {
+         size_t bytes = getJITCodeSize(_instance);
+         MemoryInstance* default_mem = getDefaultMemory(_instance);
+         if(default_mem) {
+            bytes += getMemoryNumPages(default_mem) << IR::numBytesPerPageLog2;
+         }
+         return bytes;
+      }
 
       void apply(uint64_t receiver, uint64_t account, uint64_t act) override {
          vector<Value> args = {
@@ -59,12 +91,18 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
             if(default_mem) {
-               //reset memory resizes the sandbox'ed memory to the module's init memory size and then
-               // (effectively) memzeros it all
-               resetMemory(default_mem, _module->memories.defs[0].type);
-
-               char* memstart = &memoryRef<char>(getDefaultMemory(_instance), 0);
-               memcpy(memstart, _initial_memory.data(), _initial_memory.size());
+               char* memstart = &memoryRef<char>(default_mem, 0);
+               if(memory_image::get_mode() == memory_reset_mode::cow) {
+                  //resize memory only adjusts the committed size, the image then drops whatever the last
+                  // apply dirtied and lets the pristine pages fault back in
+                  resizeMemory(default_mem, _module->memories.defs[0].type);
+                  _initial_memory.restore_mapped(memstart, getMemoryNumPages(default_mem) << IR::numBytesPerPageLog2);
+               } else {
+                  //reset memory resizes the sandbox'ed memory to the module's init memory size and then
+                  // (effectively) memzeros it all
+                  resetMemory(default_mem, _module->memories.defs[0].type);
+                  memcpy(memstart, _initial_memory.data().data(), _initial_memory.size());
+               }
             }
 
             the_running_instance_context.memory = default_mem;
@@ -84,9 +122,9 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
       }
 
 
-      std::vector<uint8_t>     _initial_memory;
+      memory_image             _initial_memory;
       //naked pointer because ModuleInstance is opaque
-      //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
+      //_instance is deleted by WAVM's object garbage collection, see wavm_runtime::collect_instances
       ModuleInstance*          _instance;
       std::unique_ptr<Module>  _module;
 };
@@ -134,7 +172,16 @@ std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_mo
    ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
    EOS_ASSERT(instance != nullptr, wasm_exception, "Fail to Instantiate WAVM Module");
 
-   return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory);
+   return std::make_unique<wavm_instantiated_module>(instance, std::move(module), std::move(initial_memory));
+}
+
+void wavm_runtime::collect_instances() {
+   std::vector<ObjectInstance*> roots;
+   {
+      std::lock_guard<std::mutex> l(__live_instances_lock);
+      roots.assign(__live_instances.begin(), __live_instances.end());
+   }
+   Runtime::freeUnreferencedObjects(std::move(roots));
 }
 
 void wavm_runtime::immediately_exit_currently_running_module() {
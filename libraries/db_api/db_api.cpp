@@ -8,6 +8,7 @@
 #include <eosio/chain/permission_object.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <limits>
 
 #include <eosio/chain/db_api.hpp>
 #include <eosio/chain/chain_api.h>
@@ -422,6 +423,45 @@ int db_api::db_end_i64( uint64_t code, uint64_t scope, uint64_t table ) {
    return keyval_cache.cache_table( *tab );
 }
 
+int db_api::db_get_i64_many( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count,
+                             char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len ) {
+   FC_ASSERT( offsets_len > count, "offsets must have one more entry than primaries" );
+
+   const auto* tab = find_table( code, scope, table );
+
+   size_t total = 0;
+   offsets[0] = 0;
+   for( size_t i = 0; i < count; i++ ) {
+      const key_value_object* obj = tab ? db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, primaries[i] ) ) : nullptr;
+      if( obj ) {
+         auto s = obj->value.size();
+         // the total is returned as int32_t and stored in uint32_t offsets
+         FC_ASSERT( total + s <= size_t(std::numeric_limits<int32_t>::max()), "rows total more than ${max} bytes", ("max", std::numeric_limits<int32_t>::max()) );
+         if( total + s <= buffer_size ) {
+            memcpy( buffer + total, obj->value.data(), s );
+         }
+         total += s;
+      }
+      offsets[i+1] = total;
+   }
+   return total;
+}
+
+int db_api::db_i64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len ) {
+   const auto* tab = find_table( code, scope, table );
+   if( !tab ) return 0;
+
+   const auto& idx = db.get_index<key_value_index, by_scope_primary>();
+   auto itr = idx.lower_bound( boost::make_tuple( tab->id, lower ) );
+
+   size_t limit = std::min( primaries_len, size_t(std::numeric_limits<int32_t>::max()) );
+   size_t count = 0;
+   for( ; count < limit && itr != idx.end() && itr->t_id == tab->id && itr->primary_key <= upper; ++itr, ++count ) {
+      primaries[count] = itr->primary_key;
+   }
+   return count;
+}
+
 int db_api::db_store_i256( uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size ) {
    return db_store_i256( get_receiver(), scope, table, payer, id, buffer, buffer_size);
 }
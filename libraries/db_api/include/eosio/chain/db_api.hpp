@@ -446,6 +446,26 @@ class db_api {
                secondary_key_helper_t::get(secondary, obj.secondary_key);
             }
 
+            /**
+             *  Copies the entries with lower <= secondary <= upper in index order, no iterator is created for them
+             *  @return the number of entries copied, at most limit
+             */
+            uint32_t range_secondary( uint64_t code, uint64_t scope, uint64_t table, secondary_key_proxy_const_type lower, secondary_key_proxy_const_type upper,
+                                      secondary_key_type* secondaries, uint64_t* primaries, size_t limit ) {
+               auto tab = context.find_table( code, scope, table );
+               if( !tab ) return 0;
+
+               const auto& idx = context.db.get_index< typename chainbase::get_index_type<ObjectType>::type, by_secondary >();
+               auto itr = idx.lower_bound( secondary_key_helper_t::create_tuple( *tab, lower ) );
+
+               uint32_t count = 0;
+               for( ; count < limit && itr != idx.end() && itr->t_id == tab->id && !(upper < itr->secondary_key); ++itr, ++count ) {
+                  if( secondaries ) secondaries[count] = itr->secondary_key;
+                  if( primaries ) primaries[count] = itr->primary_key;
+               }
+               return count;
+            }
+
          private:
             db_api&              context;
             iterator_cache<ObjectType>  itr_cache;
@@ -572,6 +592,9 @@ class db_api {
       int  db_lowerbound_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
       int  db_upperbound_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
       int  db_end_i64( uint64_t code, uint64_t scope, uint64_t table );
+      int  db_get_i64_many( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count,
+                            char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len );
+      int  db_i64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len );
 
       int  db_store_i256( uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size );
       int  db_store_i256( uint64_t code, uint64_t scope, uint64_t table, const account_name& payer, key256_t& id, const char* buffer, size_t buffer_size );
@@ -80,6 +80,18 @@ int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
    return ipc_client::get().db_end_i64(code, scope, table);
 }
 
+int32_t db_get_i64_many(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len) {
+   return ipc_client::get().db_get_i64_many(code, scope, table, primaries, count, buffer, buffer_size, offsets, offsets_len);
+}
+
+int32_t db_i64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len) {
+   return ipc_client::get().db_i64_range(code, scope, table, lower, upper, primaries, primaries_len);
+}
+
+int32_t db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len) {
+   return ipc_client::get().db_idx64_range(code, scope, table, lower, upper, secondaries, secondaries_len, primaries, primaries_len);
+}
+
 
 }
 
@@ -1,10 +1,6 @@
 #include "ipc_client.hpp"
 
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TSimpleServer.h>
-#include <thrift/transport/TServerSocket.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TSocket.h>
+#include <algorithm>
 
 #include <boost/chrono.hpp>
 #include <boost/thread/thread.hpp>
@@ -14,20 +10,14 @@
 #include <softfloat.hpp>
 
 #include <eosio/chain/db_api.hpp>
-#include "thrift/blockingconcurrentqueue.h"
-#include "thrift/readerwriterqueue.h"
-#include "thrift/RpcService.h"
 
 #include <vm_manager.hpp>
 #include <eosiolib_native/vm_api.h>
 
 using namespace eosio::chain;
 
-using namespace ::apache::thrift;
-using namespace ::apache::thrift::protocol;
-using namespace ::apache::thrift::transport;
-using namespace ::apache::thrift::server;
-using namespace  ::cpp;
+//the server answers within its own apply timeout, anything longer means it is gone
+static const int64_t call_timeout_us = 1000000;
 
 
 #include <eosio/chain/db_api.hpp>
@@ -66,69 +56,233 @@ uint32_t ipc_client::get_active_producers( uint64_t* producers, uint32_t buffer_
 }
 
 int32_t ipc_client::db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id,  const void* data, uint32_t len) {
-   std::string _buffer((char*)data, len);
-   rpcclient->db_store_i64(scope, table, payer, id, _buffer);
+   FC_ASSERT(payer != 0, "must specify a valid account to pay for new record");
+   if (can_buffer(payer)) {
+      const write_batch::row* r = batch.find(write_batch::row_key{scope, table, id});
+      FC_ASSERT(r ? r->removed : db_api::get().db_find_i64(get_receiver(), scope, table, id) < 0, "key already exists");
+      int32_t itr = batch.store(scope, table, payer, id, (const char*)data, len);
+      if (batch.full()) {
+         flush();
+      }
+      return itr;
+   }
+   flush();
+
+   shm_message msg = {};
+   msg.call = shm_call_db_store_i64;
+   msg.args[0] = scope;
+   msg.args[1] = table;
+   msg.args[2] = payer;
+   msg.args[3] = id;
+   call(msg, (const char*)data, len);
    return db_api::get().db_find_i64(get_receiver(), scope, table, id);
 }
 
 void ipc_client::db_update_i64( int itr, uint64_t payer, const char* buffer, size_t buffer_size ) {
-   uint64_t code;
-   uint64_t scope;
-   uint64_t _payer;
-   uint64_t table;
-   uint64_t id;
-   db_api::get().db_get_table_i64( itr, code, scope, _payer, table, id );
-   std::string _buffer(buffer, buffer_size);
-   rpcclient->db_update_i64_ex( scope, payer, table, id, _buffer );
+   uint64_t row_payer;
+   write_batch::row_key key = row_key_of(itr, &row_payer);
+   if (payer == 0) {
+      payer = row_payer;
+   }
+   if (can_buffer(payer)) {
+      batch.update(key, payer, buffer, buffer_size);
+      if (!batch.is_provisional(itr)) {
+         batch.shadow(itr, key);
+      }
+      if (batch.full()) {
+         flush();
+      }
+      return;
+   }
+   flush();
+
+   shm_message msg = {};
+   msg.call = shm_call_db_update_i64_ex;
+   msg.args[0] = key.scope;
+   msg.args[1] = payer;
+   msg.args[2] = key.table;
+   msg.args[3] = key.id;
+   call(msg, buffer, buffer_size);
 }
 
 void ipc_client::db_remove_i64( int itr ) {
-   uint64_t code;
-   uint64_t scope;
-   uint64_t payer;
-   uint64_t table;
-   uint64_t id;
-   db_api::get().db_get_table_i64( itr, code, scope, payer, table, id );
-   rpcclient->db_remove_i64_ex(scope, payer, table, id);
+   write_batch::row_key key = row_key_of(itr);
+   if (batching) {
+      batch.remove(key);
+      if (!batch.is_provisional(itr)) {
+         batch.shadow(itr, key);
+         db_api::get().db_remove_i64_ex(itr);
+      }
+      return;
+   }
+
+   shm_message msg = {};
+   msg.call = shm_call_db_remove_i64_ex;
+   msg.args[0] = key.scope;
+   msg.args[2] = key.table;
+   msg.args[3] = key.id;
+   call(msg);
    db_api::get().db_remove_i64_ex(itr);
 }
 
 int32_t ipc_client::db_get_i64(int32_t iterator, void* data, uint32_t len) {
-   return db_api::get().db_get_i64(iterator, (char*)data, len);
+   if (const write_batch::row* r = pending_row(iterator)) {
+      memcpy(data, r->data.data(), std::min<size_t>(r->data.size(), len));
+      return r->data.size();
+   }
+   return db_api::get().db_get_i64(resolve(iterator), (char*)data, len);
 }
 
 int32_t ipc_client::db_get_i64_ex( int itr, uint64_t* primary, char* buffer, size_t buffer_size ) {
-   return db_api::get().db_get_i64_ex(itr, *primary, buffer, buffer_size);
+   write_batch::row_key key;
+   if (const write_batch::row* r = pending_row(itr)) {
+      batch.key_of(itr, key);
+      memcpy(buffer, r->data.data(), std::min(r->data.size(), buffer_size));
+      *primary = key.id;
+      return r->data.size();
+   }
+   return db_api::get().db_get_i64_ex(resolve(itr), *primary, buffer, buffer_size);
 }
 
 const char* ipc_client::db_get_i64_exex( int itr, size_t* buffer_size ) {
-   return db_api::get().db_get_i64_exex( itr,  buffer_size);
+   if (const write_batch::row* r = pending_row(itr)) {
+      *buffer_size = r->data.size();
+      return r->data.data();
+   }
+   return db_api::get().db_get_i64_exex( resolve(itr),  buffer_size);
 }
 
+//the overlay can't order rows, walking a table goes to chainbase once the server has the pending writes
+
 int32_t ipc_client::db_next_i64(int32_t iterator, uint64_t* primary) {
-   return db_api::get().db_next_i64(iterator, *primary);
+   flush();
+   return db_api::get().db_next_i64(resolve(iterator), *primary);
 }
 
 int32_t ipc_client::db_previous_i64(int32_t iterator, uint64_t* primary) {
-   return db_api::get().db_previous_i64(iterator, *primary);
+   flush();
+   return db_api::get().db_previous_i64(resolve(iterator), *primary);
 }
 
 int32_t ipc_client::db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+   if (batching && code == get_receiver()) {
+      write_batch::row_key key = {scope, table, id};
+      const write_batch::row* r = batch.find(key);
+      if (r && r->removed) {
+         return db_api::get().db_end_i64(code, scope, table);
+      } else if (r) {
+         return batch.iterator_of(key);
+      }
+   }
    return db_api::get().db_find_i64(code, scope, table, id);
 }
 
 int32_t ipc_client::db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+   if (code == get_receiver() && batch.is_dirty(scope, table)) {
+      flush();
+   }
    return db_api::get().db_lowerbound_i64(code, scope, table, id);
 }
 
 int32_t ipc_client::db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+   if (code == get_receiver() && batch.is_dirty(scope, table)) {
+      flush();
+   }
    return db_api::get().db_upperbound_i64(code, scope, table, id);
 }
 
 int32_t ipc_client::db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
+   if (code == get_receiver() && batch.is_dirty(scope, table)) {
+      flush();
+   }
    return db_api::get().db_end_i64(code, scope, table);
 }
 
+//one call for a batch of rows, a dirty table is flushed once instead of looking every row up in the overlay
+int32_t ipc_client::db_get_i64_many(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len) {
+   if (code == get_receiver() && batch.is_dirty(scope, table)) {
+      flush();
+   }
+   return db_api::get().db_get_i64_many(code, scope, table, primaries, count, buffer, buffer_size, offsets, offsets_len);
+}
+
+int32_t ipc_client::db_i64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len) {
+   if (code == get_receiver() && batch.is_dirty(scope, table)) {
+      flush();
+   }
+   return db_api::get().db_i64_range(code, scope, table, lower, upper, primaries, primaries_len);
+}
+
+int32_t ipc_client::db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len) {
+   size_t limit = std::min(secondaries_len ? secondaries_len : primaries_len, primaries_len ? primaries_len : secondaries_len);
+   return db_api::get().idx64.range_secondary(code, scope, table, lower, upper, secondaries_len ? secondaries : nullptr, primaries_len ? primaries : nullptr, limit);
+}
+
+void ipc_client::flush() {
+   if (batch.empty()) {
+      return;
+   }
+   shm_message msg = {};
+   msg.call = shm_call_db_batch;
+   msg.args[0] = batch.count();
+   call(msg, batch.ops().data(), batch.ops().size());
+   batch.clear();
+}
+
+//chainbase iterator of a row stored by the batch, only valid once the batch has been flushed
+int32_t ipc_client::resolve(int32_t itr) {
+   write_batch::row_key key;
+   if (!batch.is_provisional(itr)) {
+      return itr;
+   }
+   FC_ASSERT(batch.key_of(itr, key), "invalid iterator");
+   int32_t real = db_api::get().db_find_i64(get_receiver(), key.scope, key.table, key.id);
+   FC_ASSERT(real >= 0, "dereference of deleted object");
+   return real;
+}
+
+const write_batch::row* ipc_client::pending_row(int32_t itr) {
+   write_batch::row_key key;
+   if (!batching || !batch.key_of(itr, key)) {
+      return nullptr;
+   }
+   const write_batch::row* r = batch.find(key);
+   FC_ASSERT(!r || !r->removed, "dereference of deleted object");
+   return r;
+}
+
+write_batch::row_key ipc_client::row_key_of(int32_t itr, uint64_t* payer) {
+   write_batch::row_key key;
+   if (const write_batch::row* r = pending_row(itr)) {
+      batch.key_of(itr, key);
+      if (payer) {
+         *payer = r->payer;
+      }
+      return key;
+   }
+   uint64_t code;
+   uint64_t scope;
+   uint64_t row_payer;
+   uint64_t table;
+   uint64_t id;
+   db_api::get().db_get_table_i64( resolve(itr), code, scope, row_payer, table, id );
+   FC_ASSERT(code == get_receiver(), "db access violation");
+   if (payer) {
+      *payer = row_payer;
+   }
+   return write_batch::row_key{scope, table, id};
+}
+
+/**
+ * Whether a write may wait in the batch. The client checks the key and the access to the table before
+ * buffering, what it can't check is the authorization the server requires for charging ram to an account
+ * other than the receiver. Such writes flush the batch and go to the server on the spot, so that a failing
+ * write fails the call that made it whether batching is on or not
+ */
+bool ipc_client::can_buffer(uint64_t payer) {
+   return batching && payer == get_receiver();
+}
+
 int32_t ipc_client::check_transaction_authorization( const char* trx_data,     uint32_t trx_size,
                                  const char* pubkeys_data, uint32_t pubkeys_size,
                                  const char* perms_data,   uint32_t perms_size
@@ -155,54 +309,72 @@ int32_t ipc_client::check_transaction_authorization( const char* trx_data,     u
       err = e.to_detail_string(); \
    }
 
+int32_t ipc_client::call(shm_message& msg, const char* payload, size_t payload_size) {
+   msg.seq = apply_seq;
+   FC_ASSERT(channel.send(msg, payload, payload_size), "ipc call failed, payload too large or channel full");
+   while (true) {
+      shm_message result;
+      FC_ASSERT(channel.receive(result, call_timeout_us), "ipc server not responding");
+      if (result.seq != msg.seq) {
+         continue;
+      }
+      if (result.call == shm_call_error) {
+         FC_THROW("${e}", ("e", std::string(channel.payload(result), result.payload_size)));
+      }
+      return result.status;
+   }
+}
+
 int ipc_client::start(const char* ipc_dir) {
    while (true) {
-      if (rpcclient) {
-         delete rpcclient;
+      while (!channel.open(ipc_dir)) {
+         wlog("waiting for server...");
+         boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
       }
-      std::string addr("localhost");
-//      stdcxx::shared_ptr<TTransport> socket(new TSocket(addr, 9191));
-      stdcxx::shared_ptr<TTransport> socket(new TSocket(ipc_dir));
-      stdcxx::shared_ptr<TTransport> transport(new TBufferedTransport(socket));
-      stdcxx::shared_ptr<TProtocol> protocol(new TBinaryProtocol(transport));
-      rpcclient = new RpcServiceClient(protocol);
+      wlog("connected to ipc server ${n}", ("n", ipc_dir));
 
       while (true) {
-         try {
-            if (access(ipc_dir, F_OK) == -1) {
-               wlog("waiting for server...");
-               boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
-               continue;
+         shm_message msg;
+         if (!channel.receive(msg, call_timeout_us)) {
+            if (channel.is_stale()) {
+               wlog("ipc server restarted, reconnecting");
+               break;
             }
-            transport->open();
-            break;
-         } catch (...) {
-            wlog("exception in transport->open()!");
+            continue;
+         }
+         if (msg.call == shm_call_ping) {
+            shm_message pong = {};
+            pong.call = shm_call_result;
+            pong.seq = msg.seq;
+            channel.send(pong);
+            continue;
+         } else if (msg.call != shm_call_apply) {
+            continue;
          }
-         boost::this_thread::sleep_for(boost::chrono::milliseconds(500));
-      }
 
-      wlog("transport->open() successfully returned.");
+         apply_seq = msg.seq;
+         batching = msg.args[3] & shm_apply_write_batch;
+         batch.reset();
 
-      while (true) {
+         string err;
+         int ret = 0;
          try {
-            Apply apply;
-            string err;
-            int ret;
-            wlog("+++++++++++apply_request");
-           rpcclient->apply_request(apply);
-           wlog("+++++++++++apply_request return");
-           try {
-              int type = db_api::get().get_code_type(apply.receiver);
-              ret = vm_manager::get().apply(type, apply.receiver, apply.account, apply.action);
-           } FC_CATCH_EXC(err);
-           wlog("+++++++++++++apply_finish ret ${n1} err ${n2}", ("n1", ret)("n2", err));
-           rpcclient->apply_finish(ret, err);
-           wlog("+++++++++++++apply_finish return");
-         } catch (TTransportException& ex) {
-            wlog("+++++++++++=exception ocurr when executing code: ${n}", ("n", ex.what()));
-            break;
+            int type = db_api::get().get_code_type(msg.args[0]);
+            ret = vm_manager::get().apply(type, msg.args[0], msg.args[1], msg.args[2]);
+         } FC_CATCH_EXC(err);
+
+         shm_message finish = {};
+         finish.call = shm_call_apply_finish;
+         finish.seq = msg.seq;
+         finish.status = ret;
+         if (err.empty() && ret == 1 && !batch.empty()) {
+            //the writes that are still pending ride along with the result
+            finish.args[0] = batch.count();
+            channel.send(finish, batch.ops().data(), batch.ops().size());
+         } else {
+            channel.send(finish, err.data(), err.size());
          }
+         batch.reset();
       }
    }
    return 0;
@@ -5,9 +5,8 @@
 #ifndef VM_API_IPC_IPC_CLIENT_CPP_
 #define VM_API_IPC_IPC_CLIENT_CPP_
 
-namespace cpp {
-class RpcServiceClient;
-}
+#include "shm/shm_channel.hpp"
+#include "write_batch.hpp"
 
 class ipc_client {
 public:
@@ -41,6 +40,9 @@ public:
    int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
    int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
    int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table);
+   int32_t db_get_i64_many(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len);
+   int32_t db_i64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len);
+   int32_t db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len);
 
 
    int32_t check_transaction_authorization( const char* trx_data,     uint32_t trx_size,
@@ -51,7 +53,19 @@ public:
    int start(const char* ipc_dir);
 
 private:
-   cpp::RpcServiceClient* rpcclient = nullptr;
+   int32_t call(shm_message& msg, const char* payload = nullptr, size_t payload_size = 0);
+
+   void flush();
+   int32_t resolve(int32_t itr);
+   const write_batch::row* pending_row(int32_t itr);
+   write_batch::row_key row_key_of(int32_t itr, uint64_t* payer = nullptr);
+   bool can_buffer(uint64_t payer);
+
+   shm_channel channel;
+   uint64_t apply_seq = 0;
+
+   bool batching = false;  //set by the server for every apply
+   write_batch batch;
 
 };
 
@@ -0,0 +1,109 @@
+#include "write_batch.hpp"
+
+#include <string.h>
+
+#include "shm/shm_channel.hpp"
+
+void write_batch::reset() {
+   clear();
+   iterators.clear();
+   keys.clear();
+}
+
+void write_batch::clear() {
+   rows.clear();
+   shadowed.clear();
+   dirty_tables.clear();
+   _ops.clear();
+   _count = 0;
+}
+
+bool write_batch::is_dirty(uint64_t scope, uint64_t table) const {
+   return dirty_tables.find(std::make_pair(scope, table)) != dirty_tables.end();
+}
+
+void write_batch::append(uint32_t call, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, const char* data, size_t size) {
+   shm_batch_op op = {};
+   op.call = call;
+   op.size = size;
+   op.args[0] = a0;
+   op.args[1] = a1;
+   op.args[2] = a2;
+   op.args[3] = a3;
+
+   size_t pos = _ops.size();
+   _ops.resize(pos + sizeof(op) + ((size + 7) & ~7));
+   memcpy(&_ops[pos], &op, sizeof(op));
+   if (size > 0) {
+      memcpy(&_ops[pos + sizeof(op)], data, size);
+   }
+   _count++;
+}
+
+int32_t write_batch::store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const char* data, size_t size) {
+   row_key key = {scope, table, id};
+   row& r = rows[key];
+   r.removed = false;
+   r.payer = payer;
+   r.data.assign(data, size);
+   dirty_tables.insert(std::make_pair(scope, table));
+   append(shm_call_db_store_i64, scope, table, payer, id, data, size);
+   return iterator_of(key);
+}
+
+void write_batch::update(const row_key& key, uint64_t payer, const char* data, size_t size) {
+   row& r = rows[key];
+   r.removed = false;
+   r.payer = payer;
+   r.data.assign(data, size);
+   dirty_tables.insert(std::make_pair(key.scope, key.table));
+   append(shm_call_db_update_i64_ex, key.scope, payer, key.table, key.id, data, size);
+}
+
+void write_batch::remove(const row_key& key) {
+   row& r = rows[key];
+   r.removed = true;
+   r.data.clear();
+   dirty_tables.insert(std::make_pair(key.scope, key.table));
+   append(shm_call_db_remove_i64_ex, key.scope, r.payer, key.table, key.id, nullptr, 0);
+}
+
+void write_batch::shadow(int32_t itr, const row_key& key) {
+   shadowed[itr] = key;
+}
+
+const write_batch::row* write_batch::find(const row_key& key) const {
+   auto it = rows.find(key);
+   if (it == rows.end()) {
+      return nullptr;
+   }
+   return &it->second;
+}
+
+bool write_batch::key_of(int32_t itr, row_key& key) const {
+   if (is_provisional(itr)) {
+      size_t index = itr - provisional_base;
+      if (index >= keys.size()) {
+         return false;
+      }
+      key = keys[index];
+      return true;
+   }
+   auto it = shadowed.find(itr);
+   if (it == shadowed.end()) {
+      return false;
+   }
+   key = it->second;
+   return true;
+}
+
+int32_t write_batch::iterator_of(const row_key& key) {
+   auto it = iterators.find(key);
+   if (it != iterators.end()) {
+      return it->second;
+   }
+   int32_t itr = provisional_base + keys.size();
+   keys.push_back(key);
+   iterators[key] = itr;
+   return itr;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * @class write_batch
+ *
+ * Db writes of the running apply that haven't been sent to the server yet.
+ *
+ * Mutations are recorded in order as shm_batch_op records and mirrored in an overlay so that the contract
+ * reads its own writes. Rows stored by the batch get provisional iterators, which are resolved against the
+ * read-only chainbase once the batch has been flushed. Anything the overlay can't answer, like walking a table
+ * with pending writes, has to flush first.
+ */
+class write_batch {
+public:
+   struct row_key {
+      uint64_t scope;
+      uint64_t table;
+      uint64_t id;
+
+      bool operator < (const row_key& other) const {
+         return std::tie(scope, table, id) < std::tie(other.scope, other.table, other.id);
+      }
+   };
+
+   struct row {
+      bool        removed = false;
+      uint64_t    payer = 0;
+      std::string data;
+   };
+
+   //above any iterator db_api hands out
+   static const int32_t provisional_base = 0x40000000;
+   //flush before the batch gets anywhere near the size of the channel arena
+   static const size_t flush_size = 1024*1024;
+
+   /**
+    * Drops everything, provisional iterators included, called at the start of every apply
+    */
+   void reset();
+
+   /**
+    * Drops the pending writes once they reached the server, provisional iterators stay valid
+    */
+   void clear();
+
+   bool empty() const { return _count == 0; }
+   bool full() const { return _ops.size() >= flush_size; }
+   uint32_t count() const { return _count; }
+   const std::string& ops() const { return _ops; }
+
+   bool is_provisional(int32_t itr) const { return itr >= provisional_base; }
+   bool is_dirty(uint64_t scope, uint64_t table) const;
+
+   /**
+    * @return the provisional iterator of the new row
+    */
+   int32_t store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const char* data, size_t size);
+   void update(const row_key& key, uint64_t payer, const char* data, size_t size);
+   void remove(const row_key& key);
+
+   /**
+    * Records that a chainbase iterator points to a row the batch has modified
+    */
+   void shadow(int32_t itr, const row_key& key);
+
+   /**
+    * @return the pending version of a row, nullptr if the batch hasn't touched it
+    */
+   const row* find(const row_key& key) const;
+
+   /**
+    * The key of a provisional or shadowed iterator
+    */
+   bool key_of(int32_t itr, row_key& key) const;
+
+   int32_t iterator_of(const row_key& key);
+
+private:
+   void append(uint32_t call, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, const char* data, size_t size);
+
+   std::map<row_key, row>     rows;
+   std::map<int32_t, row_key> shadowed;
+   std::set<std::pair<uint64_t, uint64_t>> dirty_tables;
+
+   std::map<row_key, int32_t> iterators;
+   std::vector<row_key>       keys; //indexed by provisional iterator - provisional_base
+
+   std::string _ops;
+   uint32_t    _count = 0;
+};
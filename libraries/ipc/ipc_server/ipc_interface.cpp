@@ -4,7 +4,9 @@
 #include <fc/log/logger.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <memory>
@@ -15,16 +17,19 @@ using namespace boost::process;
 using namespace std;
 
 unique_ptr<boost::thread> client_monitor_thread;
-vector<shared_ptr<boost::thread>> server_threads;
-
-vector<shared_ptr<boost::process::child>> client_processes;
 
 static struct vm_api s_vm_api = {};
 static const char* default_ipc_dir = "/tmp";
 static const char* default_data_dir = "data-dir";
+static const int default_workers = 1;
 
-extern "C" int _start_server(const char* ipc_file, int vm_type);
+extern "C" int _start_server(const char* ipc_file, int vm_type, int index);
 extern "C" int server_on_apply(uint64_t receiver, uint64_t account, uint64_t action, char** err, int* len);
+extern "C" void server_set_write_batch(int enable);
+extern "C" int server_worker_healthy(int vm_type, int index);
+extern "C" void server_worker_failed(int vm_type, int index);
+extern "C" int server_ping_worker(int vm_type, int index);
+
 static const char* vm_names[] = {
       "binaryen",
       "py",
@@ -32,75 +37,108 @@ static const char* vm_names[] = {
       "wavm",
 };
 
+struct client_worker {
+   int vm_type;
+   int index;
+   string ipc_file;
+   shared_ptr<boost::process::child> process;
+};
+
+static vector<client_worker> client_workers;
+static std::mutex client_workers_lock;
+
+//how often idle workers are pinged
+static const int ping_interval_ms = 1000;
+
+static void start_worker(client_worker& w) {
+   char cmd[512];
+   char data_dir[128] = {0};
+
+   strcpy(data_dir, default_data_dir);
+   s_vm_api.get_option("data-dir", data_dir, sizeof(data_dir) - 1);
+
+   if (w.process && w.process->running()) {
+      w.process->terminate();
+   }
+   w.process.reset();
+
+   //the channel has to exist before the client looks for it
+   if (!_start_server(w.ipc_file.c_str(), w.vm_type, w.index)) {
+      return;
+   }
+
+   static const char* format = "../libraries/ipc/ipc_client/ipc_client --data-dir %s --config-dir %s --ipc-dir %s --vm-index %d";
+   snprintf(cmd, sizeof(cmd), format, data_dir, data_dir, w.ipc_file.c_str(), w.vm_type);
+   wlog("start ${n}", ("n", cmd));
+   try {
+      w.process.reset(new child((const char*)cmd));
+   } catch ( const std::exception& e ) {
+      elog("start ipc client failed: ${e}", ("e", e.what()));
+      server_worker_failed(w.vm_type, w.index);
+   }
+}
+
 void vm_init(struct vm_api* api) {
    s_vm_api = *api;
 
    client_monitor_thread.reset(new boost::thread([]{
-         do {
-            while (!s_vm_api.app_init_finished()) {
-               boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
-            }
-            for (int vm_type=0;vm_type<4;vm_type++) {
-               char cmd[256];
-               char ipc_dir[128];
-               char data_dir[128];
-
-               strcpy(ipc_dir, default_ipc_dir);
-               strcpy(data_dir, default_data_dir);
-
-               static const char* format = "../libraries/ipc/ipc_client/ipc_client --data-dir %s --config-dir %s --ipc-dir %s/%s.ipc --vm-index %d";
-               s_vm_api.get_option("ipc-dir", ipc_dir, sizeof(ipc_dir));
-               s_vm_api.get_option("data-dir", data_dir, sizeof(data_dir));
-
-               snprintf(cmd, sizeof(cmd), format, data_dir, data_dir, ipc_dir, vm_names[vm_type], vm_type);
-
-               wlog("start ${n}", ("n", cmd));
-               ipstream pipe_stream;
-               shared_ptr<boost::process::child> client_process;
-               client_process.reset(new child((const char*)cmd, std_out > pipe_stream));
-               client_processes.push_back(client_process);
-               /*
-               std::string line;
-               while (pipe_stream && std::getline(pipe_stream, line) && !line.empty()) {
-                  std::cerr << line << std::endl;
-               }
-               */
-            }
-            for (auto& p: client_processes) {
-               p->wait();
-            }
-         } while(false);
-   }));
+      while (!s_vm_api.app_init_finished()) {
+         boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+      }
+
+      char ipc_dir[128] = {0};
+      char option[16] = {0};
+      strcpy(ipc_dir, default_ipc_dir);
+      s_vm_api.get_option("ipc-dir", ipc_dir, sizeof(ipc_dir) - 1);
 
-   for (int vm_type=0;vm_type<4;vm_type++) {
-      shared_ptr<boost::thread> server_thread;
-      server_thread.reset(new boost::thread([vm_type]{
-            while (!s_vm_api.app_init_finished()) {
-               boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+      int workers = default_workers;
+      if (s_vm_api.get_option("ipc-workers", option, sizeof(option) - 1)) {
+         workers = std::max(1, atoi(option));
+      }
+      memset(option, 0, sizeof(option));
+      if (s_vm_api.get_option("ipc-write-batch", option, sizeof(option) - 1) && strcmp(option, "off") == 0) {
+         server_set_write_batch(0);
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(client_workers_lock);
+         for (int vm_type=0;vm_type<4;vm_type++) {
+            for (int i = 0; i < workers; i++) {
+               char ipc_file[256];
+               snprintf(ipc_file, sizeof(ipc_file), "%s/%s-%d.ipc", ipc_dir, vm_names[vm_type], i);
+               client_workers.push_back(client_worker{vm_type, i, ipc_file, nullptr});
+               start_worker(client_workers.back());
             }
+         }
+      }
 
-            char option[128];
-            char ipc_file[128];
-            int ret = s_vm_api.get_option("ipc-dir", option, sizeof(option));
-            if (ret) {
-               snprintf(ipc_file, sizeof(ipc_file), "%s/%s.ipc", option, vm_names[vm_type]);
-            } else {
-               snprintf(ipc_file, sizeof(ipc_file), "%s/%s.ipc", default_ipc_dir, vm_names[vm_type]);
+      //health checks, a worker that died, timed out in an apply or stopped answering pings is respawned
+      while (true) {
+         boost::this_thread::sleep_for(boost::chrono::milliseconds(ping_interval_ms));
+         std::lock_guard<std::mutex> lock(client_workers_lock);
+         for (auto& w: client_workers) {
+            bool alive = w.process && w.process->running();
+            if (alive && server_worker_healthy(w.vm_type, w.index) && server_ping_worker(w.vm_type, w.index)) {
+               continue;
             }
-            _start_server(ipc_file, vm_type);
-      }));
-      server_threads.push_back(server_thread);
-   }
+            wlog("restarting ipc client ${n}", ("n", w.ipc_file));
+            server_worker_failed(w.vm_type, w.index);
+            start_worker(w);
+         }
+      }
+   }));
 }
 
 void vm_deinit() {
    wlog("vm_deinit");
-   for (auto& p: client_processes) {
-      if (!p) {
-         continue;
-      }
-      if (p->running()) {
-         p->terminate();
+   if (client_monitor_thread) {
+      client_monitor_thread->interrupt();
+      client_monitor_thread->join();
+   }
+   std::lock_guard<std::mutex> lock(client_workers_lock);
+   for (auto& w: client_workers) {
+      if (w.process && w.process->running()) {
+         w.process->terminate();
       }
    }
 }
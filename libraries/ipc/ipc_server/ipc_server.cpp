@@ -1,200 +1,302 @@
-#include <thrift/protocol/TBinaryProtocol.h>
-#include <thrift/server/TSimpleServer.h>
-#include <thrift/transport/TServerSocket.h>
-#include <thrift/transport/TBufferTransports.h>
-#include <thrift/transport/TSocket.h>
-
-#include <boost/chrono.hpp>
-#include <boost/thread/thread.hpp>
-
 #include <fc/log/logger.hpp>
+#include <fc/exception/exception.hpp>
 
 #include <softfloat.hpp>
 
 #include <eosio/chain/db_api.hpp>
-#include "thrift/blockingconcurrentqueue.h"
-#include "thrift/readerwriterqueue.h"
-#include "thrift/RpcService.h"
+#include "shm/shm_channel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
+
+#include <errno.h>
+#include <string.h>
 
 #include <eosiolib_native/vm_api.h>
 #include <eosiolib/db.h>
 
 using namespace eosio::chain;
 
-using namespace ::apache::thrift;
-using namespace ::apache::thrift::protocol;
-using namespace ::apache::thrift::transport;
-using namespace ::apache::thrift::server;
+//how long an untrusted contract may run, db calls included
+static const int64_t apply_timeout_us = 100000;
+
+static int32_t serve_batch(const char* ops, size_t size, uint64_t count);
+
+static int32_t serve_db_call(uint32_t call, const uint64_t* args, const char* payload, size_t size) {
+   switch (call) {
+      case shm_call_db_store_i64:
+         //the row is read straight out of the shared arena
+         return ::db_store_i64(args[0], args[1], args[2], args[3], payload, size);
+      case shm_call_db_update_i64_ex:
+         ::db_update_i64_ex(args[0], args[1], args[2], args[3], payload, size);
+         return 0;
+      case shm_call_db_remove_i64_ex:
+         ::db_remove_i64_ex(args[0], args[1], args[2], args[3]);
+         return 0;
+      case shm_call_db_batch:
+         return serve_batch(payload, size, args[0]);
+      default:
+         FC_THROW("unknown ipc call ${n}", ("n", call));
+   }
+}
 
+//applies the writes the client buffered, in the order it made them
+static int32_t serve_batch(const char* ops, size_t size, uint64_t count) {
+   size_t pos = 0;
+   for (uint64_t i = 0; i < count; i++) {
+      shm_batch_op op;
+      FC_ASSERT(size - pos >= sizeof(op), "corrupted ipc write batch");
+      memcpy(&op, ops + pos, sizeof(op));
+      pos += sizeof(op);
+      FC_ASSERT(op.call != shm_call_db_batch && op.size <= size - pos, "corrupted ipc write batch");
+      serve_db_call(op.call, op.args, ops + pos, op.size);
+      pos += std::min<size_t>((op.size + 7) & ~7, size - pos);
+   }
+   return count;
+}
 
-using namespace  ::cpp;
+/**
+ * One client process and the channel to it, a worker serves one apply at a time
+ */
+struct ipc_worker {
+   std::mutex                   lock;
+   std::shared_ptr<shm_channel> channel;
+   std::atomic<bool>            healthy{false};
+   uint64_t                     timeouts = 0;
+   uint64_t                     ping_seq = 0;   //ping still waiting for its answer, 0 if none
+   std::chrono::steady_clock::time_point ping_sent;
+};
 
-using namespace moodycamel;
+static std::map<int, std::vector<std::shared_ptr<ipc_worker>>> worker_map;
+static std::mutex m1;
+static std::atomic<uint64_t> apply_seq{0};
+static std::atomic<bool> write_batch_enabled{true};
 
-struct ApplyFinish {
-   int32_t status;
-   std::string errMsg;
-};
+//a worker that hasn't answered a ping by the first check past this is restarted
+static const int64_t ping_timeout_us = 1000000;
 
-class RpcServiceHandler : virtual public RpcServiceIf {
-private:
-   BlockingConcurrentQueue<Apply> apply_request_queue;
-   BlockingConcurrentQueue<ApplyFinish> apply_finish_queue;
-public:
-  RpcServiceHandler() {
-  }
-
-  bool apply(Apply& apply) {
-     apply_request_queue.enqueue(apply);
-     return true;
-  }
-
-  bool apply_wait(ApplyFinish& finish) {
-     if (!apply_finish_queue.wait_dequeue_timed(finish, std::chrono::milliseconds(100))) {
-        return false;
-     }
-     return true;
-  }
-
-  void apply_request(Apply& _return) {
-     wlog("++++++++++++++apply_request");
-     apply_request_queue.wait_dequeue(_return);
-     wlog("++++++++++++++apply_request return");
-  }
-
-  void apply_finish(const int32_t status, const std::string& errMsg) {
-     wlog("apply_finish");
-     apply_finish_queue.enqueue({status, errMsg});
-  }
-
-  void funCall(std::vector<std::string> & _return, const int64_t callTime, const std::string& funCode, const std::map<std::string, std::string> & paramMap) {
-    // Your implementation goes here
-    printf("funCall\n");
-  }
-
-  void read_action(std::string& _return) {
-    // Your implementation goes here
-    printf("read_action\n");
-  }
-
-  int32_t db_store_i64(const int64_t scope, const int64_t table, const int64_t payer, const int64_t id, const std::string& buffer) {
-    return ::db_store_i64(scope, table, payer, id, buffer.c_str(), buffer.length());
-  }
-
-  void db_update_i64(const int32_t itr, const int64_t payer, const std::string& buffer) {
-     ::db_update_i64(itr, payer, buffer.c_str(), buffer.length());
-  }
-
-  void db_remove_i64(const int32_t itr) {
-     ::db_remove_i64(itr);
-  }
-
-  void db_get_i64(std::string& _return, const int32_t itr) {
-     int size = ::db_get_i64(itr, nullptr, 0);
-     char* buffer = new char[size];
-     ::db_get_i64(itr, buffer, size);
-     _return = std::string(buffer, size);
-     delete[] buffer;
-  }
-
-  void db_next_i64(Result& _return, const int32_t itr) {
-     uint64_t primary = 0;
-     _return.status = ::db_next_i64(itr, &primary);
-     _return.value = std::string((char*)&primary, sizeof(primary));
-  }
-
-  void db_previous_i64(Result& _return, const int32_t itr) {
-     uint64_t primary = 0;
-     _return.status = ::db_previous_i64(itr, &primary);
-     _return.value = std::string((char*)&primary, sizeof(primary));
-  }
-
-  int32_t db_find_i64(const int64_t code, const int64_t scope, const int64_t table, const int64_t id) {
-     return ::db_find_i64(code, scope, table, id);
-  }
-
-  int32_t db_lowerbound_i64(const int64_t code, const int64_t scope, const int64_t table, const int64_t id) {
-     return ::db_lowerbound_i64(code, scope, table, id);
-  }
-
-  int32_t db_upperbound_i64(const int64_t code, const int64_t scope, const int64_t table, const int64_t id) {
-     return ::db_upperbound_i64(code, scope, table, id);
-  }
-
-  int32_t db_end_i64(const int64_t code, const int64_t scope, const int64_t table) {
-     return ::db_end_i64(code, scope, table);
-  }
-
-  void db_update_i64_ex(const int64_t scope, const int64_t payer, const int64_t table, const int64_t id, const std::string& buffer) {
-     ::db_update_i64_ex(scope, payer, table, id, buffer.c_str(), buffer.length());
-  }
-
-  void db_remove_i64_ex(const int64_t scope, const int64_t payer, const int64_t table, const int64_t id) {
-     ::db_remove_i64_ex(scope, payer, table, id);
-  }
+extern "C" void server_set_write_batch(int enable) {
+   write_batch_enabled = enable != 0;
+}
 
-};
+static std::shared_ptr<ipc_worker> get_worker(int vm_type, int index) {
+   std::lock_guard<std::mutex> lock(m1);
+   auto it = worker_map.find(vm_type);
+   if (it == worker_map.end() || index < 0 || index >= (int)it->second.size()) {
+      return nullptr;
+   }
+   return it->second[index];
+}
 
+//the same receiver always lands on the same worker while it's healthy, so its interpreter stays warm
+static std::shared_ptr<ipc_worker> pick_worker(int vm_type, uint64_t receiver) {
+   std::lock_guard<std::mutex> lock(m1);
+   auto it = worker_map.find(vm_type);
+   if (it == worker_map.end() || it->second.empty()) {
+      return nullptr;
+   }
+   auto& workers = it->second;
+   size_t start = (receiver * 0x9E3779B97F4A7C15ULL) >> 32;
+   for (size_t i = 0; i < workers.size(); i++) {
+      auto& w = workers[(start + i) % workers.size()];
+      if (w && w->healthy) {
+         return w;
+      }
+   }
+   return nullptr;
+}
 
-static std::map<int, ::apache::thrift::stdcxx::shared_ptr<RpcServiceHandler>> handler_map;
-static std::mutex m1;
+static int on_apply_error(const std::string& errMsg, char** err, int* len) {
+   wlog(errMsg);
+   *err = (char*)malloc(errMsg.length());
+   memcpy(*err, errMsg.c_str(), errMsg.length());
+   *len = errMsg.length();
+   return 911;
+}
 
-extern "C" int server_on_apply(uint64_t receiver, uint64_t account, uint64_t action, char** err, int* len) {
-   Apply apply;
-   apply.receiver = receiver;
-   apply.account = account;
-   apply.action = action;
-   wlog("++++++++++++on_apply");
+/**
+ * Sends a request to a worker and serves its db calls on this thread until it reports back
+ */
+static int run_request(ipc_worker& w, shm_message& request, char** err, int* len) {
+   shm_channel& channel = *w.channel;
+   request.seq = ++apply_seq;
+   request.args[3] = write_batch_enabled ? shm_apply_write_batch : 0;
+   if (!channel.send(request)) {
+      return on_apply_error("++++on_apply: ipc channel full!", err, len);
+   }
 
-   int vm_type = db_api::get().get_code_type(receiver);
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(apply_timeout_us);
+   while (true) {
+      int64_t remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+      shm_message msg;
+      if (remaining <= 0 || !channel.receive(msg, remaining)) {
+         //the client is stuck in the contract, take it out of rotation until it has been respawned
+         w.timeouts++;
+         w.healthy = false;
+         return on_apply_error("++++on_apply: execution time out!", err, len);
+      }
+      const char* payload = channel.payload(msg);
+
+      if (msg.call == shm_call_apply_finish) {
+         if (msg.seq != request.seq) {
+            continue; //late answer to an apply that already timed out
+         }
+         if (msg.status == 1 && msg.args[0] > 0) {
+            std::string error;
+            try {
+               serve_batch(payload, msg.payload_size, msg.args[0]);
+               *err = nullptr;
+               *len = 0;
+               return msg.status;
+            } catch ( const fc::exception& e ) {
+               error = e.to_detail_string();
+            } catch ( const std::exception& e ) {
+               error = e.what();
+            } catch ( ... ) {
+               error = "unknown exception";
+            }
+            return on_apply_error(error, err, len);
+         }
+         *err = (char*)malloc(msg.payload_size);
+         memcpy(*err, payload, msg.payload_size);
+         *len = msg.payload_size;
+         return msg.status;
+      } else if (msg.call == shm_call_result) {
+         //answer to a ping sent before this apply
+         if (msg.seq == w.ping_seq) {
+            w.ping_seq = 0;
+         }
+         continue;
+      }
+
+      shm_message result = {};
+      result.call = shm_call_result;
+      result.seq = msg.seq;
+      std::string error;
+      if (msg.seq != request.seq) {
+         error = "apply expired";
+      } else {
+         try {
+            result.status = serve_db_call(msg.call, msg.args, payload, msg.payload_size);
+         } catch ( const fc::exception& e ) {
+            error = e.to_detail_string();
+         } catch ( const std::exception& e ) {
+            error = e.what();
+         } catch ( ... ) {
+            error = "unknown exception";
+         }
+      }
+      if (!error.empty()) {
+         result.call = shm_call_error;
+      }
+      channel.send(result, error.data(), error.size());
+   }
+}
 
-   auto& handler = handler_map[vm_type];
-   handler->apply(apply);
+extern "C" int server_on_apply(uint64_t receiver, uint64_t account, uint64_t action, char** err, int* len) {
+   int vm_type = db_api::get().get_code_type(receiver);
 
-   ApplyFinish finish = {};
-   if (!handler->apply_wait(finish)) {
-      std::string errMsg("++++on_apply: execution time out!");
-      wlog(errMsg);
-      *err = (char*)malloc(errMsg.length());
-      memcpy(*err, errMsg.c_str(), errMsg.length());
-      *len = errMsg.length();
-      return 911;
+   std::shared_ptr<ipc_worker> w = pick_worker(vm_type, receiver);
+   if (!w) {
+      return on_apply_error("++++on_apply: ipc server not ready!", err, len);
    }
 
-   *err = (char*)malloc(finish.errMsg.length());
-   memcpy(*err, finish.errMsg.c_str(), finish.errMsg.length());
-   *len = finish.errMsg.length();
-   return finish.status;
+   std::lock_guard<std::mutex> lock(w->lock);
+   shm_message apply = {};
+   apply.call = shm_call_apply;
+   apply.args[0] = receiver;
+   apply.args[1] = account;
+   apply.args[2] = action;
+   return run_request(*w, apply, err, len);
 }
 
-extern "C" int _start_server(const char* ipc_dir, int vm_type) {
-//   rpc_register_cpp_apply_call();
-   if (access(ipc_dir, F_OK) != -1) {
-      unlink(ipc_dir);
+/**
+ * (Re)creates the channel of worker index of vm_type, the client process has to be (re)started after it
+ */
+extern "C" int _start_server(const char* ipc_file, int vm_type, int index) {
+   std::shared_ptr<ipc_worker> w;
+   {
+      std::lock_guard<std::mutex> lock(m1);
+      auto& workers = worker_map[vm_type];
+      if ((int)workers.size() <= index) {
+         workers.resize(index + 1);
+      }
+      if (!workers[index]) {
+         workers[index] = std::make_shared<ipc_worker>();
+      }
+      w = workers[index];
    }
 
-   if (access(ipc_dir, F_OK) != -1) {
-      elog("start server failed, ${n} already in use", ("n", ipc_dir));
+   //waits for a request that is still running against the old client
+   std::lock_guard<std::mutex> lock(w->lock);
+   std::shared_ptr<shm_channel> channel = std::make_shared<shm_channel>();
+   if (!channel->create(ipc_file)) {
+      elog("start server failed, can not create ${n}: ${e}", ("n", ipc_file)("e", strerror(errno)));
+      w->healthy = false;
       return 0;
    }
+   w->channel = channel;
+   w->ping_seq = 0;
+   w->healthy = true;
+   wlog("ipc server ready to go ${n}", ("n", ipc_file));
+   return 1;
+}
 
-   ::apache::thrift::stdcxx::shared_ptr<RpcServiceHandler> handler;
-   {
-      std::lock_guard<std::mutex> lock(m1);
-      handler.reset(new RpcServiceHandler());
-      handler_map[vm_type] = handler;
+extern "C" int server_worker_healthy(int vm_type, int index) {
+   std::shared_ptr<ipc_worker> w = get_worker(vm_type, index);
+   return w && w->healthy;
+}
+
+extern "C" void server_worker_failed(int vm_type, int index) {
+   std::shared_ptr<ipc_worker> w = get_worker(vm_type, index);
+   if (w) {
+      w->healthy = false;
    }
-//   ::apache::thrift::stdcxx::shared_ptr<RpcServiceHandler> handler(handler);
-   ::apache::thrift::stdcxx::shared_ptr<TProcessor> processor(new RpcServiceProcessor(handler));
-   ::apache::thrift::stdcxx::shared_ptr<TServerTransport> serverTransport(new TServerSocket(ipc_dir));
-   ::apache::thrift::stdcxx::shared_ptr<TTransportFactory> transportFactory(new TBufferedTransportFactory());
-   ::apache::thrift::stdcxx::shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
+}
 
-   TSimpleServer server(processor, serverTransport, transportFactory, protocolFactory);
-   wlog("ipc server ready to go ${n}", ("n", ipc_dir));
-   server.serve();
+/**
+ * Checks that an idle worker still answers, a busy one is left alone, the apply timeout covers it.
+ * The ping is only sent here, its answer is collected by the next check or by the next apply, so the lock
+ * of the worker is never held while waiting on the client
+ * @return 0 if the worker has to be restarted
+ */
+extern "C" int server_ping_worker(int vm_type, int index) {
+   std::shared_ptr<ipc_worker> w = get_worker(vm_type, index);
+   if (!w || !w->healthy) {
+      return 0;
+   }
+   std::unique_lock<std::mutex> lock(w->lock, std::try_to_lock);
+   if (!lock.owns_lock()) {
+      return 1;
+   }
 
-  return 1;
-}
+   shm_message msg;
+   while (w->ping_seq && w->channel->receive(msg, 0)) {
+      if (msg.call == shm_call_result && msg.seq == w->ping_seq) {
+         w->ping_seq = 0;
+      }
+   }
+   auto now = std::chrono::steady_clock::now();
+   if (w->ping_seq) {
+      if (now - w->ping_sent < std::chrono::microseconds(ping_timeout_us)) {
+         return 1;
+      }
+      w->healthy = false;
+      return 0;
+   }
 
+   shm_message ping = {};
+   ping.call = shm_call_ping;
+   ping.seq = ++apply_seq;
+   if (!w->channel->send(ping)) {
+      w->healthy = false;
+      return 0;
+   }
+   w->ping_seq = ping.seq;
+   w->ping_sent = now;
+   return 1;
+}
@@ -0,0 +1,259 @@
+#include "shm_channel.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static const uint32_t shm_channel_magic = 0x6d687370; //"pshm"
+static const uint32_t shm_channel_version = 1;
+
+//number of polls before a receiver goes to sleep, a round trip is expected to be well below that.
+//spinning only pays off when the other side runs on another core
+static int spin_count() {
+   static const int count = std::thread::hardware_concurrency() > 1 ? 20000 : 0;
+   return count;
+}
+
+struct shm_channel::ring {
+   alignas(64) std::atomic<uint32_t> head;     //next slot to write, also the futex word
+   alignas(64) std::atomic<uint32_t> tail;     //next slot to read
+   alignas(64) std::atomic<uint32_t> sleeping; //the consumer is waiting on head
+   shm_message slots[ring_size];
+};
+
+struct shm_channel::segment {
+   uint32_t              magic;
+   uint32_t              version;
+   std::atomic<uint32_t> ready;
+   std::atomic<int32_t>  server_pid;
+   std::atomic<int32_t>  client_pid;
+   ring                  to_client;
+   ring                  to_server;
+   char                  client_arena[arena_size]; //payloads sent by the server
+   char                  server_arena[arena_size]; //payloads sent by the client
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory atomics must be lock free");
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#elif defined(__aarch64__)
+   asm volatile("yield");
+#endif
+}
+
+static void wait_on(std::atomic<uint32_t>& word, uint32_t expected, int64_t timeout_us) {
+#if defined(__linux__)
+   //not FUTEX_PRIVATE_FLAG, the word is shared with another process
+   struct timespec ts;
+   struct timespec* pts = nullptr;
+   if (timeout_us >= 0) {
+      ts.tv_sec = timeout_us / 1000000;
+      ts.tv_nsec = (timeout_us % 1000000) * 1000;
+      pts = &ts;
+   }
+   syscall(SYS_futex, &word, FUTEX_WAIT, expected, pts, nullptr, 0);
+#else
+   if (word.load() == expected) {
+      std::this_thread::sleep_for(std::chrono::microseconds(timeout_us >= 0 && timeout_us < 50 ? timeout_us : 50));
+   }
+#endif
+}
+
+static void wake(std::atomic<uint32_t>& word) {
+#if defined(__linux__)
+   syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+shm_channel::~shm_channel() {
+   close();
+}
+
+bool shm_channel::map(int fd, bool init) {
+   if (init && ftruncate(fd, sizeof(segment)) != 0) {
+      return false;
+   }
+   struct stat st;
+   if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(segment)) {
+      return false;
+   }
+   void* p = mmap(nullptr, sizeof(segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (p == MAP_FAILED) {
+      return false;
+   }
+   _segment = (segment*)p;
+   _inode = st.st_ino;
+   _arena_cursor = 0;
+   return true;
+}
+
+bool shm_channel::create(const std::string& path) {
+   close();
+   ::unlink(path.c_str());
+   int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+   if (fd < 0) {
+      return false;
+   }
+   bool ok = map(fd, true);
+   ::close(fd);
+   if (!ok) {
+      ::unlink(path.c_str());
+      return false;
+   }
+   _server = true;
+   _path = path;
+
+   //the file is fresh and zero filled, so are the rings
+   _segment->magic = shm_channel_magic;
+   _segment->version = shm_channel_version;
+   _segment->server_pid = getpid();
+   _segment->ready.store(1, std::memory_order_release);
+   return true;
+}
+
+bool shm_channel::open(const std::string& path) {
+   close();
+   int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+   if (fd < 0) {
+      return false;
+   }
+   bool ok = map(fd, false);
+   ::close(fd);
+   if (!ok) {
+      return false;
+   }
+   if (_segment->ready.load(std::memory_order_acquire) != 1 ||
+       _segment->magic != shm_channel_magic || _segment->version != shm_channel_version) {
+      close();
+      return false;
+   }
+   _server = false;
+   _path = path;
+   _segment->client_pid = getpid();
+   return true;
+}
+
+void shm_channel::close() {
+   if (!_segment) {
+      return;
+   }
+   munmap(_segment, sizeof(segment));
+   _segment = nullptr;
+   if (_server) {
+      ::unlink(_path.c_str());
+   }
+   _path.clear();
+}
+
+bool shm_channel::is_stale() const {
+   struct stat st;
+   return ::stat(_path.c_str(), &st) != 0 || st.st_ino != _inode;
+}
+
+pid_t shm_channel::peer_pid() const {
+   return _server ? _segment->client_pid.load() : _segment->server_pid.load();
+}
+
+shm_channel::ring& shm_channel::out_ring() const {
+   return _server ? _segment->to_client : _segment->to_server;
+}
+
+shm_channel::ring& shm_channel::in_ring() const {
+   return _server ? _segment->to_server : _segment->to_client;
+}
+
+char* shm_channel::out_arena() const {
+   return _server ? _segment->client_arena : _segment->server_arena;
+}
+
+const char* shm_channel::in_arena() const {
+   return _server ? _segment->server_arena : _segment->client_arena;
+}
+
+bool shm_channel::send(shm_message& msg, const char* payload, size_t payload_size) {
+   if (payload_size > arena_size) {
+      return false;
+   }
+   //the previous payloads have been answered already, start over when the arena runs out
+   if (_arena_cursor + payload_size > arena_size) {
+      _arena_cursor = 0;
+   }
+   msg.payload_offset = _arena_cursor;
+   msg.payload_size = payload_size;
+   if (payload_size > 0) {
+      memcpy(out_arena() + _arena_cursor, payload, payload_size);
+      _arena_cursor += (payload_size + 7) & ~7;
+   }
+
+   ring& r = out_ring();
+   uint32_t head = r.head.load(std::memory_order_relaxed);
+   if (head - r.tail.load(std::memory_order_acquire) >= ring_size) {
+      return false;
+   }
+   r.slots[head % ring_size] = msg;
+   r.head.store(head + 1, std::memory_order_release);
+
+   //pairs with the fence in receive, either the receiver sees the new head or we see it sleeping
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   if (r.sleeping.load(std::memory_order_relaxed)) {
+      wake(r.head);
+   }
+   return true;
+}
+
+bool shm_channel::receive(shm_message& msg, int64_t timeout_us) {
+   ring& r = in_ring();
+   const uint32_t tail = r.tail.load(std::memory_order_relaxed);
+   auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+
+   int spins = 0;
+   while (r.head.load(std::memory_order_acquire) == tail) {
+      if (spins < spin_count()) {
+         spins++;
+         cpu_relax();
+         continue;
+      }
+      int64_t remaining = -1;
+      if (timeout_us >= 0) {
+         remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+         if (remaining <= 0) {
+            return false;
+         }
+      }
+      r.sleeping.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (r.head.load(std::memory_order_relaxed) == tail) {
+         wait_on(r.head, tail, remaining);
+      }
+      r.sleeping.store(0, std::memory_order_relaxed);
+   }
+
+   msg = r.slots[tail % ring_size];
+   r.tail.store(tail + 1, std::memory_order_release);
+   if (msg.payload_size > arena_size || msg.payload_offset > arena_size - msg.payload_size) {
+      //never trust offsets coming from the other process
+      msg.payload_offset = 0;
+      msg.payload_size = 0;
+   }
+   return true;
+}
+
+const char* shm_channel::payload(const shm_message& msg) const {
+   return in_arena() + msg.payload_offset;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <string>
+
+/**
+ * Calls exchanged between the ipc server (the node) and an ipc client (the process running untrusted code)
+ */
+enum shm_call : uint32_t {
+   shm_call_apply = 1,         //server -> client: receiver, account, action
+   shm_call_apply_finish,      //client -> server: status, error message or the pending write batch (op count) as payload
+   shm_call_result,            //server -> client: status, optional payload
+   shm_call_error,             //server -> client: error message as payload
+   shm_call_db_store_i64,      //client -> server: scope, table, payer, id, row as payload
+   shm_call_db_update_i64_ex,  //client -> server: scope, payer, table, id, row as payload
+   shm_call_db_remove_i64_ex,  //client -> server: scope, payer, table, id
+   shm_call_db_batch,          //client -> server: op count, shm_batch_op records as payload
+   shm_call_ping,              //server -> client: answered with shm_call_result
+};
+
+//flags of shm_call_apply, passed in args[3]
+enum shm_apply_flags : uint64_t {
+   shm_apply_write_batch = 1,  //buffer db writes in the client and send them in one shm_call_db_batch
+};
+
+struct shm_message {
+   uint32_t call;
+   int32_t  status;
+   uint64_t seq;             //sequence number of the apply this message belongs to
+   uint64_t args[4];
+   uint32_t payload_offset;  //offset of the payload into the arena of the sender
+   uint32_t payload_size;
+};
+
+/**
+ * One buffered db write, followed by size bytes of row data and padding up to the next 8 bytes.
+ * call and args are laid out as in the matching single call message.
+ */
+struct shm_batch_op {
+   uint32_t call;
+   uint32_t size;
+   uint64_t args[4];
+};
+
+/**
+ * @class shm_channel
+ *
+ * Bidirectional message channel over a file mapped in both processes.
+ *
+ * Each direction is a single producer single consumer ring of fixed size messages plus an arena that carries
+ * the payloads, so a row is copied once by the sender and read in place by the receiver. A receiver spins
+ * briefly before it sleeps on a futex, a sender only enters the kernel when the other side is asleep.
+ *
+ * The protocol is a strict request/response one: a payload stays valid until its message has been answered.
+ */
+class shm_channel {
+public:
+   static const uint32_t ring_size = 64;
+   static const uint32_t arena_size = 4*1024*1024;
+
+   shm_channel() = default;
+   shm_channel(const shm_channel&) = delete;
+   shm_channel& operator=(const shm_channel&) = delete;
+   ~shm_channel();
+
+   /**
+    * Creates the channel file at path, replacing whatever was there, server side
+    */
+   bool create(const std::string& path);
+
+   /**
+    * Maps a channel created by the server, client side
+    * @return false if the server hasn't set it up yet
+    */
+   bool open(const std::string& path);
+
+   void close();
+   bool is_open() const { return _segment != nullptr; }
+
+   /**
+    * true if the file at the path this channel was opened from has been replaced, i.e. the server restarted
+    */
+   bool is_stale() const;
+
+   bool send(shm_message& msg, const char* payload = nullptr, size_t payload_size = 0);
+
+   /**
+    * @param timeout_us - how long to wait for a message, negative to wait forever
+    */
+   bool receive(shm_message& msg, int64_t timeout_us);
+
+   /**
+    * The payload of a received message, it points into the mapping
+    */
+   const char* payload(const shm_message& msg) const;
+
+   pid_t peer_pid() const;
+
+private:
+   struct segment;
+   struct ring;
+
+   bool map(int fd, bool init);
+   ring& out_ring() const;
+   ring& in_ring() const;
+   char* out_arena() const;
+   const char* in_arena() const;
+
+   segment* _segment = nullptr;
+   bool     _server = false;
+   uint32_t _arena_cursor = 0;
+   std::string _path;
+   ino_t    _inode = 0;
+};
@@ -16,6 +16,7 @@
 */
 
 #include "LegacyVM.h"
+#include "VMArith.h"
 
 using namespace std;
 using namespace dev;
@@ -408,7 +409,11 @@ void LegacyVM::interpretCases()
 			updateIOGas();
 
 			u256 base = m_SP[0];
+#if EVM_FIXED_ARITH
+			m_SPP[0] = arith::exp(base, expon);
+#else
 			m_SPP[0] = exp256(base, expon);
+#endif
 		}
 		NEXT
 
@@ -432,7 +437,11 @@ void LegacyVM::interpretCases()
 			updateIOGas();
 
 			//pops two items and pushes their product mod 2^256.
+#if EVM_FIXED_ARITH
+			m_SPP[0] = arith::mul(m_SP[0], m_SP[1]);
+#else
 			m_SPP[0] = m_SP[0] * m_SP[1];
+#endif
 		}
 		NEXT
 
@@ -678,7 +687,7 @@ void LegacyVM::interpretCases()
 			ON_OP();
 			updateIOGas();
 
-			m_PC = decodeJumpDest(m_code.data(), m_PC);
+			m_PC = decodeJumpDest(m_code, m_PC);
 		}
 		CONTINUE
 
@@ -688,7 +697,7 @@ void LegacyVM::interpretCases()
 			updateIOGas();
 
 			if (m_SP[0])
-				m_PC = decodeJumpDest(m_code.data(), m_PC);
+				m_PC = decodeJumpDest(m_code, m_PC);
 			else
 				++m_PC;
 		}
@@ -698,7 +707,7 @@ void LegacyVM::interpretCases()
 		{
 			ON_OP();
 			updateIOGas();
-			m_PC = decodeJumpvDest(m_code.data(), m_PC, byte(m_SP[0]));
+			m_PC = decodeJumpvDest(m_code, m_PC, byte(m_SP[0]));
 		}
 		CONTINUE
 
@@ -707,7 +716,7 @@ void LegacyVM::interpretCases()
 			ON_OP();
 			updateIOGas();
 			*m_RP++ = m_PC++;
-			m_PC = decodeJumpDest(m_code.data(), m_PC);
+			m_PC = decodeJumpDest(m_code, m_PC);
 		}
 		CONTINUE
 
@@ -716,7 +725,7 @@ void LegacyVM::interpretCases()
 			ON_OP();
 			updateIOGas();
 			*m_RP++ = m_PC;
-			m_PC = decodeJumpvDest(m_code.data(), m_PC, byte(m_SP[0]));
+			m_PC = decodeJumpvDest(m_code, m_PC, byte(m_SP[0]));
 		}
 		CONTINUE
 
@@ -1363,7 +1372,7 @@ void LegacyVM::interpretCases()
 			off = m_code[m_PC++] << 8;
 			off |= m_code[m_PC++];
 			m_PC += m_code[m_PC];
-			m_SPP[0] = m_pool[off];
+			m_SPP[0] = m_program->pool[off];
 			TRACE_VAL(2, "Retrieved pooled const", m_SPP[0]);
 #else
 			throwBadInstruction();
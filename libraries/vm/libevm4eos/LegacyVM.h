@@ -20,6 +20,7 @@
 #include "Instruction.h"
 #include "VMConfig.h"
 #include "VMFace.h"
+#include "VM.h"
 
 namespace dev
 {
@@ -54,7 +55,6 @@ private:
 	static std::array<InstructionMetric, 256> c_metrics;
 	static void initMetrics();
 	static u256 exp256(u256 _base, u256 _exponent);
-	void copyCode(int);
 	typedef void (LegacyVM::*MemFnPtr)();
 	MemFnPtr m_bounce = 0;
 	MemFnPtr m_onFail = 0;
@@ -67,8 +67,9 @@ private:
 	// space for memory
 	bytes m_mem;
 
-	// space for code
-	bytes m_code;
+	// analysed code shared with other calls to the same code, see VM::loadProgram
+	std::shared_ptr<VMProgram const> m_program;
+	byte const* m_code = nullptr;
 
 	/// RETURNDATA buffer for memory returned from direct subcalls.
 	bytes m_returnData;
@@ -86,9 +87,6 @@ private:
 	std::vector<size_t> m_frameSize;
 #endif
 
-	// constant pool
-	std::vector<u256> m_pool;
-
 	// interpreter state
 	Instruction m_OP;                   // current operation
 	uint64_t    m_PC    = 0;            // program counter
@@ -105,7 +103,6 @@ private:
 
 	// initialize interpreter
 	void initEntry();
-	void optimize();
 
 	// interpreter loop & switch
 	void interpretCases();
@@ -126,8 +123,6 @@ private:
 	void throwDisallowedStateChange();
 	void throwBufferOverrun(bigint const& _enfOfAccess);
 
-	std::vector<uint64_t> m_beginSubs;
-	std::vector<uint64_t> m_jumpDests;
 	int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
 
 	void onOperation();
@@ -17,6 +17,7 @@
 
 #include "interpreter.h"
 #include "VM.h"
+#include "VMArith.h"
 
 #include <eth-buildinfo.h>
 
@@ -182,6 +183,19 @@ void VM::updateIOGas()
     m_io_gas -= m_runGas;
 }
 
+//
+// charge the static gas of the basic block starting at the current pc when metering by block
+//
+void VM::updateBlockGas()
+{
+    // a block that starts with a JUMPDEST is paid for by the JUMPDEST
+    if (m_blockGas && m_code[m_PC] != (byte)Instruction::JUMPDEST)
+    {
+        m_runGas = m_blockGas[m_PC];
+        updateIOGas();
+    }
+}
+
 void VM::updateGas()
 {
     if (m_newMemSize > m_mem.size())
@@ -214,11 +228,8 @@ void VM::fetchInstruction()
     const InstructionMetric& metric = c_metrics[static_cast<size_t>(m_OP)];
     adjustStack(metric.args, metric.ret);
 
-    // FEES...
-    std::array<int64_t, 9> tierStepGas{
-        {VMSchedule::stepGas0, VMSchedule::stepGas1, VMSchedule::stepGas2, VMSchedule::stepGas3,
-            VMSchedule::stepGas4, VMSchedule::stepGas5, VMSchedule::stepGas6, 0, 0}};
-    m_runGas = tierStepGas[static_cast<unsigned>(metric.gasPriceTier)];
+    // FEES... already paid for the whole block when metering by block
+    m_runGas = m_blockGas ? 0 : c_stepGas[static_cast<size_t>(m_OP)];
     m_newMemSize = m_mem.size();
     m_copyMemSize = 0;
 }
@@ -533,7 +544,11 @@ void VM::interpretCases()
             updateIOGas();
 
             u256 base = m_SP[0];
+#if EVM_FIXED_ARITH
+            m_SPP[0] = arith::exp(base, expon);
+#else
             m_SPP[0] = exp256(base, expon);
+#endif
         }
         NEXT
 
@@ -557,7 +572,11 @@ void VM::interpretCases()
             updateIOGas();
 
             //pops two items and pushes their product mod 2^256.
+#if EVM_FIXED_ARITH
+            m_SPP[0] = arith::mul(m_SP[0], m_SP[1]);
+#else
             m_SPP[0] = m_SP[0] * m_SP[1];
+#endif
         }
         NEXT
 
@@ -811,7 +830,7 @@ void VM::interpretCases()
             ON_OP();
             updateIOGas();
 
-            m_PC = decodeJumpDest(m_code.data(), m_PC);
+            m_PC = decodeJumpDest(m_code, m_PC);
         }
         CONTINUE
 
@@ -821,7 +840,7 @@ void VM::interpretCases()
             updateIOGas();
 
             if (m_SP[0])
-                m_PC = decodeJumpDest(m_code.data(), m_PC);
+                m_PC = decodeJumpDest(m_code, m_PC);
             else
                 ++m_PC;
         }
@@ -831,7 +850,7 @@ void VM::interpretCases()
         {
             ON_OP();
             updateIOGas();
-            m_PC = decodeJumpvDest(m_code.data(), m_PC, byte(m_SP[0]));
+            m_PC = decodeJumpvDest(m_code, m_PC, byte(m_SP[0]));
         }
         CONTINUE
 
@@ -840,7 +859,7 @@ void VM::interpretCases()
             ON_OP();
             updateIOGas();
             *m_RP++ = m_PC++;
-            m_PC = decodeJumpDest(m_code.data(), m_PC);
+            m_PC = decodeJumpDest(m_code, m_PC);
         }
         CONTINUE
 
@@ -849,7 +868,7 @@ void VM::interpretCases()
             ON_OP();
             updateIOGas();
             *m_RP++ = m_PC;
-            m_PC = decodeJumpvDest(m_code.data(), m_PC, byte(m_SP[0]));
+            m_PC = decodeJumpvDest(m_code, m_PC, byte(m_SP[0]));
         }
         CONTINUE
 
@@ -1535,7 +1554,7 @@ void VM::interpretCases()
             off = m_code[m_PC++] << 8;
             off |= m_code[m_PC++];
             m_PC += m_code[m_PC];
-            m_SPP[0] = m_pool[off];
+            m_SPP[0] = m_program->pool[off];
             TRACE_VAL(2, "Retrieved pooled const", m_SPP[0]);
 #else
             throwBadInstruction();
@@ -1613,7 +1632,10 @@ void VM::interpretCases()
             if (m_SP[1])
                 m_PC = verifyJumpDest(m_SP[0]);
             else
+            {
                 ++m_PC;
+                updateBlockGas();
+            }
         }
         CONTINUE
 
@@ -1639,7 +1661,10 @@ void VM::interpretCases()
             if (m_SP[1])
                 m_PC = uint64_t(m_SP[0]);
             else
+            {
                 ++m_PC;
+                updateBlockGas();
+            }
 #else
             throwBadInstruction();
 #endif
@@ -1754,12 +1779,18 @@ void VM::interpretCases()
             updateIOGas();
 
             m_SPP[0] = m_io_gas;
+
+            // the rest of the block is only paid for after the gas left has been read
+            ++m_PC;
+            updateBlockGas();
         }
-        NEXT
+        CONTINUE
 
         CASE(JUMPDEST)
         {
             m_runGas = VMSchedule::jumpdestGas;
+            if (m_blockGas)
+                m_runGas += m_blockGas[m_PC];
             ON_OP();
             updateIOGas();
         }
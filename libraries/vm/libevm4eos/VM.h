@@ -58,6 +58,17 @@ struct VMSchedule
     static constexpr int64_t callNewAccount = 25000;
 };
 
+/// Code as the interpreter runs it, analysed once and shared by every call to the same code
+struct VMProgram
+{
+    bytes original;                    // code as deployed, compared on a cache hit
+    bytes code;                        // padded copy with the first pass optimizations applied
+    std::vector<uint64_t> jumpDests;   // sorted, for verifyJumpDest
+    std::vector<uint64_t> beginSubs;
+    std::vector<u256> pool;            // constant pool of PUSHC
+    std::vector<uint32_t> blockGas;    // static gas of the basic block starting at a pc, empty to meter per op
+};
+
 class VM : public evmc_instance
 {
 public:
@@ -80,6 +91,11 @@ public:
     };
 
     uint64_t m_io_gas = 0;
+
+    /// Get the analysed program for the code, from the cache when the same code ran before.
+    /// LegacyVM runs the same first pass and shares the cache.
+    static std::shared_ptr<VMProgram const> loadProgram(h256 const& _codeHash, bytesConstRef _code);
+
 private:
     evmc_context* m_context = nullptr;
     evmc_revision m_rev = EVMC_FRONTIER;
@@ -87,9 +103,9 @@ private:
     boost::optional<evmc_tx_context> m_tx_context;
 
     static std::array<InstructionMetric, 256> c_metrics;
+    static std::array<uint64_t, 256> c_stepGas;
     static void initMetrics();
     static u256 exp256(u256 _base, u256 _exponent);
-    void copyCode(int);
     typedef void (VM::*MemFnPtr)();
     MemFnPtr m_bounce = nullptr;
     uint64_t m_nSteps = 0;
@@ -102,8 +118,11 @@ private:
 
     uint8_t const* m_pCode = nullptr;
     size_t m_codeSize = 0;
-    // space for code
-    bytes m_code;
+
+    // analysed code, m_code and m_blockGas point into it
+    std::shared_ptr<VMProgram const> m_program;
+    byte const* m_code = nullptr;
+    uint32_t const* m_blockGas = nullptr;
 
     /// RETURNDATA buffer for memory returned from direct subcalls.
     bytes m_returnData;
@@ -121,9 +140,6 @@ private:
     std::vector<size_t> m_frameSize;
 #endif
 
-    // constant pool
-    std::vector<u256> m_pool;
-
     // interpreter state
     Instruction m_OP;         // current operation
     uint64_t m_PC = 0;        // program counter
@@ -140,7 +156,8 @@ private:
 
     // initialize interpreter
     void initEntry();
-    void optimize();
+    static void optimize(VMProgram& _program);
+    static void measureBlocks(VMProgram& _program);
 
     // interpreter loop & switch
     void interpretCases();
@@ -163,8 +180,6 @@ private:
     void throwDisallowedStateChange();
     void throwBufferOverrun(bigint const& _enfOfAccess);
 
-    std::vector<uint64_t> m_beginSubs;
-    std::vector<uint64_t> m_jumpDests;
     int64_t verifyJumpDest(u256 const& _dest, bool _throw = true);
 
     void onOperation() {}
@@ -172,6 +187,7 @@ private:
     uint64_t gasForMem(u512 _size);
     void updateSSGas();
     void updateIOGas();
+    void updateBlockGas();
     void updateGas();
     void updateMem(uint64_t _newMem);
     void logGasMem();
@@ -0,0 +1,225 @@
+/*
+    This file is part of cpp-ethereum.
+
+    cpp-ethereum is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cpp-ethereum is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "VMArith.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace dev
+{
+namespace eth
+{
+namespace arith
+{
+namespace
+{
+using boost::multiprecision::limb_type;
+static_assert(sizeof(limb_type) == sizeof(uint64_t), "limbs are expected to be 64 bit");
+
+using uint128 = unsigned __int128;
+
+// o_r may alias an operand
+inline void mulLowImpl(uint64_t* o_r, uint64_t const* _a, uint64_t const* _b)
+{
+    uint128 p;
+    uint64_t r0, r1, r2, r3, c;
+
+    p = uint128(_a[0]) * _b[0]; r0 = uint64_t(p); c = uint64_t(p >> 64);
+    p = uint128(_a[0]) * _b[1] + c; r1 = uint64_t(p); c = uint64_t(p >> 64);
+    p = uint128(_a[0]) * _b[2] + c; r2 = uint64_t(p); c = uint64_t(p >> 64);
+    r3 = _a[0] * _b[3] + c;
+
+    p = uint128(_a[1]) * _b[0] + r1; r1 = uint64_t(p); c = uint64_t(p >> 64);
+    p = uint128(_a[1]) * _b[1] + r2 + c; r2 = uint64_t(p); c = uint64_t(p >> 64);
+    r3 += _a[1] * _b[2] + c;
+
+    p = uint128(_a[2]) * _b[0] + r2; r2 = uint64_t(p); c = uint64_t(p >> 64);
+    r3 += _a[2] * _b[1] + c;
+
+    r3 += _a[3] * _b[0];
+
+    o_r[0] = r0;
+    o_r[1] = r1;
+    o_r[2] = r2;
+    o_r[3] = r3;
+}
+
+// exponentiation by squaring, mod 2^256
+inline void expImpl(uint64_t* o_r, uint64_t const* _base, uint64_t const* _exponent)
+{
+    uint64_t base[4] = {_base[0], _base[1], _base[2], _base[3]};
+    uint64_t r[4] = {1, 0, 0, 0};
+
+    unsigned top = 4;
+    while (top && !_exponent[top - 1])
+        --top;
+    for (unsigned i = 0; i < top; ++i)
+    {
+        uint64_t bits = _exponent[i];
+        bool const last = i + 1 == top;
+        for (unsigned b = 0; b < 64; ++b)
+        {
+            if (bits & 1)
+                mulLowImpl(r, r, base);
+            bits >>= 1;
+            if (last && !bits)
+                break;
+            mulLowImpl(base, base, base);
+        }
+    }
+    for (unsigned i = 0; i < 4; ++i)
+        o_r[i] = r[i];
+}
+
+using KernelFn = void (*)(uint64_t*, uint64_t const*, uint64_t const*);
+
+void mulLowPortable(uint64_t* o_r, uint64_t const* _a, uint64_t const* _b) { mulLowImpl(o_r, _a, _b); }
+void expPortable(uint64_t* o_r, uint64_t const* _a, uint64_t const* _b) { expImpl(o_r, _a, _b); }
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define EVM_ARITH_BMI2 1
+__attribute__((target("bmi2"))) void mulLowBmi2(uint64_t* o_r, uint64_t const* _a, uint64_t const* _b) { mulLowImpl(o_r, _a, _b); }
+__attribute__((target("bmi2"))) void expBmi2(uint64_t* o_r, uint64_t const* _a, uint64_t const* _b) { expImpl(o_r, _a, _b); }
+#endif
+
+struct Kernels
+{
+    KernelFn mulLow;
+    KernelFn exp;
+    char const* name;
+};
+
+Kernels const c_portable{&mulLowPortable, &expPortable, "portable"};
+#if EVM_ARITH_BMI2
+Kernels const c_bmi2{&mulLowBmi2, &expBmi2, "bmi2"};
+#endif
+
+bool hasBmi2()
+{
+#if EVM_ARITH_BMI2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+Kernels const& selected()
+{
+    static Kernels const& k = []() -> Kernels const& {
+#if EVM_ARITH_BMI2
+        if (hasBmi2())
+            return c_bmi2;
+#endif
+        return c_portable;
+    }();
+    return k;
+}
+
+Kernels const& named(char const* _name)
+{
+#if EVM_ARITH_BMI2
+    if (!strcmp(_name, c_bmi2.name))
+    {
+        assert(hasBmi2());
+        return c_bmi2;
+    }
+#endif
+    assert(!strcmp(_name, c_portable.name));
+    return c_portable;
+}
+
+u256 mulOn(Kernels const& _k, u256 const& _a, u256 const& _b)
+{
+    Limbs r;
+    Limbs const a = toLimbs(_a);
+    Limbs const b = toLimbs(_b);
+    _k.mulLow(r.data(), a.data(), b.data());
+    return fromLimbs(r);
+}
+
+u256 expOn(Kernels const& _k, u256 const& _base, u256 const& _exponent)
+{
+    Limbs r;
+    Limbs const base = toLimbs(_base);
+    Limbs const e = toLimbs(_exponent);
+    _k.exp(r.data(), base.data(), e.data());
+    return fromLimbs(r);
+}
+}
+
+Limbs toLimbs(u256 const& _v)
+{
+    Limbs l = {{0, 0, 0, 0}};
+    auto const& backend = _v.backend();
+    std::copy(backend.limbs(), backend.limbs() + backend.size(), l.begin());
+    return l;
+}
+
+u256 fromLimbs(Limbs const& _l)
+{
+    u256 r;
+    auto& backend = r.backend();
+    backend.resize(4, 4);
+    std::copy(_l.begin(), _l.end(), backend.limbs());
+    backend.normalize();
+    return r;
+}
+
+void mul(Limbs& o_r, Limbs const& _a, Limbs const& _b)
+{
+    selected().mulLow(o_r.data(), _a.data(), _b.data());
+}
+
+u256 mul(u256 const& _a, u256 const& _b)
+{
+    return mulOn(selected(), _a, _b);
+}
+
+u256 exp(u256 const& _base, u256 const& _exponent)
+{
+    return expOn(selected(), _base, _exponent);
+}
+
+char const* kernels()
+{
+    return selected().name;
+}
+
+std::vector<char const*> supportedKernels()
+{
+    std::vector<char const*> names{c_portable.name};
+#if EVM_ARITH_BMI2
+    if (hasBmi2())
+        names.push_back(c_bmi2.name);
+#endif
+    return names;
+}
+
+u256 mul(u256 const& _a, u256 const& _b, char const* _kernels)
+{
+    return mulOn(named(_kernels), _a, _b);
+}
+
+u256 exp(u256 const& _base, u256 const& _exponent, char const* _kernels)
+{
+    return expOn(named(_kernels), _base, _exponent);
+}
+}
+}
+}
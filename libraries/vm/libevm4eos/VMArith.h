@@ -0,0 +1,60 @@
+/*
+    This file is part of cpp-ethereum.
+
+    cpp-ethereum is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    cpp-ethereum is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include "Common.h"
+
+#include <array>
+
+namespace dev
+{
+namespace eth
+{
+///////////////////////////////////////////////////////////////////////////////
+//
+// fixed width 256 bit arithmetic
+//
+// Words are four 64 bit limbs, least significant first. The kernels work on the limbs directly
+// instead of going through the generic cpp_int code, products use 64x64->128 bit multiplies.
+// The multiply kernels are picked on first use: a BMI2 build (mulx) when the cpu has it,
+// portable code otherwise.
+//
+namespace arith
+{
+using Limbs = std::array<uint64_t, 4>;
+
+Limbs toLimbs(u256 const& _v);
+u256 fromLimbs(Limbs const& _l);
+
+/// low 256 bits of the product
+void mul(Limbs& o_r, Limbs const& _a, Limbs const& _b);
+
+u256 mul(u256 const& _a, u256 const& _b);
+u256 exp(u256 const& _base, u256 const& _exponent);
+
+/// name of the multiply kernels in use, "bmi2" or "portable"
+char const* kernels();
+
+/// names of the kernels this cpu can run, for tests
+std::vector<char const*> supportedKernels();
+
+/// mul and exp on the named kernels instead of the selected ones, for tests
+u256 mul(u256 const& _a, u256 const& _b, char const* _kernels);
+u256 exp(u256 const& _base, u256 const& _exponent, char const* _kernels);
+}
+}
+}
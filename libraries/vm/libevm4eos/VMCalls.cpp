@@ -91,7 +91,7 @@ int64_t VM::verifyJumpDest(u256 const& _dest, bool _throw)
         // check for within bounds and to a jump destination
         // use binary search of array because hashtable collisions are exploitable
         uint64_t pc = uint64_t(_dest);
-        if (std::binary_search(m_jumpDests.begin(), m_jumpDests.end(), pc))
+        if (std::binary_search(m_program->jumpDests.begin(), m_program->jumpDests.end(), pc))
             return pc;
     }
     if (_throw)
@@ -171,6 +171,7 @@ void VM::caseCreate()
     else
         m_SPP[0] = 0;
     ++m_PC;
+    updateBlockGas();
 }
 
 void VM::caseCall()
@@ -203,6 +204,7 @@ void VM::caseCall()
         m_io_gas += msg.gas;
     }
     ++m_PC;
+    updateBlockGas();
 }
 
 bool VM::caseCallSetup(evmc_message& o_msg, bytesRef& o_output)
@@ -37,6 +37,8 @@ namespace eth
 //
 // EVM_REPLACE_CONST_JUMP - pre-verified jumps to save runtime lookup
 //
+// EVM_FIXED_ARITH        - MUL and EXP on fixed width limbs (VMArith.h) instead of cpp_int
+//
 // EVM_TRACE              - provides various levels of tracing
 
 #ifndef EIP_615
@@ -62,6 +64,10 @@ namespace eth
 #define EVM_SWITCH_DISPATCH true
 #endif
 
+#ifndef EVM_FIXED_ARITH
+#define EVM_FIXED_ARITH true
+#endif
+
 #ifndef EVM_OPTIMIZE
 #define EVM_OPTIMIZE false
 #endif
@@ -17,49 +17,164 @@
 
 #include "VM.h"
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 namespace dev
 {
 namespace eth
 {
+namespace
+{
+// programs kept for reuse, the least recently run one is dropped past this
+constexpr size_t c_maxPrograms = 256;
+
+// static gas of a block is kept in 32 bits, longer code is metered per op
+constexpr size_t c_maxBlockGasCode = 1024 * 1024;
+
+class ProgramCache
+{
+public:
+    std::shared_ptr<VMProgram const> find(h256 const& _codeHash, bytesConstRef _code)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_programs.find(_codeHash);
+        if (it == m_programs.end())
+            return nullptr;
+
+        // the hash comes from the host, only trust it along with the code it was computed from
+        bytes const& original = it->second.program->original;
+        if (original.size() != _code.size() || !std::equal(original.begin(), original.end(), _code.begin()))
+            return nullptr;
+
+        m_lru.splice(m_lru.end(), m_lru, it->second.lru);
+        return it->second.program;
+    }
+
+    void insert(h256 const& _codeHash, std::shared_ptr<VMProgram const> const& _program)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_programs.find(_codeHash);
+        if (it != m_programs.end())
+        {
+            it->second.program = _program;
+            m_lru.splice(m_lru.end(), m_lru, it->second.lru);
+            return;
+        }
+
+        if (m_programs.size() >= c_maxPrograms)
+        {
+            m_programs.erase(m_lru.front());
+            m_lru.pop_front();
+        }
+        m_lru.push_back(_codeHash);
+        m_programs[_codeHash] = Entry{_program, std::prev(m_lru.end())};
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<VMProgram const> program;
+        std::list<h256>::iterator lru;
+    };
+
+    std::mutex m_mutex;
+    std::list<h256> m_lru;
+    std::unordered_map<h256, Entry> m_programs;
+};
+
+ProgramCache& programCache()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+// true if the gas left can be observed after op, or if execution can leave the block there
+bool endsBlock(Instruction _op)
+{
+    switch (_op)
+    {
+    case Instruction::STOP:
+    case Instruction::JUMP:
+    case Instruction::JUMPI:
+    case Instruction::GAS:
+    case Instruction::CREATE:
+    case Instruction::CREATE2:
+    case Instruction::CALL:
+    case Instruction::CALLCODE:
+    case Instruction::DELEGATECALL:
+    case Instruction::STATICCALL:
+    case Instruction::RETURN:
+    case Instruction::REVERT:
+    case Instruction::INVALID:
+    case Instruction::SUICIDE:
+        return true;
+    default:
+        return false;
+    }
+}
+}
+
 std::array<InstructionMetric, 256> VM::c_metrics;
+std::array<uint64_t, 256> VM::c_stepGas;
 void VM::initMetrics()
 {
     static bool done = []() {
+        std::array<int64_t, 9> tierStepGas{
+            {VMSchedule::stepGas0, VMSchedule::stepGas1, VMSchedule::stepGas2, VMSchedule::stepGas3,
+                VMSchedule::stepGas4, VMSchedule::stepGas5, VMSchedule::stepGas6, 0, 0}};
         for (unsigned i = 0; i < 256; ++i)
         {
             InstructionInfo op = instructionInfo((Instruction)i);
             c_metrics[i].gasPriceTier = op.gasPriceTier;
             c_metrics[i].args = op.args;
             c_metrics[i].ret = op.ret;
+            c_stepGas[i] = tierStepGas[static_cast<unsigned>(op.gasPriceTier)];
         }
         return true;
     }();
     (void)done;
 }
 
-void VM::copyCode(int _extraBytes)
+//
+// Get the analysed program for the code, from the cache when the same code ran before.
+//
+std::shared_ptr<VMProgram const> VM::loadProgram(h256 const& _codeHash, bytesConstRef _code)
 {
-    // Copy code so that it can be safely modified and extend code by
-    // _extraBytes zero bytes to allow reading virtual data at the end
-    // of the code without bounds checks.
-    auto extendedSize = m_codeSize + _extraBytes;
-    m_code.reserve(extendedSize);
-    m_code.assign(m_pCode, m_pCode + m_codeSize);
-    m_code.resize(extendedSize);
+    if (_codeHash)
+    {
+        if (auto program = programCache().find(_codeHash, _code))
+            return program;
+    }
+
+    auto program = std::make_shared<VMProgram>();
+    program->original.assign(_code.begin(), _code.end());
+    optimize(*program);
+    measureBlocks(*program);
+
+    if (_codeHash)
+        programCache().insert(_codeHash, program);
+    return program;
 }
 
-void VM::optimize()
+void VM::optimize(VMProgram& _program)
 {
-    copyCode(33);
-
-    size_t const nBytes = m_codeSize;
+    // Copy code so that it can be safely modified and extend code by
+    // 33 zero bytes to allow reading virtual data at the end
+    // of the code without bounds checks.
+    bytes& code = _program.code;
+    size_t const nBytes = _program.original.size();
+    code.reserve(nBytes + 33);
+    code.assign(_program.original.begin(), _program.original.end());
+    code.resize(nBytes + 33);
 
     // build a table of jump destinations for use in verifyJumpDest
     
     TRACE_STR(1, "Build JUMPDEST table")
     for (size_t pc = 0; pc < nBytes; ++pc)
     {
-        Instruction op = Instruction(m_code[pc]);
+        Instruction op = Instruction(code[pc]);
         TRACE_OP(2, pc, op);
                 
         // make synthetic ops in user code trigger invalid instruction if run
@@ -70,12 +185,12 @@ void VM::optimize()
         )
         {
             TRACE_OP(1, pc, op);
-            m_code[pc] = (byte)Instruction::INVALID;
+            code[pc] = (byte)Instruction::INVALID;
         }
 
         if (op == Instruction::JUMPDEST)
         {
-            m_jumpDests.push_back(pc);
+            _program.jumpDests.push_back(pc);
         }
         else if (
             (byte)Instruction::PUSH1 <= (byte)op &&
@@ -96,11 +211,11 @@ void VM::optimize()
         else if (op == Instruction::JUMPV || op == Instruction::JUMPSUBV)
         {
             ++pc;
-            pc += 4 * m_code[pc];  // number of 4-byte dests followed by table
+            pc += 4 * code[pc];  // number of 4-byte dests followed by table
         }
         else if (op == Instruction::BEGINSUB)
         {
-            m_beginSubs.push_back(pc);
+            _program.beginSubs.push_back(pc);
         }
         else if (op == Instruction::BEGINDATA)
         {
@@ -115,16 +230,16 @@ void VM::optimize()
     for (size_t pc = 0; pc < nBytes; ++pc)
     {
         u256 val = 0;
-        Instruction op = Instruction(m_code[pc]);
+        Instruction op = Instruction(code[pc]);
 
         if ((byte)Instruction::PUSH1 <= (byte)op && (byte)op <= (byte)Instruction::PUSH32)
         {
             byte nPush = (byte)op - (byte)Instruction::PUSH1 + 1;
 
             // decode pushed bytes to integral value
-            val = m_code[pc+1];
+            val = code[pc+1];
             for (uint64_t i = pc+2, n = nPush; --n; ++i) {
-                val = (val << 8) | m_code[i];
+                val = (val << 8) | code[i];
             }
 
         #if EVM_USE_CONSTANT_POOL
@@ -134,16 +249,16 @@ void VM::optimize()
             // followed by one byte count of remaining pushed bytes
             if (5 < nPush)
             {
-                uint16_t pool_off = m_pool.size();
+                uint16_t pool_off = _program.pool.size();
                 TRACE_VAL(1, "stash", val);
                 TRACE_VAL(1, "... in pool at offset" , pool_off);
-                m_pool.push_back(val);
+                _program.pool.push_back(val);
 
                 TRACE_PRE_OPT(1, pc, op);
-                m_code[pc] = byte(op = Instruction::PUSHC);
-                m_code[pc+3] = nPush - 2;
-                m_code[pc+2] = pool_off & 0xff;
-                m_code[pc+1] = pool_off >> 8;
+                code[pc] = byte(op = Instruction::PUSHC);
+                code[pc+3] = nPush - 2;
+                code[pc+2] = pool_off & 0xff;
+                code[pc+1] = pool_off >> 8;
                 TRACE_POST_OPT(1, pc, op);
             }
 
@@ -155,14 +270,16 @@ void VM::optimize()
             // outer loop is N = number of bytes in code array
             // so complexity is N log M, worst case is N log N
             size_t i = pc + nPush + 1;
-            op = Instruction(m_code[i]);
+            op = Instruction(code[i]);
+            bool const isJumpDest = val <= 0x7FFFFFFFFFFFFFFF &&
+                std::binary_search(_program.jumpDests.begin(), _program.jumpDests.end(), uint64_t(val));
             if (op == Instruction::JUMP)
             {
                 TRACE_VAL(1, "Replace const JUMP with JUMPC to", val)
                 TRACE_PRE_OPT(1, i, op);
                 
-                if (0 <= verifyJumpDest(val, false))
-                    m_code[i] = byte(op = Instruction::JUMPC);
+                if (isJumpDest)
+                    code[i] = byte(op = Instruction::JUMPC);
                 
                 TRACE_POST_OPT(1, i, op);
             }
@@ -171,8 +288,8 @@ void VM::optimize()
                 TRACE_VAL(1, "Replace const JUMPI with JUMPCI to", val)
                 TRACE_PRE_OPT(1, i, op);
                 
-                if (0 <= verifyJumpDest(val, false))
-                    m_code[i] = byte(op = Instruction::JUMPCI);
+                if (isJumpDest)
+                    code[i] = byte(op = Instruction::JUMPCI);
                 
                 TRACE_POST_OPT(1, i, op);
             }
@@ -185,6 +302,60 @@ void VM::optimize()
 #endif    
 }
 
+//
+// Sum the static gas of each basic block so that the interpreter can charge it once per block.
+//
+// A block starts at a JUMPDEST or after an op that ends one and runs until the next op that ends
+// one, without anything in between that can see the gas left. Running out of gas anywhere in a
+// block fails the call the same way, so paying for the whole block up front gives the same results
+// as paying op by op. Dynamic gas is still charged by the op itself.
+//
+void VM::measureBlocks(VMProgram& _program)
+{
+#if EIP_615 || EIP_616
+    (void)_program;
+#else
+    bytes const& code = _program.original;
+    size_t const nBytes = code.size();
+    if (nBytes > c_maxBlockGasCode)
+        return;
+
+    initMetrics();
+    _program.blockGas.assign(_program.code.size(), 0);
+
+    size_t start = 0;
+    uint64_t gas = 0;
+    for (size_t pc = 0; pc < nBytes; ++pc)
+    {
+        Instruction op = Instruction(code[pc]);
+
+        // synthetic ops in user code were replaced by INVALID
+        if (op == Instruction::PUSHC || op == Instruction::JUMPC || op == Instruction::JUMPCI)
+            op = Instruction::INVALID;
+
+        if (op == Instruction::JUMPDEST && pc != start)
+        {
+            _program.blockGas[start] = gas;
+            start = pc;
+            gas = 0;
+        }
+
+        gas += c_stepGas[(size_t)op];
+        if ((byte)Instruction::PUSH1 <= (byte)op && (byte)op <= (byte)Instruction::PUSH32)
+            pc += (byte)op - (byte)Instruction::PUSH1 + 1;
+
+        if (endsBlock(op))
+        {
+            _program.blockGas[start] = gas;
+            start = pc + 1;
+            gas = 0;
+        }
+    }
+    if (start < _program.blockGas.size())
+        _program.blockGas[start] = gas;
+#endif
+}
+
 
 //
 // Init interpreter on entry.
@@ -193,7 +364,14 @@ void VM::initEntry()
 {
     m_bounce = &VM::interpretCases;     
     initMetrics();
-    optimize();
+
+    h256 codeHash(m_message->code_hash.bytes, h256::ConstructFromPointer);
+    m_program = loadProgram(codeHash, bytesConstRef(m_pCode, m_codeSize));
+    m_code = m_program->code.data();
+    m_blockGas = m_program->blockGas.empty() ? nullptr : m_program->blockGas.data();
+
+    // pay for the block at the entry point
+    updateBlockGas();
 }
 
 
@@ -91,7 +91,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
         CASE(JUMPTO)
         {
             // extract jump destination from bytecode
-            m_PC = decodeJumpDest(m_code.data(), m_PC);
+            m_PC = decodeJumpDest(m_code, m_PC);
         }
         NEXT
 
@@ -100,7 +100,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
             // recurse to validate code to jump to, saving and restoring
             // interpreter state around call
             _pc = m_PC, _rp = m_RP, _sp = m_SP;
-            validateSubroutine(decodeJumpvDest(m_code.data(), m_PC, byte(m_SP[0])), _rp, _sp);
+            validateSubroutine(decodeJumpvDest(m_code, m_PC, byte(m_SP[0])), _rp, _sp);
             m_PC = _pc, m_RP = _rp, m_SP = _sp;
             ++m_PC;
         }
@@ -114,7 +114,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
                 // recurse to validate code to jump to, saving and 
                 // restoring interpreter state around call
                 _pc = m_PC, _rp = m_RP, _sp = m_SP;
-                validateSubroutine(decodeJumpDest(m_code.data(), m_PC), _rp, _sp);
+                validateSubroutine(decodeJumpDest(m_code, m_PC), _rp, _sp);
                 m_PC = _pc, m_RP = _rp, m_SP = _sp;
             }
         }
@@ -123,7 +123,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
         CASE(JUMPSUB)
         {
             // check for enough arguments on stack
-            size_t destPC = decodeJumpDest(m_code.data(), m_PC);
+            size_t destPC = decodeJumpDest(m_code, m_PC);
             byte nArgs = m_code[destPC+1];
             if (stackSize() < nArgs) 
                 throwBadStack(stackSize(), nArgs);
@@ -139,7 +139,7 @@ void VM::validateSubroutine(uint64_t _pc, uint64_t* _rp, u256* _sp)
                 // check for enough arguments on stack
                 u256 slot = sub;
                 _sp = &slot;
-                size_t destPC = decodeJumpvDest(m_code.data(), _pc, byte(m_SP[0]));
+                size_t destPC = decodeJumpvDest(m_code, _pc, byte(m_SP[0]));
                 byte nArgs = m_code[destPC+1];
                 if (stackSize() < nArgs) 
                     throwBadStack(stackSize(), nArgs);
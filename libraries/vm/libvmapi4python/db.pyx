@@ -1,5 +1,7 @@
 from libcpp.string cimport string
 from libcpp.vector cimport vector
+from libcpp.map cimport map
+from cpython.buffer cimport PyBuffer_FillInfo
 
 cdef extern from "exception_converter.hpp":
     pass
@@ -44,6 +46,10 @@ cdef extern from "<eosiolib_native/vm_api.h>": # namespace "eosio::chain":
         int32_t (*db_idx64_lowerbound)(uint64_t code, uint64_t scope, uint64_t table, uint64_t* secondary, uint64_t* primary)  except +
         int32_t (*db_idx64_upperbound)(uint64_t code, uint64_t scope, uint64_t table, uint64_t* secondary, uint64_t* primary)  except +
         int32_t (*db_idx64_end)(uint64_t code, uint64_t scope, uint64_t table)  except +
+
+        int32_t (*db_idx64_range)(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* secondaries, size_t secondaries_len, uint64_t* primaries, size_t primaries_len)  except +
+        int32_t (*db_get_i64_many)(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* primaries, size_t count, char* buffer, size_t buffer_size, uint32_t* offsets, size_t offsets_len)  except +
+        int32_t (*db_i64_range)(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, uint64_t* primaries, size_t primaries_len)  except +
 '''
 int32_t (*db_idx_double_store)(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const float64_t* secondary);
 void (*db_idx_double_update)(int32_t iterator, uint64_t payer, const float64_t* secondary);
@@ -59,25 +65,144 @@ int32_t (*db_idx_double_end)(uint64_t code, uint64_t scope, uint64_t table);
 cdef extern from "eoslib_.hpp":
     vm_api& api()
 
+# bumped whenever a row buffer handed out by get_i64_view may have moved or been freed
+cdef uint64_t _generation = 0
+# bumped by _begin_apply, iterator numbers are reused from one apply to the next
+cdef uint64_t _apply_epoch = 0
+# iterator -> number of buffers still exported from views of that row in the current apply
+cdef map[int, int] _exports
+cdef int _exported = 0
+
+def _begin_apply():
+    '''
+    Called by the vm before every apply, views left over from the previous one can't export buffers anymore
+    and buffers they exported no longer count against the rows of this one
+    '''
+    global _generation, _apply_epoch, _exported
+    _generation += 1
+    _apply_epoch += 1
+    _exports.clear()
+    _exported = 0
+
+def _live_exports():
+    '''
+    :returns: the number of buffers of row views of the current apply that are still referenced. The vm fails
+    an apply that ends with one, since it would point into rows that are changed or freed once the apply is over
+    '''
+    return _exported
+
+# primary keys read per db_i64_range call of rows_i64
+cdef size_t _rows_batch = 256
+
+cdef _check_writable(int itr):
+    global _generation
+    if _exports.count(itr) and _exports[itr] > 0:
+        raise BufferError('row is still referenced by a memoryview, release it before writing')
+    _generation += 1
+
+cdef class RowView:
+    '''
+    Read only view of a row, it points to the row in the chain database.
+    memoryview(row) gives zero copy access for as long as the row is not updated or removed
+    in the current action, the memoryview has to be released before the apply returns.
+    bytes(row) makes a copy that can be kept.
+    '''
+    cdef const char* ptr
+    cdef size_t size
+    cdef int itr
+    cdef uint64_t generation
+    cdef readonly uint64_t primary
+
+    def __getbuffer__(self, Py_buffer* buffer, int flags):
+        global _exported
+        if self.generation != _generation:
+            raise BufferError('stale row view')
+        PyBuffer_FillInfo(buffer, self, <void*>self.ptr, self.size, 1, flags)
+        buffer.internal = <void*><size_t>_apply_epoch
+        _exports[self.itr] += 1
+        _exported += 1
+
+    def __releasebuffer__(self, Py_buffer* buffer):
+        global _exported
+        if <size_t>buffer.internal != <size_t>_apply_epoch:
+            return
+        if _exports.count(self.itr) and _exports[self.itr] > 0:
+            _exports[self.itr] -= 1
+            if _exports[self.itr] == 0:
+                _exports.erase(self.itr)
+            _exported -= 1
+
+    def __len__(self):
+        return self.size
+
+    def tobytes(self):
+        if self.generation != _generation:
+            raise BufferError('stale row view')
+        return self.ptr[:self.size]
+
+cdef RowView _new_view(int itr, uint64_t primary):
+    cdef size_t size = 0
+    cdef const char* ptr = api().db_get_i64_exex(itr, &size)
+    cdef RowView view = RowView.__new__(RowView)
+    view.ptr = ptr
+    view.size = size
+    view.itr = itr
+    view.primary = primary
+    view.generation = _generation
+    return view
+
 def store_i64(scope, table, payer, id, buffer):
     api().db_store_i64(scope, table, payer, id, buffer, len(buffer))
 
 def update_i64(int itr, uint64_t payer, buffer):
+    _check_writable(itr)
     api().db_update_i64(itr, payer, buffer, len(buffer))
 
 def remove_i64(int itr):
+    _check_writable(itr)
     api().db_remove_i64(itr)
 
 def get_i64( int iterator ):
-    cdef size_t size
-    ret = None
-    size = api().db_get_i64( iterator, <char*>0, 0 )
+    cdef size_t size = 0
+    cdef const char* ptr = api().db_get_i64_exex( iterator, &size )
     if size <= 0:
         return None
+    return ptr[:size]
 
-    buffer = bytes(size)
-    size = api().db_get_i64( iterator, buffer, size )
-    return buffer
+def get_i64_view( int iterator ):
+    '''
+    Same as get_i64 but returns a RowView instead of copying the row
+    '''
+    cdef uint64_t primary = 0
+    api().db_get_i64_ex( iterator, &primary, <char*>0, 0 )
+    return _new_view( iterator, primary )
+
+def rows_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower=0, uint64_t upper=0xffffffffffffffff, int limit=-1 ):
+    '''
+    Reads the rows with lower <= primary <= upper, two calls per batch of rows instead of two per row
+    :returns: list of (primary, memoryview), at most limit entries if limit >= 0. The views are read only
+    slices of one copy of the batch, they can be kept
+    '''
+    cdef vector[uint64_t] keys
+    cdef vector[uint32_t] offsets
+    cdef int32_t count
+    cdef size_t batch
+    cdef size_t i
+    rows = []
+    while limit < 0 or len(rows) < limit:
+        batch = _rows_batch if limit < 0 else min(_rows_batch, limit - len(rows))
+        keys.resize(batch)
+        count = api().db_i64_range( code, scope, table, lower, upper, keys.data(), keys.size() )
+        if count <= 0:
+            break
+        keys.resize(count)
+        data = memoryview(_read_many( code, scope, table, keys, offsets ))
+        for i in range(keys.size()):
+            rows.append( (keys[i], data[offsets[i]:offsets[i+1]]) )
+        if <size_t>count < batch or keys.back() == upper:
+            break
+        lower = keys.back() + 1
+    return rows
 
 def next_i64( int iterator):
     cdef uint64_t primary = 0
@@ -102,6 +227,33 @@ def end_i64( uint64_t code, uint64_t scope, uint64_t table ):
     return api().db_end_i64( code, scope, table )
 
 
+cdef bytes _read_many( uint64_t code, uint64_t scope, uint64_t table, vector[uint64_t]& keys, vector[uint32_t]& offsets ):
+    cdef string buffer
+    cdef int32_t size
+    offsets.resize(keys.size() + 1)
+    buffer.resize(keys.size() * 128)
+    size = api().db_get_i64_many( code, scope, table, keys.data(), keys.size(), <char*>buffer.data(), buffer.size(), offsets.data(), offsets.size() )
+    if <size_t>size > buffer.size():
+        buffer.resize(size)
+        api().db_get_i64_many( code, scope, table, keys.data(), keys.size(), <char*>buffer.data(), buffer.size(), offsets.data(), offsets.size() )
+    return buffer.data()[:size]
+
+def get_i64_many( uint64_t code, uint64_t scope, uint64_t table, primaries ):
+    '''
+    Reads the rows with the given primary keys in one call
+    :returns: list of bytes parallel to primaries, None for a row that doesn't exist
+    '''
+    cdef vector[uint64_t] keys = primaries
+    cdef vector[uint32_t] offsets
+    data = _read_many( code, scope, table, keys, offsets )
+    rows = []
+    for i in range(keys.size()):
+        if offsets[i] == offsets[i+1]:
+            rows.append(None)
+        else:
+            rows.append(data[offsets[i]:offsets[i+1]])
+    return rows
+
 def db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t primary, uint64_t secondary):
     return api().db_idx64_store(scope, table, payer, primary, &secondary)
 
@@ -146,6 +298,20 @@ def db_idx64_upperbound(uint64_t code, uint64_t scope, uint64_t table):
 def db_idx64_end(uint64_t code, uint64_t scope, uint64_t table):
     return api().db_idx64_end(code, scope, table)
 
+def db_idx64_range(uint64_t code, uint64_t scope, uint64_t table, uint64_t lower=0, uint64_t upper=0xffffffffffffffff, int limit=100):
+    '''
+    :returns: list of (secondary, primary) with lower <= secondary <= upper in index order, at most limit entries
+    '''
+    cdef vector[uint64_t] secondaries
+    cdef vector[uint64_t] primaries
+    cdef int32_t count
+    if limit <= 0:
+        return []
+    secondaries.resize(limit)
+    primaries.resize(limit)
+    count = api().db_idx64_range(code, scope, table, lower, upper, secondaries.data(), secondaries.size(), primaries.data(), primaries.size())
+    return [(secondaries[i], primaries[i]) for i in range(count)]
+
 def get_table_item_count(uint64_t code, uint64_t scope, uint64_t table):
     return api().get_table_item_count(code, scope, table)
 
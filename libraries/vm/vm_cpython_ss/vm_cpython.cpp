@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <list>
 #include <map>
+#include <memory>
+#include <set>
+
+#include <stdio.h>
+#include <sys/time.h>
 
 #include "vm_cpython.h"
 #include <Python.h>
@@ -39,7 +46,346 @@ void get_code(uint64_t account, string& code) {
    code = string(_code, size);
 }
 
+struct sandbox {
+   PyThreadState* state;
+   std::map<string, PyObject*> modules;
+   size_t memory = 0; //bytes python allocated for it and kept, as seen by tracemalloc, an estimate
+   std::list<uint64_t>::iterator lru_pos;
+};
+
+struct sandbox_stats {
+   uint64_t created = 0;
+   uint64_t total_create_us = 0;
+   uint64_t max_create_us = 0;
+   uint64_t from_pool = 0;        //first applies served by a pre-built sandbox
+   uint64_t total_handout_us = 0;
+   uint64_t built_on_demand = 0;  //first applies that found the pool empty
+   uint64_t reused = 0;
+   uint64_t evicted = 0;
+};
+
+static std::map<uint64_t, std::unique_ptr<sandbox>> s_sandbox_map;
+static std::list<uint64_t> s_sandbox_lru; //most recently used first
+static std::vector<std::unique_ptr<sandbox>> s_sandbox_pool;
+static size_t s_sandbox_pool_size = 4;
+static size_t s_sandbox_memory_budget = 512*1024*1024;
+static size_t s_sandbox_memory = 0;
+static sandbox_stats s_sandbox_stats;
+//vm_cleanup runs once per block, report about once every ten minutes
+static const int sandbox_stats_interval = 1200;
+
+static uint64_t s_current_account = 0;
+PyObject* load_module_from_db(uint64_t account, uint64_t code_name);
+int vm_apply_no_throw(uint64_t receiver, uint64_t account, uint64_t act);
+int error_handler(string& error);
+
+static uint64_t get_microseconds() {
+   struct timeval  tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000000LL + tv.tv_usec * 1LL ;
+}
+
+/**
+ * Bytes allocated since tracemalloc was started and still alive, 0 if it isn't tracing
+ */
+static size_t traced_memory(PyObject* tracemalloc) {
+   size_t current = 0;
+   PyObject* traced = PyObject_CallMethod(tracemalloc, "get_traced_memory", NULL);
+   if (traced && PyTuple_Check(traced) && PyTuple_Size(traced) == 2) {
+      current = PyLong_AsSize_t(PyTuple_GetItem(traced, 0));
+   }
+   Py_XDECREF(traced);
+   if (PyErr_Occurred()) {
+      PyErr_Clear();
+      return 0;
+   }
+   return current;
+}
+
+extern "C" PyObject* vm_cpython_load_module(const char* account_name, const char* module_name) {
+   uint64_t _account_name = NN(account_name);
+   auto itr = s_sandbox_map.find(_account_name);
+   if (itr == s_sandbox_map.end()) {
+      return NULL;
+   }
+
+   auto itr2 = itr->second->modules.find(module_name);
+   if (itr2 != itr->second->modules.end()) {
+      Py_INCREF(itr2->second);
+      return itr2->second;
+   }
+   uint64_t _module_name = get_vm_api()->string_to_uint64(module_name);
+   return load_module_from_db(_account_name, _module_name);//load module from code ext
+}
+
+extern "C" PyObject* vm_cpython_load_module_from_current_account(const char* module_name) {
+   char account_name[13];
+   memset(account_name, 0, sizeof(account_name));
+   uint64_t account = current_receiver();
+   get_vm_api()->uint64_to_string(account, account_name, sizeof(account_name));
+   return vm_cpython_load_module(account_name, module_name);
+}
+
+/**
+ * Brings up a sub-interpreter with the builtin modules of a contract, it is the current thread state on return
+ */
+static std::unique_ptr<sandbox> create_sandbox() {
+   PyObject* module;
+   PyObject* name;
+
+   PyObject* tracemalloc;
+
+   uint64_t start = get_microseconds();
+
+   PyThreadState_Swap(NULL);
+   std::unique_ptr<sandbox> s = std::make_unique<sandbox>();
+   s->state = Py_NewInterpreterEx();
+
+   //the interpreter itself is left out, what its builtin modules allocate is charged to the sandbox
+   tracemalloc = PyInit__tracemalloc();
+   if (tracemalloc == NULL) {
+      goto error;
+   }
+   name = PyUnicode_FromString("_tracemalloc");
+   _PyImport_SetModule(name, tracemalloc);
+   Py_XDECREF(PyObject_CallMethod(tracemalloc, "start", NULL));
+
+   module = PyInit__struct();
+   s->modules["struct"] = module;
+   name = PyUnicode_FromString("struct");
+   _PyImport_SetModule(name, module);
+
+   module = PyInit_db();
+   if (module == NULL) {
+      goto error;
+   }
+   name = PyUnicode_FromString("db");
+   _PyImport_SetModule(name, module);
+   s->modules["db"] = module;
+
+   module = PyInit_eoslib();
+   if (module == NULL) {
+      goto error;
+   }
+   name = PyUnicode_FromString("eoslib");
+   _PyImport_SetModule(name, module);
+   s->modules["eoslib"] = module;
+
+   module = PyInit_inspector();
+   if (module == NULL) {
+      goto error;
+   }
+   name = PyUnicode_FromString("inspector");
+   _PyImport_SetModule(name, module);
+
+   module = PyInit_vm_cpython();
+   if (module == NULL) {
+      goto error;
+   }
+   name = PyUnicode_FromString("vm_cpython");
+   _PyImport_SetModule(name, module);
+
+   {
+      s->memory = traced_memory(tracemalloc);
+      s_sandbox_memory += s->memory;
+      Py_XDECREF(PyObject_CallMethod(tracemalloc, "stop", NULL));
+
+      uint64_t cost = get_microseconds() - start;
+      s_sandbox_stats.created++;
+      s_sandbox_stats.total_create_us += cost;
+      if (cost > s_sandbox_stats.max_create_us) {
+         s_sandbox_stats.max_create_us = cost;
+      }
+   }
+   return s;
+error:
+   string error;
+   error_handler(error);
+   vmdlog("+++++++%s \n", error.c_str());
+//   PyThreadState_Swap(mainstate);
+   return nullptr;
+}
+
+static void destroy_sandbox(std::unique_ptr<sandbox> s) {
+   s_sandbox_memory -= std::min(s->memory, s_sandbox_memory);
+   PyThreadState_Swap(s->state);
+   for (auto& it : s->modules) {
+      Py_DECREF(it.second);
+   }
+   s->modules.clear();
+   Py_EndInterpreter(s->state);
+   PyThreadState_Swap(NULL);
+}
+
+/**
+ * Tears down the least recently used sandboxes until the estimated memory fits the budget again
+ */
+static void evict_sandboxes(uint64_t keep) {
+   if (s_sandbox_memory <= s_sandbox_memory_budget) {
+      return;
+   }
+   PyThreadState* current = PyThreadState_Swap(NULL);
+   while (s_sandbox_memory > s_sandbox_memory_budget && !s_sandbox_lru.empty()) {
+      uint64_t account = s_sandbox_lru.back();
+      if (account == keep) {
+         break;
+      }
+      s_sandbox_lru.pop_back();
+      auto itr = s_sandbox_map.find(account);
+      std::unique_ptr<sandbox> s = std::move(itr->second);
+      if (s->state == current) {
+         current = mainstate;
+      }
+      s_sandbox_map.erase(itr);
+      destroy_sandbox(std::move(s));
+      s_sandbox_stats.evicted++;
+   }
+   PyThreadState_Swap(current);
+}
+
+/**
+ * Tops the pool of pre-built sandboxes up, one at a time so that no block pays for all of them
+ */
+static void refill_sandbox_pool() {
+   if (s_sandbox_pool.size() >= s_sandbox_pool_size || s_sandbox_memory >= s_sandbox_memory_budget) {
+      return;
+   }
+   PyThreadState* current = PyThreadState_Swap(NULL);
+   std::unique_ptr<sandbox> s = create_sandbox();
+   if (s) {
+      s_sandbox_pool.push_back(std::move(s));
+   }
+   PyThreadState_Swap(current);
+}
+
+struct import_stats {
+   uint64_t loads = 0;       //code objects unmarshalled and validated
+   uint64_t total_load_us = 0;
+   uint64_t execs = 0;       //module bodies run, once per apply
+   uint64_t total_exec_us = 0;
+};
+
+static std::set<std::pair<uint64_t, string>> s_validated_code;
+static std::map<uint64_t, import_stats> s_import_stats;
+
+static bool get_code_version(uint64_t account, string& code_id) {
+   char id[32];
+   if (!get_vm_api()->get_code_id(account, id, sizeof(id))) {
+      return false;
+   }
+   code_id = string(id, sizeof(id));
+   return true;
+}
+
+int vm_cpython_is_validated(uint64_t account) {
+   string code_id;
+   if (!get_code_version(account, code_id)) {
+      return 0;
+   }
+   return s_validated_code.find(std::make_pair(account, code_id)) != s_validated_code.end();
+}
+
+void vm_cpython_set_validated(uint64_t account) {
+   string code_id;
+   if (!get_code_version(account, code_id)) {
+      return;
+   }
+   //only the current version of a contract is worth keeping
+   auto itr = s_validated_code.lower_bound(std::make_pair(account, string()));
+   while (itr != s_validated_code.end() && itr->first.first == account) {
+      itr = s_validated_code.erase(itr);
+   }
+   s_validated_code.insert(std::make_pair(account, code_id));
+}
+
+void vm_cpython_record_load(uint64_t account, uint64_t us) {
+   import_stats& st = s_import_stats[account];
+   st.loads++;
+   st.total_load_us += us;
+}
+
+void vm_cpython_record_exec(uint64_t account, uint64_t us) {
+   import_stats& st = s_import_stats[account];
+   st.execs++;
+   st.total_exec_us += us;
+}
+
+void vm_cpython_record_memory(uint64_t account, uint64_t bytes) {
+   auto itr = s_sandbox_map.find(account);
+   if (itr != s_sandbox_map.end()) {
+      itr->second->memory += bytes;
+      s_sandbox_memory += bytes;
+   }
+}
+
+uint64_t vm_cpython_now() {
+   return get_microseconds();
+}
+
+static void report_sandbox_stats() {
+   const sandbox_stats& st = s_sandbox_stats;
+   vmilog("python sandboxes: %d live, %d pooled, ~%d MiB; created %d (avg %d us, max %d us), "
+          "pool handouts %d (avg %d us), built on demand %d, reused %d, evicted %d\n",
+          (int)s_sandbox_map.size(), (int)s_sandbox_pool.size(), (int)(s_sandbox_memory >> 20),
+          (int)st.created, (int)(st.created ? st.total_create_us / st.created : 0), (int)st.max_create_us,
+          (int)st.from_pool, (int)(st.from_pool ? st.total_handout_us / st.from_pool : 0),
+          (int)st.built_on_demand, (int)st.reused, (int)st.evicted);
+
+   std::vector<std::pair<uint64_t, uint64_t>> busiest;
+   for (auto& it: s_import_stats) {
+      busiest.emplace_back(it.second.total_load_us + it.second.total_exec_us, it.first);
+   }
+   std::sort(busiest.rbegin(), busiest.rend());
+   for (size_t i = 0; i < busiest.size() && i < 10; i++) {
+      char name[16] = {0};
+      const import_stats& is = s_import_stats[busiest[i].second];
+      get_vm_api()->uint64_to_string(busiest[i].second, name, sizeof(name));
+      vmilog("python imports of %s: %d loads (avg %d us), %d module runs (avg %d us)\n", name,
+             (int)is.loads, (int)(is.loads ? is.total_load_us / is.loads : 0),
+             (int)is.execs, (int)(is.execs ? is.total_exec_us / is.execs : 0));
+   }
+   s_import_stats.clear();
+}
+
+void prepare_env(uint64_t account) {
+   auto itr = s_sandbox_map.find(account);
+   if (itr != s_sandbox_map.end()) {
+      s_sandbox_stats.reused++;
+      s_sandbox_lru.splice(s_sandbox_lru.begin(), s_sandbox_lru, itr->second->lru_pos);
+      PyThreadState_Swap(itr->second->state);
+      return;
+   }
+
+   uint64_t start = get_microseconds();
+   std::unique_ptr<sandbox> s;
+   if (!s_sandbox_pool.empty()) {
+      s = std::move(s_sandbox_pool.back());
+      s_sandbox_pool.pop_back();
+      PyThreadState_Swap(s->state);
+      s_sandbox_stats.from_pool++;
+      s_sandbox_stats.total_handout_us += get_microseconds() - start;
+   } else {
+      s = create_sandbox();
+      if (!s) {
+         return;
+      }
+      s_sandbox_stats.built_on_demand++;
+   }
+
+   s_sandbox_lru.push_front(account);
+   s->lru_pos = s_sandbox_lru.begin();
+   s_sandbox_map[account] = std::move(s);
+   evict_sandboxes(account);
+}
+
 bool vm_cleanup() {
+   static int calls = 0;
+   evict_sandboxes(0);
+   refill_sandbox_pool();
+   if (++calls % sandbox_stats_interval == 0) {
+      report_sandbox_stats();
+   }
+
    if (PyObject_GC_GetCount() >=1000) {
       PyGC_Collect();
       return true;
@@ -149,6 +495,24 @@ void vm_init(struct vm_api* api) {
 //   enable_injected_apis_();
 
    init_function_whitelist();
+
+   char option[32] = {0};
+   if (api->get_option("python-sandbox-pool-size", option, sizeof(option) - 1)) {
+      s_sandbox_pool_size = strtoul(option, NULL, 10);
+   }
+   memset(option, 0, sizeof(option));
+   if (api->get_option("python-sandbox-memory-mb", option, sizeof(option) - 1)) {
+      s_sandbox_memory_budget = strtoull(option, NULL, 10)*1024*1024;
+   }
+   while (s_sandbox_pool.size() < s_sandbox_pool_size) {
+      std::unique_ptr<sandbox> s = create_sandbox();
+      if (!s) {
+         break;
+      }
+      s_sandbox_pool.push_back(std::move(s));
+   }
+   PyThreadState_Swap(mainstate);
+
    api->vm_cleanup = vm_cleanup;
    api->vm_run_script = vm_run_script;
 }
@@ -159,103 +523,6 @@ void vm_deinit() {
 
 void memory_trace_stop();
 
-struct sandbox {
-   PyThreadState* state;
-   std::map<string, PyObject*> modules;
-};
-
-static std::map<uint64_t, std::unique_ptr<sandbox>> s_sandbox_map;
-static uint64_t s_current_account = 0;
-PyObject* load_module_from_db(uint64_t account, uint64_t code_name);
-int vm_apply_no_throw(uint64_t receiver, uint64_t account, uint64_t act);
-int error_handler(string& error);
-
-extern "C" PyObject* vm_cpython_load_module(const char* account_name, const char* module_name) {
-   uint64_t _account_name = NN(account_name);
-   auto itr = s_sandbox_map.find(_account_name);
-   if (itr == s_sandbox_map.end()) {
-      return NULL;
-   }
-
-   auto itr2 = itr->second->modules.find(module_name);
-   if (itr2 != itr->second->modules.end()) {
-      Py_INCREF(itr2->second);
-      return itr2->second;
-   }
-   uint64_t _module_name = get_vm_api()->string_to_uint64(module_name);
-   return load_module_from_db(_account_name, _module_name);//load module from code ext
-}
-
-extern "C" PyObject* vm_cpython_load_module_from_current_account(const char* module_name) {
-   char account_name[13];
-   memset(account_name, 0, sizeof(account_name));
-   uint64_t account = current_receiver();
-   get_vm_api()->uint64_to_string(account, account_name, sizeof(account_name));
-   return vm_cpython_load_module(account_name, module_name);
-}
-
-void prepare_env(uint64_t account) {
-   auto itr = s_sandbox_map.find(account);
-   if (itr == s_sandbox_map.end()) {
-      PyObject* module;
-      PyObject* name;
-
-      PyThreadState_Swap(NULL);
-      std::unique_ptr<sandbox> s = std::make_unique<sandbox>();
-      s->state = Py_NewInterpreterEx();
-
-      module = PyInit__struct();
-      s->modules["struct"] = module;
-      name = PyUnicode_FromString("struct");
-      _PyImport_SetModule(name, module);
-
-      module = PyInit__tracemalloc();
-      name = PyUnicode_FromString("_tracemalloc");
-      _PyImport_SetModule(name, module);
-
-      module = PyInit_db();
-      if (module == NULL) {
-         goto error;
-      }
-      name = PyUnicode_FromString("db");
-      _PyImport_SetModule(name, module);
-      s->modules["db"] = module;
-
-      module = PyInit_eoslib();
-      if (module == NULL) {
-         goto error;
-      }
-      name = PyUnicode_FromString("eoslib");
-      _PyImport_SetModule(name, module);
-      s->modules["eoslib"] = module;
-
-      module = PyInit_inspector();
-      if (module == NULL) {
-         goto error;
-      }
-      name = PyUnicode_FromString("inspector");
-      _PyImport_SetModule(name, module);
-
-      module = PyInit_vm_cpython();
-      if (module == NULL) {
-         goto error;
-      }
-      name = PyUnicode_FromString("vm_cpython");
-      _PyImport_SetModule(name, module);
-
-      s_sandbox_map[account] = std::move(s);
-   } else {
-      PyThreadState_Swap(itr->second->state);
-   }
-   return;
-error:
-   string error;
-   error_handler(error);
-   vmdlog("+++++++%s \n", error.c_str());
-//   PyThreadState_Swap(mainstate);
-   return;
-}
-
 int vm_setcode(uint64_t account) {
    string code;
    char name[32];
@@ -337,12 +604,6 @@ int error_handler(string& error) {
    return 1;
 }
 
-static uint64_t get_microseconds() {
-   struct timeval  tv;
-   gettimeofday(&tv, NULL);
-   return tv.tv_sec * 1000000LL + tv.tv_usec * 1LL ;
-}
-
 int vm_apply_no_throw(uint64_t receiver, uint64_t account, uint64_t act) {
    s_current_account = receiver;
 
@@ -354,7 +615,6 @@ int vm_apply_no_throw(uint64_t receiver, uint64_t account, uint64_t act) {
    enable_inspect_obj_creation(0);
 
    prepare_env(receiver);
-   uint64_t start = get_microseconds();
    return cpython_apply(receiver, account, act);
 }
 
@@ -368,8 +628,25 @@ int vm_apply(uint64_t receiver, uint64_t account, uint64_t act) {
    return 1;
 }
 
+int cpython_preload(uint64_t account);
+
+/**
+ * Loads the code of account and the modules it imports into its sandbox ahead of its first apply
+ */
 int vm_preload(uint64_t account) {
-   return 0;
+   s_current_account = account;
+
+   memory_trace_stop();
+   enable_injected_apis(0);
+   enable_create_code_object(1);
+   enable_filter_set_attr(0);
+   enable_filter_get_attr(0);
+   enable_inspect_obj_creation(0);
+
+   prepare_env(account);
+   int ret = cpython_preload(account);
+   enable_injected_apis(0);
+   return ret;
 }
 
 int vm_unload(uint64_t account) {
@@ -16,3 +16,13 @@ int vm_cpython_apply(PyObject* mod, unsigned long long receiver, unsigned long l
 
 PyObject* vm_load_module(string& name, string& bytecode);
 PyObject* vm_load_codeobject(string& name, string& bytecodes);
+
+//validation results of contract code by code_version, shared by all sandboxes
+int vm_cpython_is_validated(uint64_t account);
+void vm_cpython_set_validated(uint64_t account);
+
+void vm_cpython_record_load(uint64_t account, uint64_t us);
+void vm_cpython_record_exec(uint64_t account, uint64_t us);
+//charges what an apply allocated and left alive to the sandbox of account
+void vm_cpython_record_memory(uint64_t account, uint64_t bytes);
+uint64_t vm_cpython_now();
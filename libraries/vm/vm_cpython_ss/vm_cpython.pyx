@@ -5,7 +5,7 @@ from libcpp.vector cimport vector
 from libcpp.map cimport map
 from cpython.ref cimport PyObject
 
-#import db
+import db
 import eoslib
 import struct
 import _tracemalloc
@@ -52,6 +52,13 @@ cdef extern from "vm_cpython.h":
     object vm_load_module(string& name, string& bytecode)
     object vm_load_codeobject(string& name, string& bytecodes)
 
+    int vm_cpython_is_validated(uint64_t account)
+    void vm_cpython_set_validated(uint64_t account)
+    void vm_cpython_record_load(uint64_t account, uint64_t us)
+    void vm_cpython_record_exec(uint64_t account, uint64_t us)
+    void vm_cpython_record_memory(uint64_t account, uint64_t bytes)
+    uint64_t vm_cpython_now()
+
 cdef extern from "<eosiolib_native/vm_api.h>":
     cdef cppclass vm_api:
         const char* (*vm_cpython_compile)(const char *name, const char *code, int size, int *result_size)
@@ -66,6 +73,9 @@ def _get_code(uint64_t account):
 __current_module = None
 py_modules = {}
 py_imported_modules = {}
+# code objects of the modules deployed with set_code_ext, (account, code_name): (bytecodes, code object).
+# they outlive an apply, the modules made from them don't
+py_ext_codes = {}
 
 ModuleType = type(inspector)
 
@@ -130,27 +140,60 @@ def validate(co):
 
     return True
 
-cdef extern object load_module_from_db(uint64_t account, uint64_t code_name):
+IMPORT_NAME = 108
+name_chars = set('abcdefghijklmnopqrstuvwxyz12345.')
+
+def imported_names(co, names):
+    code = co.co_code
+    for i in range(0, len(code), 2):
+        if code[i] == IMPORT_NAME:
+            names.add(co.co_names[code[i+1]].split('.')[0])
+    for const in co.co_consts:
+        if type(const) == type(co):
+            imported_names(const, names)
+    return names
+
+cdef object load_ext_code(uint64_t account, uint64_t code_name):
     cdef const char* bytecodes = NULL;
     cdef size_t code_size = 0;
     cdef string _bytecodes;
 
+    bytecodes = get_vm_api()[0].load_code_ext(account, code_name, &code_size)
+    if code_size == 0:
+        return None
+
+    key = (account, code_name)
+    _bytecodes = string(bytecodes, code_size)
+    if key in py_ext_codes:
+        cached = py_ext_codes[key]
+        if cached[0] == <bytes>_bytecodes:
+            return cached[1]
+    co = vm_load_codeobject(eoslib.n2s(code_name), _bytecodes)
+    py_ext_codes[key] = (<bytes>_bytecodes, co)
+    return co
+
+cdef resolve_imports(uint64_t account, co):
+    # unmarshal the modules the contract imports from its own ext code before it runs
+    for name in imported_names(co, set()):
+        if len(name) > 12 or not set(name) <= name_chars:
+            continue
+        try:
+            load_ext_code(account, eoslib.N(name))
+        except:
+            pass
+
+cdef extern object load_module_from_db(uint64_t account, uint64_t code_name):
     if not account in py_imported_modules:
         py_imported_modules[account] = {}
     else:
         if code_name in py_imported_modules[account]:
             return py_imported_modules[account][code_name]
 
-    bytecodes = get_vm_api()[0].load_code_ext(account, code_name, &code_size)
-    if code_size == 0:
-        return None
-
-    _bytecodes = string(bytecodes, code_size)
-#    print('+++code_name:', code_name, code_size)
-#    print(_bytecodes)
     try:
+        co = load_ext_code(account, code_name)
+        if not co:
+            return None
         name = eoslib.n2s(code_name)
-        co = vm_load_codeobject(name, _bytecodes)
         module = type(eoslib)(name)
         exec(co, module.__dict__)
         py_imported_modules[account][code_name] = module
@@ -176,8 +219,13 @@ cdef object load_module(uint64_t account, string& bytecodes):
 
 #        co = compile(code, name, 'exec')
         ret = co
-        if validate(co):
+        # code_version keyed, validation survives sandbox evictions
+        if vm_cpython_is_validated(account) or validate(co):
+            vm_cpython_set_validated(account)
             py_modules[account] = co
+            enable_injected_apis(0)
+            resolve_imports(account, co)
+            enable_injected_apis(1)
         else:
             py_modules[account] = None
             ret = None
@@ -215,9 +263,11 @@ cdef extern int cpython_apply(unsigned long long receiver, unsigned long long ac
     if receiver in py_modules:
         co = py_modules[receiver]
     else:
+        start = vm_cpython_now()
         get_code(receiver, code)
         bytecodes = <bytes>code
         co = load_module(receiver, bytecodes)
+        vm_cpython_record_load(receiver, vm_cpython_now() - start)
     if not co:
         return 0
 
@@ -232,31 +282,58 @@ cdef extern int cpython_apply(unsigned long long receiver, unsigned long long ac
     ret = 1
     error = 0
 
+    db._begin_apply()
     _tracemalloc.start()
-    builtin_exec_(co, _dict, _dict)
-
-    enable_injected_apis(1);
-    enable_create_code_object(1);
-    enable_filter_set_attr(1);
-    enable_filter_get_attr(1);
-    enable_inspect_obj_creation(1);
-
-    module.apply(receiver, account, action)
-
-    enable_injected_apis(0);
-    enable_create_code_object(1);
-    enable_filter_set_attr(0);
-    enable_filter_get_attr(0);
-    enable_inspect_obj_creation(0);
-
-    del module
-
-    py_imported_modules = {}
+    try:
+        start = vm_cpython_now()
+        builtin_exec_(co, _dict, _dict)
+        vm_cpython_record_exec(receiver, vm_cpython_now() - start)
+
+        enable_injected_apis(1);
+        enable_create_code_object(1);
+        enable_filter_set_attr(1);
+        enable_filter_get_attr(1);
+        enable_inspect_obj_creation(1);
+
+        module.apply(receiver, account, action)
+    finally:
+        enable_injected_apis(0);
+        enable_create_code_object(1);
+        enable_filter_set_attr(0);
+        enable_filter_get_attr(0);
+        enable_inspect_obj_creation(0);
+
+        del module
+        # functions and globals reference each other, clearing the dict releases the views the contract kept,
+        # also when apply raised
+        _dict.clear()
+
+        py_imported_modules = {}
+
+        vm_cpython_record_memory(receiver, _tracemalloc.get_traced_memory()[0])
+        _tracemalloc.stop()
+        Py_SetRecursionLimit(limit)
+        set_current_account(0)
+
+    # a view still exported now would read rows that are changed or freed after the apply
+    eoslib.eosio_assert(db._live_exports() == 0, 'a memoryview of a db row outlived the apply')
+    return ret
 
-    _tracemalloc.stop()
-    Py_SetRecursionLimit(limit)
+cdef extern int cpython_preload(uint64_t account):
+    cdef string code
+    if account in py_modules:
+        return 1
+    get_code(account, code)
+    if not code.size():
+        return 0
+    set_current_account(account)
+    start = vm_cpython_now()
+    co = load_module(account, code)
+    vm_cpython_record_load(account, vm_cpython_now() - start)
     set_current_account(0)
-    return ret
+    if co:
+        return 1
+    return 0
 
 cdef extern int cpython_call(uint64_t receiver, uint64_t func) with gil:
     '''
@@ -70,6 +70,8 @@ bool EosExecutive::call(Address const& _receiveAddress, Address const& _senderAd
 
 bool EosExecutive::call(CallParameters const& _p, u256 const& _gasPrice, Address const& _origin, bool transfer)
 {
+    m_savepoint = m_s.savepoint();
+
     // If external transaction.
 
     if (m_sealEngine.isPrecompiled(_p.codeAddress, m_envInfo.number()))
@@ -127,6 +129,7 @@ bool EosExecutive::executeCreate(Address const& _sender, u256 const& _endowment,
 {
 
     m_isCreation = true;
+    m_savepoint = m_s.savepoint();
 
     // We can allow for the reverted state (i.e. that with which m_ext is constructed) to contain the m_orig.address, since
     // we delete it explicitly if we decide we need to revert.
@@ -290,6 +293,12 @@ void EosExecutive::revert()
     if (m_ext)
         m_ext->sub.clear();
 
+    // Undo the SSTOREs of this frame and of the frames it called, as the EVM does. This is intentional:
+    // they used to go straight to the database and were kept. go() still rethrows after reverting, so a
+    // failing sub-call aborts the whole action and nothing reaches the database in either case, see
+    // test_call_revert in tests/evm/testcase.
+    m_s.rollback(m_savepoint);
+
     // Set result address to the null one.
     m_newAddress = {};
 }
@@ -85,22 +85,42 @@ bool EosState::addressInUse(Address const& _id) const
 }
 
 
+EosState::CodeEntry& EosState::codeEntry(Address const& _addr) const {
+   CodeEntry& entry = m_code[_addr];
+   if (entry.current) {
+      return entry;
+   }
+   //the code can only change between two calls, or through setCode which drops the entry
+   h256 version(0);
+   get_code_id( _addr, (char*)version.data(), version.size );
+   if (!entry.loaded || entry.version != version) {
+      entry.version = version;
+      entry.code.clear();
+      entry.loaded = false;
+   }
+   entry.current = true;
+   return entry;
+}
+
 bytes const& EosState::code(Address const& _addr) const {
-   static bytes _code;
-   uint64_t receiver = _addr;
-   size_t size=0;
+   CodeEntry& entry = codeEntry(_addr);
+   if (entry.loaded) {
+      return entry.code;
+   }
 
    eosio_assert (get_code_type(_addr) == VM_TYPE, "bad vm type");
-   const char *code = get_code( receiver, &size );
+   size_t size = 0;
+   const char *code = get_code( _addr, &size );
 
-   _code.resize(size);
-   memcpy(_code.data(), code, size);
-   return _code;
+   entry.code.assign(code, code + size);
+   entry.loaded = true;
+   return entry.code;
 }
 
 /// Sets the code of the account. Must only be called during / after contract creation.
 void EosState::setCode(Address const& _address, bytes&& _code) {
    set_code(_address, VM_TYPE, (char*)_code.data(), _code.size());
+   m_code.erase(_address);
 }
 
 
@@ -123,63 +143,99 @@ bool EosState::addressHasCode(Address const& _id) const
 
 uint64_t get_sender();
 
-void EosState::setStorage(Address const& _contract, u256 const& _key, u256 const& _value)
+EosState::StorageSlot& EosState::slot(Address const& _contract, u256 const& _key) const
 {
-//	m_changeLog.emplace_back(_contract, _key, storage(_contract, _key));
-//	m_cache[_contract].setStorage(_key, _value);
-    uint64_t n = _contract;
-	ilog( "${n1} : ${n2} : ${n3}", ("n1",_key.str())("n2",_value.str())("n3", n) );
-
-	dev::bytes key = dev::toBigEndian(_key);
-
-	dev::bytes value = dev::toBigEndian(_value);
-	uint64_t payer = get_sender();
-
-   int itr = db_find_i256( n, n, n, key.data(), key.size() );
-   if (itr < 0) {
-      if (_value == 0) {
-
-      } else {
-         db_store_i256(n, n, n, payer, key.data(), key.size(), (const char *)value.data(), value.size() );
-      }
-      return;
+   auto& slots = m_storage[_contract];
+   auto it = slots.find(_key);
+   if (it != slots.end()) {
+      return it->second;
    }
 
-   if (_value == 0) {
-      db_remove_i256(itr);
-   } else {
-      db_update_i256( itr, payer, (const char *)value.data(), value.size() );
+   StorageSlot& s = slots[_key];
+   uint64_t n = _contract;
+   std::array<byte, 32> key;
+   dev::toBigEndian(_key, key);
+   int itr = db_find_i256(n, n, n, key.data(), key.size());
+   if (itr >= 0) {
+      std::array<byte, 32> value;
+      int size = db_get_i256( itr, (char *)value.data(), value.size() );
+      eosio_assert(size == 32, "bad storage");
+      s.value = dev::fromBigEndian<u256>(value);
    }
-   return;
+   return s;
+}
+
+void EosState::setStorage(Address const& _contract, u256 const& _key, u256 const& _value)
+{
+   StorageSlot& s = slot(_contract, _key);
+   m_journal.push_back(StorageChange{_contract, _key, s.value, s.dirty});
+   s.value = _value;
+   s.dirty = true;
 }
 
 u256 EosState::storage(Address const& _id, u256 const& _key) const
 {
-	uint64_t n = _id;
-	auto temp = dev::toBigEndian(_key);
-//	ilog( "${n1} ${n2}", ("n1", _id.hex())("n2", *(reinterpret_cast<bytes*>(&temp))) );
+   return slot(_id, _key).value;
+}
 
-	dev::bytes value(32);
-	memset(value.data(), 0 ,value.size());
+void EosState::rollback(size_t _savepoint)
+{
+   while (m_journal.size() > _savepoint) {
+      StorageChange& change = m_journal.back();
+      StorageSlot& s = m_storage[change.address][change.key];
+      s.value = change.value;
+      s.dirty = change.dirty;
+      m_journal.pop_back();
+   }
+}
 
-	dev::bytes key = dev::toBigEndian(_key);
-	int itr = db_find_i256(n, n, n, key.data(), key.size());
-	if (itr < 0) {
-	   return 0;
-	}
+void EosState::commit()
+{
+   uint64_t payer = get_sender();
+   for (auto& contract : m_storage) {
+      uint64_t n = contract.first;
+      for (auto& entry : contract.second) {
+         if (!entry.second.dirty) {
+            continue;
+         }
+         std::array<byte, 32> key;
+         dev::toBigEndian(entry.first, key);
+         int itr = db_find_i256( n, n, n, key.data(), key.size() );
+         if (entry.second.value == 0) {
+            if (itr >= 0) {
+               db_remove_i256(itr);
+            }
+            continue;
+         }
+         std::array<byte, 32> value;
+         dev::toBigEndian(entry.second.value, value);
+         if (itr < 0) {
+            db_store_i256(n, n, n, payer, key.data(), key.size(), (const char *)value.data(), value.size() );
+         } else {
+            db_update_i256( itr, payer, (const char *)value.data(), value.size() );
+         }
+      }
+   }
+   discard();
+}
 
-	int size = db_get_i256( itr, (char *)value.data(), value.size() );
-	eosio_assert(size == 32, "bad storage");
+void EosState::discard()
+{
+   m_storage.clear();
+   m_journal.clear();
 
-   u256 ret = dev::fromBigEndian<u256>(value);
-//   wlog( "got value ${n2}", ("n2", ret.str()) );
-   return ret;
+   //no frame holds on to code between calls, drop it if too many contracts went through
+   if (m_code.size() > 256) {
+      m_code.clear();
+   }
+   //another action may set code before the next call, check the code ids again then
+   for (auto& entry : m_code) {
+      entry.second.current = false;
+   }
 }
 
 h256 EosState::codeHash(Address const& _contract) const {
-   h256 code_id(0);
-   get_code_id( _contract, (char*)code_id.data(), code_id.size );
-   return code_id;//EmptySHA3;
+   return codeEntry(_contract).version;
 }
 
 u256 EosState::balance(Address const& _id) const {
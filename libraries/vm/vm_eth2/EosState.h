@@ -18,6 +18,7 @@
 #pragma once
 
 #include <array>
+#include <map>
 #include <unordered_map>
 #include <libdevcore/Common.h>
 #include <libdevcore/Exceptions.h>
@@ -232,10 +233,57 @@ public:
     /// @returns code(_contract).size(), but utilizes CodeSizeHash.
     size_t codeSize(Address const& _contract) const;
 
+    /// @returns the position of the storage journal, to be passed to rollback().
+    size_t savepoint() const { return m_journal.size(); }
+
+    /// Undo the storage writes made since the savepoint.
+    void rollback(size_t _savepoint);
+
+    /// Write the modified storage slots to the database and forget the cached ones, called once per call.
+    void commit();
+
+    /// Forget the cached storage slots without writing them, the call failed.
+    void discard();
+
 protected:
 
     friend std::ostream& operator<<(std::ostream& _out, EosState const& _s);
 
+private:
+    struct StorageSlot
+    {
+        u256 value;
+        bool dirty = false;
+    };
+
+    /// A storage write, with what the slot held before.
+    struct StorageChange
+    {
+        Address address;
+        u256 key;
+        u256 value;
+        bool dirty;
+    };
+
+    struct CodeEntry
+    {
+        h256 version;
+        bytes code;
+        bool loaded = false;    ///< code holds the code of version
+        bool current = false;   ///< version was read during the running call
+    };
+
+    /// The code entry of an account, its code id is read once per call.
+    CodeEntry& codeEntry(Address const& _contract) const;
+
+    StorageSlot& slot(Address const& _contract, u256 const& _key) const;
+
+    /// Slots of the running call, read from the database on first access.
+    mutable std::map<Address, std::map<u256, StorageSlot>> m_storage;
+    std::vector<StorageChange> m_journal;
+
+    /// Code and code ids of the contracts called so far, the code is reloaded when the code id of an account changes.
+    mutable std::map<Address, CodeEntry> m_code;
 };
 
 std::ostream& operator<<(std::ostream& _out, EosState const& _s);
@@ -251,18 +251,26 @@ bool run_code(uint64_t _sender, uint64_t _receiver, int64_t _value, dev::bytes&
    t.forceSender(sender);
 
    executive.initialize(t);
+
+   //storage writes are cached by the state and only reach the db once the whole call succeeded
+   try {
 #if 0
-   executive.execute();
+      executive.execute();
 #else
-   if (create)
-       executive.create(sender, value, gasPrice, gas, &data, origin);
-   else
-       executive.call(contractDestination, sender, value, gasPrice, &data, gas, transfer);
+      if (create)
+          executive.create(sender, value, gasPrice, gas, &data, origin);
+      else
+          executive.call(contractDestination, sender, value, gasPrice, &data, gas, transfer);
 #endif
 
-   executive.go();
+      executive.go();
 
-   executive.finalize();
+      executive.finalize();
+   } catch (...) {
+      state.discard();
+      throw;
+   }
+   state.commit();
 
 //   output.resize( 0 );
 //   output.resize( res.output.size() );
@@ -1,6 +1,15 @@
 #include <eosiolib_native/vm_api.h>
 #include <luasandbox.h>
+#include <luasandbox/lua.h>
+#include <luasandbox/lauxlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <exception>
+#include <list>
 #include <map>
+#include <string>
+#include <unordered_set>
 
 typedef int (*fn_check_time)(void);
 
@@ -8,11 +17,14 @@ extern "C" lsb_err_value lsb_init_ex(lsb_lua_sandbox *lsb, const char *state_fil
 extern "C" void luaV_set_check_time_fn(fn_check_time fn);
 void lsb_register_vm_api(lsb_lua_sandbox *lsb);
 static lua_State *current_state = NULL;
+//deadline exception thrown while lua code was running, rethrown once the lua call returned
+static std::exception_ptr s_deadline;
 
 class scoped_state {
 public:
    scoped_state(lua_State *s) {
       current_state = s;
+      s_deadline = nullptr;
    }
    ~scoped_state() {
       current_state = NULL;
@@ -20,21 +32,97 @@ public:
 };
 
 int check_time() {
-   try {
+   if (!current_state) {
       get_vm_api()->checktime();
-   } catch (...) {
-      if (current_state) {
-         lua_pushstring(current_state, "execution timeout!");
-         lua_error(current_state);
-      } else {
-         throw;
+      return 1;
+   }
+   if (!s_deadline) {
+      try {
+         get_vm_api()->checktime();
+         return 1;
+      } catch (...) {
+         s_deadline = std::current_exception();
       }
-      return 0;
    }
-   return 1;
+   //lua_error doesn't return, it must not be called before the exception above is destroyed.
+   //Once the deadline passed every check fails, even if the contract catches the error with pcall
+   lua_pushstring(current_state, "execution timeout!");
+   lua_error(current_state);
+   return 0;
+}
+
+static void rethrow_deadline() {
+   if (s_deadline) {
+      std::exception_ptr e = s_deadline;
+      s_deadline = nullptr;
+      std::rethrow_exception(e);
+   }
+}
+
+//instructions run between two deadline checks
+static const int checktime_interval = 1000;
+
+static void checktime_hook(lua_State *L, lua_Debug *ar) {
+   (void)L;
+   (void)ar;
+   check_time();
+}
+
+struct lua_contract {
+   lsb_lua_sandbox *lsb = NULL;
+   std::string code_id;
+   std::string fingerprint; //state of the sandbox right after it was loaded
+   size_t memory = 0;
+   std::list<uint64_t>::iterator lru_pos;
+};
+
+struct lua_stats {
+   uint64_t loads = 0;
+   uint64_t total_load_us = 0;
+   uint64_t applies = 0;
+   uint64_t total_apply_us = 0;
+   uint64_t max_apply_us = 0;
+   uint64_t evicted = 0;
+   uint64_t dirty = 0;
+};
+
+static std::map<uint64_t, lua_contract> account_map;
+static std::list<uint64_t> account_lru; //most recently used first
+static size_t s_memory_budget = 64*1024*1024;
+static size_t s_memory = 0;
+static lua_stats s_stats;
+static const int stats_interval = 10000; //applies between two reports
+
+struct lua_bytecode {
+   std::string chunk;
+   std::list<std::string>::iterator lru_pos;
+};
+
+//bytecode of the contracts by code id, it outlives the sandboxes
+static std::map<std::string, lua_bytecode> s_bytecode;
+static std::list<std::string> s_bytecode_lru; //most recently used first
+static const size_t max_bytecode_chunks = 256;
+static std::map<uint64_t, std::string> s_account_code;
+
+//compare the whole state of a sandbox with the one it was loaded with after every apply
+static bool s_verify_sandbox = false;
+
+static const char *globals_snapshot = "eosio.globals";
+
+static uint64_t get_microseconds() {
+   struct timeval  tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec * 1000000LL + tv.tv_usec * 1LL ;
 }
 
-static std::map<uint64_t, lsb_lua_sandbox *> account_map;
+static bool get_code_version(uint64_t account, std::string& code_id) {
+   char id[32];
+   if (!get_vm_api()->get_code_id(account, id, sizeof(id))) {
+      return false;
+   }
+   code_id = std::string(id, sizeof(id));
+   return true;
+}
 
 static char print_out[2048] = { 0 };
 
@@ -100,7 +188,7 @@ static const char *cfg = "memory_limit = 1024*1024\n"
 
 static const char *cfg =
 "memory_limit = 1024*1024*1\n"
-"instruction_limit = 10000\n"
+"instruction_limit = 0\n"
 "output_limit = 64*1024\n"
 "path = '/modules/?.lua'\n"
 "cpath = '/modules/?.so'\n"
@@ -113,12 +201,260 @@ static const char *cfg =
 "disable_modules = {io = 1, os=1}\n";
 
 
-lsb_lua_sandbox *load_account(uint64_t account) {
+static int bytecode_writer(lua_State *L, const void *p, size_t size, void *ud) {
+   (void)L;
+   ((std::string *)ud)->append((const char *)p, size);
+   return 0;
+}
+
+/*
+ * Compiles the source of a contract once per code id
+ */
+static const std::string *get_bytecode(uint64_t account, const std::string& code_id) {
+   auto itr = s_bytecode.find(code_id);
+   if (itr != s_bytecode.end()) {
+      s_bytecode_lru.splice(s_bytecode_lru.begin(), s_bytecode_lru, itr->second.lru_pos);
+      return &itr->second.chunk;
+   }
+
    size_t size = 0;
    const char* str_code = get_code(account, &size);
    if (size <= 0) {
       return NULL;
    }
+   //the lua loader doesn't verify precompiled chunks, only take source code from contracts
+   eosio_assert(str_code[0] != LUA_SIGNATURE[0], "lua contract must be source code");
+
+   lua_State *L = luaL_newstate();
+   eosio_assert(L != NULL, "not enough memory to compile lua contract");
+
+   std::string bytecode;
+   std::string error;
+   int ret = luaL_loadbuffer(L, str_code, size, "contract");
+   if (ret == 0) {
+      ret = lua_dump(L, bytecode_writer, &bytecode);
+   } else {
+      const char *em = lua_tostring(L, -1);
+      error = em ? em : "unknown error!";
+   }
+   lua_close(L);
+   eosio_assert(ret == 0, error.c_str());
+
+   while (s_bytecode.size() >= max_bytecode_chunks) {
+      s_bytecode.erase(s_bytecode_lru.back());
+      s_bytecode_lru.pop_back();
+   }
+   s_bytecode_lru.push_front(code_id);
+   lua_bytecode& b = s_bytecode[code_id];
+   b.chunk = std::move(bytecode);
+   b.lru_pos = s_bytecode_lru.begin();
+   return &b.chunk;
+}
+
+static void release_bytecode(uint64_t account) {
+   auto itr = s_account_code.find(account);
+   if (itr == s_account_code.end()) {
+      return;
+   }
+   std::string code_id = itr->second;
+   s_account_code.erase(itr);
+   for (auto& it : s_account_code) {
+      if (it.second == code_id) {
+         return;
+      }
+   }
+   auto b = s_bytecode.find(code_id);
+   if (b != s_bytecode.end()) {
+      s_bytecode_lru.erase(b->second.lru_pos);
+      s_bytecode.erase(b);
+   }
+}
+
+/*
+ * Keeps a shallow copy of the globals a contract defined when it was loaded
+ */
+static int snapshot_globals(lua_State *L) {
+   lua_newtable(L);
+   lua_pushnil(L);
+   while (lua_next(L, LUA_GLOBALSINDEX)) {
+      lua_pushvalue(L, -2);
+      lua_insert(L, -2);
+      lua_rawset(L, -4);
+   }
+   lua_setfield(L, LUA_REGISTRYINDEX, globals_snapshot);
+   return 0;
+}
+
+/*
+ * Puts the top level globals back to the snapshot. This is only a shallow reset, with lua-sandbox-verify
+ * fingerprint_state tells whether anything else changed
+ */
+static int restore_globals(lua_State *L) {
+   lua_getfield(L, LUA_REGISTRYINDEX, globals_snapshot);
+   int snapshot = lua_gettop(L);
+
+   lua_pushnil(L);
+   while (lua_next(L, LUA_GLOBALSINDEX)) {
+      lua_pop(L, 1);
+      lua_pushvalue(L, -1);
+      lua_rawget(L, snapshot);
+      bool added = lua_isnil(L, -1);
+      lua_pop(L, 1);
+      if (added) {
+         lua_pushvalue(L, -1);
+         lua_pushnil(L);
+         lua_rawset(L, LUA_GLOBALSINDEX);
+      }
+   }
+
+   lua_pushnil(L);
+   while (lua_next(L, snapshot)) {
+      lua_pushvalue(L, -2);
+      lua_insert(L, -2);
+      lua_rawset(L, LUA_GLOBALSINDEX);
+   }
+   lua_pop(L, 1);
+   return 0;
+}
+
+//nesting past which a state is not fingerprinted and the sandbox is always rebuilt
+static const int fingerprint_max_depth = 128;
+
+struct state_fingerprint {
+   std::string record;
+   std::unordered_set<const void *> visited;
+   bool complete = true;
+
+   void append(const void *p, size_t size) {
+      record.append((const char *)p, size);
+   }
+};
+
+/*
+ * Records a value: scalars by value, strings by content, other objects by address and, the first time they
+ * are seen, by their metatable, environment, upvalues and contents. Only raw accesses are used, no metamethod
+ * runs and nothing is allocated in the lua state.
+ */
+static void fingerprint_value(lua_State *L, int idx, state_fingerprint& fp, int depth) {
+   if (idx < 0 && idx > LUA_REGISTRYINDEX) {
+      idx = lua_gettop(L) + idx + 1;
+   }
+   int type = lua_type(L, idx);
+   fp.record.push_back((char)type);
+   switch (type) {
+   case LUA_TNIL:
+      return;
+   case LUA_TBOOLEAN:
+      fp.record.push_back((char)lua_toboolean(L, idx));
+      return;
+   case LUA_TNUMBER: {
+      lua_Number n = lua_tonumber(L, idx);
+      fp.append(&n, sizeof(n));
+      return;
+   }
+   case LUA_TSTRING: {
+      size_t len = 0;
+      const char *str = lua_tolstring(L, idx, &len);
+      fp.append(&len, sizeof(len));
+      fp.append(str, len);
+      return;
+   }
+   case LUA_TLIGHTUSERDATA: {
+      const void *p = lua_touserdata(L, idx);
+      fp.append(&p, sizeof(p));
+      return;
+   }
+   }
+
+   const void *p = lua_topointer(L, idx);
+   fp.append(&p, sizeof(p));
+   if (!fp.visited.insert(p).second) {
+      return;
+   }
+   //a coroutine keeps state on its own stack
+   if (type == LUA_TTHREAD || depth >= fingerprint_max_depth || !lua_checkstack(L, 4)) {
+      fp.complete = false;
+      return;
+   }
+
+   if (type != LUA_TFUNCTION) {
+      if (lua_getmetatable(L, idx)) {
+         fingerprint_value(L, -1, fp, depth + 1);
+         lua_pop(L, 1);
+      } else {
+         fp.record.push_back((char)LUA_TNONE);
+      }
+   }
+   if (type != LUA_TTABLE) {
+      lua_getfenv(L, idx);
+      fingerprint_value(L, -1, fp, depth + 1);
+      lua_pop(L, 1);
+   }
+
+   if (type == LUA_TTABLE) {
+      lua_pushnil(L);
+      while (lua_next(L, idx)) {
+         fingerprint_value(L, -2, fp, depth + 1);
+         fingerprint_value(L, -1, fp, depth + 1);
+         lua_pop(L, 1);
+      }
+   } else if (type == LUA_TFUNCTION) {
+      for (int i = 1; lua_getupvalue(L, idx, i); i++) {
+         fingerprint_value(L, -1, fp, depth + 1);
+         lua_pop(L, 1);
+      }
+   } else if (type == LUA_TUSERDATA) {
+      size_t len = lua_objlen(L, idx);
+      fp.append(&len, sizeof(len));
+      fp.append(lua_touserdata(L, idx), len);
+   }
+   fp.record.push_back((char)LUA_TNONE);
+}
+
+/*
+ * Everything a contract can reach: the globals, the registry (loaded modules, the globals snapshot) and the
+ * metatables shared by all values of a basic type. Two fingerprints of the same sandbox are equal only if
+ * the contract can't tell the two states apart, locals captured by closures and nested tables included.
+ * @return false if the state is too deep to be fingerprinted
+ */
+static bool fingerprint_state(lua_State *L, std::string& record) {
+   state_fingerprint fp;
+   fingerprint_value(L, LUA_GLOBALSINDEX, fp, 0);
+   fingerprint_value(L, LUA_REGISTRYINDEX, fp, 0);
+
+   lua_pushnil(L);
+   lua_pushboolean(L, 0);
+   lua_pushnumber(L, 0);
+   lua_pushliteral(L, "");
+   int top = lua_gettop(L);
+   for (int i = top - 3; i <= top; i++) {
+      if (lua_getmetatable(L, i)) {
+         fingerprint_value(L, -1, fp, 0);
+         lua_pop(L, 1);
+      } else {
+         fp.record.push_back((char)LUA_TNONE);
+      }
+   }
+   lua_pop(L, 4);
+
+   record = std::move(fp.record);
+   return fp.complete;
+}
+
+static void destroy_sandbox(lsb_lua_sandbox *lsb, std::string *error) {
+   if (error) {
+      const char *em = lsb_get_error(lsb);
+      *error = (em && em[0]) ? em : "unknown error!";
+   }
+   lsb_terminate(lsb, NULL);
+   lsb_destroy(lsb);
+}
+
+static lsb_lua_sandbox *create_sandbox(uint64_t account, const std::string& code_id) {
+   const std::string *bytecode = get_bytecode(account, code_id);
+   if (!bytecode) {
+      return NULL;
+   }
 
    lsb_lua_sandbox *lsb = lsb_create(NULL, "null.lua", cfg, &printer);
    if (!lsb) {
@@ -127,43 +463,125 @@ lsb_lua_sandbox *load_account(uint64_t account) {
 
    lsb_register_vm_api(lsb);
 
-   lsb_err_value ret = lsb_init_ex(lsb, NULL, str_code);
+   std::string error;
+   //the contract itself is loaded from the precompiled chunk below
+   lsb_err_value ret = lsb_init_ex(lsb, NULL, "");
    if (ret) {
-      lsb_terminate(lsb, NULL);
-      lsb_destroy(lsb);
-      const char* error = lsb_get_error(lsb);
-      if (error) {
-         eosio_assert(0, error);
-      } else {
-         eosio_assert(0, "unknown error!");
-      }
+      destroy_sandbox(lsb, &error);
+      eosio_assert(0, error.c_str());
       return NULL;
    }
 
-   static const char *func_name = "apply";
    lua_State *lua = lsb_get_lua(lsb);
    if (!lua) {
-      lsb_terminate(lsb, NULL);
-      lsb_destroy(lsb);
-      const char* error = lsb_get_error(lsb);
-      if (error) {
-         eosio_assert(0, error);
-      } else {
-         eosio_assert(0, "unknown error!");
-      }
+      destroy_sandbox(lsb, &error);
+      eosio_assert(0, error.c_str());
       return NULL;
    }
 
-   if (lsb_pcall_setup(lsb, func_name)) {
-      lsb_terminate(lsb, NULL);
-      lsb_destroy(lsb);
+   int status;
+   {
+      scoped_state s(lua);
+      lua_sethook(lua, checktime_hook, LUA_MASKCOUNT, checktime_interval);
+      status = luaL_loadbuffer(lua, bytecode->data(), bytecode->size(), "contract");
+      if (status == 0) {
+         status = lua_pcall(lua, 0, 0, 0);
+      }
+      lua_sethook(lua, NULL, 0, 0);
+   }
+   if (status || s_deadline) {
+      const char *em = status ? lua_tostring(lua, -1) : NULL;
+      error = em ? em : "unknown error!";
+      destroy_sandbox(lsb, NULL);
+      rethrow_deadline();
+      eosio_assert(0, error.c_str());
       return NULL;
    }
 
-   account_map[account] = lsb;
+   lua_getglobal(lua, "apply");
+   bool has_apply = lua_isfunction(lua, -1);
+   lua_pop(lua, 1);
+   if (!has_apply || lua_cpcall(lua, snapshot_globals, NULL)) {
+      destroy_sandbox(lsb, NULL);
+      return NULL;
+   }
+   //start from the live objects only, as a sandbox that was reused does
+   lua_gc(lua, LUA_GCCOLLECT, 0);
    return lsb;
 }
 
+static void unload_contract(std::map<uint64_t, lua_contract>::iterator itr) {
+   destroy_sandbox(itr->second.lsb, NULL);
+   s_memory -= itr->second.memory;
+   account_lru.erase(itr->second.lru_pos);
+   account_map.erase(itr);
+}
+
+/*
+ * Evicts the least recently used sandboxes, except the one of account, until they fit in the memory budget
+ */
+static void evict_sandboxes(uint64_t account) {
+   while (s_memory > s_memory_budget && account_lru.size() > 1) {
+      uint64_t victim = account_lru.back();
+      if (victim == account) {
+         break;
+      }
+      unload_contract(account_map.find(victim));
+      s_stats.evicted++;
+   }
+}
+
+static lua_contract *load_account(uint64_t account) {
+   std::string code_id;
+   if (!get_code_version(account, code_id)) {
+      return NULL;
+   }
+
+   auto itr = account_map.find(account);
+   if (itr != account_map.end()) {
+      if (itr->second.code_id == code_id) {
+         account_lru.splice(account_lru.begin(), account_lru, itr->second.lru_pos);
+         return &itr->second;
+      }
+      //the code changed without a setcode going through this vm, e.g. on a fork switch
+      unload_contract(itr);
+   }
+
+   uint64_t start = get_microseconds();
+   lsb_lua_sandbox *lsb = create_sandbox(account, code_id);
+   if (!lsb) {
+      return NULL;
+   }
+   s_account_code[account] = code_id;
+
+   lua_contract& c = account_map[account];
+   c.lsb = lsb;
+   c.code_id = code_id;
+   if (s_verify_sandbox && !fingerprint_state(lsb_get_lua(lsb), c.fingerprint)) {
+      //can't be compared, rebuilt after every apply
+      c.fingerprint.clear();
+   }
+   c.memory = lsb_usage(lsb, LSB_UT_MEMORY, LSB_US_CURRENT);
+   account_lru.push_front(account);
+   c.lru_pos = account_lru.begin();
+   s_memory += c.memory;
+
+   s_stats.loads++;
+   s_stats.total_load_us += get_microseconds() - start;
+   return &c;
+}
+
+static void report_stats() {
+   const lua_stats& st = s_stats;
+   vmilog("lua sandboxes: %d live, ~%d KiB, %d bytecode chunks; loads %d (avg %d us), "
+          "applies %d (avg %d us, max %d us), evicted %d, dirty %d\n",
+          (int)account_map.size(), (int)(s_memory >> 10), (int)s_bytecode.size(),
+          (int)st.loads, (int)(st.loads ? st.total_load_us / st.loads : 0),
+          (int)st.applies, (int)(st.applies ? st.total_apply_us / st.applies : 0), (int)st.max_apply_us,
+          (int)st.evicted, (int)st.dirty);
+   s_stats = lua_stats();
+}
+
 int _apply(lsb_lua_sandbox *lsb, uint64_t receiver, uint64_t account, uint64_t act)
 {
    static const char *func_name = "apply";
@@ -172,6 +590,8 @@ int _apply(lsb_lua_sandbox *lsb, uint64_t receiver, uint64_t account, uint64_t a
    scoped_state s(lua);
 
    if (lsb_pcall_setup(lsb, func_name)) return 1;
+   //stop at the deadline of the transaction instead of after a fixed number of instructions
+   lua_sethook(lua, checktime_hook, LUA_MASKCOUNT, checktime_interval);
 
    int top = lua_gettop(lua);
 
@@ -189,6 +609,8 @@ int _apply(lsb_lua_sandbox *lsb, uint64_t receiver, uint64_t account, uint64_t a
       }
       lsb_set_error(lsb, err);
       //    lsb_terminate(lsb, err);
+      lua_pop(lua, 1);
+      lsb_pcall_teardown(lsb);
       return 0;
    }
 #if 0
@@ -220,6 +642,15 @@ void vm_init(struct vm_api* api) {
    int ok;
    printf("vm_lua: init\n");
    api->vm_run_lua_script = vm_run_lua_script;
+
+   char option[32] = {0};
+   if (api->get_option("lua-sandbox-memory-mb", option, sizeof(option) - 1)) {
+      s_memory_budget = strtoull(option, NULL, 10)*1024*1024;
+   }
+   memset(option, 0, sizeof(option));
+   if (api->get_option("lua-sandbox-verify", option, sizeof(option) - 1)) {
+      s_verify_sandbox = strcmp(option, "on") == 0;
+   }
    vm_register_api(api);
    luaV_set_check_time_fn(check_time);
 //   lua_State *L;
@@ -246,27 +677,58 @@ int vm_setcode(uint64_t account) {
 
 int vm_apply(uint64_t receiver, uint64_t account, uint64_t act) {
 //   printf("+++++vm_lua: apply\n");
-   auto itr = account_map.find(receiver);
-   lsb_lua_sandbox *lsb;
-   if (itr == account_map.end()) {
-      lsb = load_account(receiver);
-   } else {
-      lsb = itr->second;
-   }
-
-   if (!lsb) {
+   lua_contract *c = load_account(receiver);
+   if (!c) {
       return 0;
    }
 
-   int ret = _apply(lsb, receiver, account, act);
+   uint64_t start = get_microseconds();
+   int ret = _apply(c->lsb, receiver, account, act);
+   //a contract can catch the timeout error with pcall and return normally, the apply failed anyway
+   bool failed = ret == 0 || s_deadline;
+
+   std::string error;
    if (ret == 0) {
-      const char* error = lsb_get_error(lsb);
-      if (error) {
-         eosio_assert(0, error);
-      } else {
-         eosio_assert(0, "unknown error!");
+      const char* em = lsb_get_error(c->lsb);
+      error = em ? em : "unknown error!";
+   }
+   //a sandbox is rebuilt from the bytecode after a failed apply, after a successful one its top level
+   //globals are put back. With lua-sandbox-verify it is only reused if the apply left it as it was loaded,
+   //nested tables, upvalues and the standard library included
+   lua_State *lua = lsb_get_lua(c->lsb);
+   bool restored = !failed && lua && lua_cpcall(lua, restore_globals, NULL) == 0;
+   if (restored && s_verify_sandbox) {
+      std::string fingerprint;
+      restored = !c->fingerprint.empty() && fingerprint_state(lua, fingerprint) && fingerprint == c->fingerprint;
+      if (!restored) {
+         s_stats.dirty++;
       }
    }
+
+   uint64_t cost = get_microseconds() - start;
+   s_stats.applies++;
+   s_stats.total_apply_us += cost;
+   if (cost > s_stats.max_apply_us) {
+      s_stats.max_apply_us = cost;
+   }
+   if (s_stats.applies % stats_interval == 0) {
+      report_stats();
+   }
+
+   if (!restored) {
+      unload_contract(account_map.find(receiver));
+   } else {
+      lua_gc(lua, LUA_GCCOLLECT, 0);
+      size_t memory = lsb_usage(c->lsb, LSB_UT_MEMORY, LSB_US_CURRENT);
+      s_memory = s_memory - c->memory + memory;
+      c->memory = memory;
+      evict_sandboxes(receiver);
+   }
+
+   rethrow_deadline();
+   if (ret == 0) {
+      eosio_assert(0, error.c_str());
+   }
    return 1;
 }
 
@@ -278,10 +740,8 @@ int vm_call(uint64_t account, uint64_t func) {
 int vm_unload(uint64_t account) {
    auto itr = account_map.find(account);
    if (itr != account_map.end()) {
-      lsb_lua_sandbox *lsb = itr->second;
-      lsb_terminate(lsb, NULL);
-      lsb_destroy(lsb);
+      unload_contract(itr);
    }
+   release_bytecode(account);
    return 1;
 }
-
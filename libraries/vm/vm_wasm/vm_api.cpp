@@ -1022,6 +1022,17 @@ class database_api : public context_aware_api {
       int db_end_i64( uint64_t code, uint64_t scope, uint64_t table ) {
          return API()->db_end_i64( code, scope, table );
       }
+      int db_get_i64_many( uint64_t code, uint64_t scope, uint64_t table, array_ptr<const uint64_t> primaries, size_t count,
+                           array_ptr<char> buffer, size_t buffer_size, array_ptr<uint32_t> offsets, size_t offsets_len ) {
+         return API()->db_get_i64_many( code, scope, table, primaries, count, buffer, buffer_size, offsets, offsets_len );
+      }
+      int db_i64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper, array_ptr<uint64_t> primaries, size_t primaries_len ) {
+         return API()->db_i64_range( code, scope, table, lower, upper, primaries, primaries_len );
+      }
+      int db_idx64_range( uint64_t code, uint64_t scope, uint64_t table, uint64_t lower, uint64_t upper,
+                          array_ptr<uint64_t> secondaries, size_t secondaries_len, array_ptr<uint64_t> primaries, size_t primaries_len ) {
+         return API()->db_idx64_range( code, scope, table, lower, upper, secondaries, secondaries_len, primaries, primaries_len );
+      }
 
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx64,  uint64_t)
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx128, uint128_t)
@@ -1494,6 +1505,9 @@ REGISTER_INTRINSICS( database_api,
    (db_lowerbound_i64,   int(int64_t,int64_t,int64_t,int64_t))
    (db_upperbound_i64,   int(int64_t,int64_t,int64_t,int64_t))
    (db_end_i64,          int(int64_t,int64_t,int64_t))
+   (db_get_i64_many,     int(int64_t,int64_t,int64_t,int,int,int,int,int,int))
+   (db_i64_range,        int(int64_t,int64_t,int64_t,int64_t,int64_t,int,int))
+   (db_idx64_range,      int(int64_t,int64_t,int64_t,int64_t,int64_t,int,int,int,int))
 
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx64)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx128)
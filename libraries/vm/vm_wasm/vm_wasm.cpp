@@ -2,13 +2,17 @@
 #include <eosiolib_native/vm_api.h>
 #include <eosiolib/types.hpp>
 #include "vm_wasm_api.h"
+#include <eosio/chain/webassembly/memory_image.hpp>
+#include <string.h>
 
 using namespace eosio;
+using namespace eosio::chain::webassembly::common;
 
 int wasm_setcode(uint64_t account);
 int wasm_apply(uint64_t receiver, uint64_t account, uint64_t act);
 int wasm_preload(uint64_t account);
 int wasm_unload(uint64_t account);
+int wasm_load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size);
 
 namespace eosio {
    namespace chain {
@@ -32,6 +36,13 @@ void vm_init(struct vm_api* api) {
    api->wasm_to_wast = eosio::chain::wasm_to_wast;
    api->wast_to_wasm = eosio::chain::wast_to_wasm;
 
+   char reset_mode[16] = {0};
+   if (api->get_option("wasm-memory-reset", reset_mode, sizeof(reset_mode)) && strcmp(reset_mode, "copy") == 0) {
+      memory_image::set_mode(memory_reset_mode::copy);
+   } else {
+      memory_image::set_mode(memory_reset_mode::cow);
+   }
+
    eosio::chain::wasm_init_api();
 }
 
@@ -66,6 +77,10 @@ int vm_unload(uint64_t account) {
    return wasm_unload(account);
 }
 
+int vm_load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size) {
+   return wasm_load_code(account, code_id, code_id_size, code, code_size);
+}
+
 #if 0
 uint64_t _wasm_call(const char* act, uint64_t* args, int argc);
 uint64_t vm_call(const char* act, uint64_t* args, int argc) {
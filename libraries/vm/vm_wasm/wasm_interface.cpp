@@ -52,7 +52,6 @@ namespace eosio { namespace chain {
 
       //there are a couple opportunties for improvement here--
       //Easy: Cache the Module created here so it can be reused for instantiaion
-      //Hard: Kick off instantiation in a separate thread at this location
    }
 
    int wasm_interface::setcode( uint64_t account) {
@@ -64,20 +63,24 @@ namespace eosio { namespace chain {
       }
       validate(code, size);
 
-//      my->get_instantiated_module(account);
+      if (my->compile_pool) {
+         char code_id[8*4];
+         get_code_id(account, code_id, sizeof(code_id));
+         my->load_module_async(account, code_id, code, size);
+      }
       return 0;
    }
 
    uint64_t wasm_interface::call(string& func, vector<uint64_t>& args) {
-      return my->get_instantiated_module()->call(func, args);
+      auto module = my->get_instantiated_module();
+      auto lock = my->lock_runtime(false);
+      return module->call(func, args);
    }
 
    int wasm_interface::apply( uint64_t receiver, uint64_t account, uint64_t act ) {
       try {
-         auto& module = my->get_instantiated_module(receiver);
-         if (!module.get()) {
-            return 0;
-         }
+         auto module = my->get_instantiated_module(receiver);
+         auto lock = my->lock_runtime(true);
          module->apply(receiver, account, act);
       } catch ( const wasm_exit& ){
       }
@@ -89,10 +92,30 @@ namespace eosio { namespace chain {
       return 1;
    }
 
+   int wasm_interface::load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size) {
+      EOS_ASSERT(code_id_size == 8*4, wasm_exception, "invalid code_id size");
+      EOS_ASSERT(code_size > 0, wasm_exception, "code size should not be zero");
+      my->load_module(account, code_id, code, code_size);
+      return 1;
+   }
+
    int wasm_interface::unload(uint64_t account) {
       return my->unload_module(account);
    }
 
+   wasm_interface::compile_metrics wasm_interface::get_compile_metrics() const {
+      compile_metrics metrics;
+      metrics.queue_depth = my->compile_metrics.queue_depth;
+      metrics.compiled = my->compile_metrics.compiled;
+      metrics.total_compile_us = my->compile_metrics.total_compile_us;
+      metrics.max_compile_us = my->compile_metrics.max_compile_us;
+      return metrics;
+   }
+
+   instance_cache::stats wasm_interface::get_cache_stats() const {
+      return my->instances.get_stats();
+   }
+
    wasm_instantiated_module_interface::~wasm_instantiated_module_interface() {}
    wasm_runtime_interface::~wasm_runtime_interface() {}
 
@@ -116,6 +139,10 @@ int wasm_unload(uint64_t account) {
    return wasm_interface::get().unload(account);
 }
 
+int wasm_load_code(uint64_t account, const char* code_id, size_t code_id_size, const char* code, size_t code_size) {
+   return wasm_interface::get().load_code(account, code_id, code_id_size, code, code_size);
+}
+
 uint64_t _wasm_call(const char* act, uint64_t* args, int argc) {
    vector<uint64_t> v;
    for (int i=0;i<argc;i++) {
@@ -0,0 +1,166 @@
+#include "preload_scheduler.hpp"
+
+#include <chrono>
+
+#include <boost/bind.hpp>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/name.hpp>
+
+namespace eosio {
+namespace chain {
+
+preload_scheduler::~preload_scheduler() {
+   stop();
+}
+
+void preload_scheduler::start(int threads) {
+   if (threads <= 0 || is_running()) {
+      return;
+   }
+   stopping = false;
+   for (int i = 0; i < threads; i++) {
+      workers.emplace_back(std::make_unique<worker_queue>());
+   }
+   for (int i = 0; i < threads; i++) {
+      this->threads.create_thread( boost::bind( &preload_scheduler::run, this, i ) );
+   }
+}
+
+void preload_scheduler::stop() {
+   if (!is_running()) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(idle_lock);
+      stopping = true;
+   }
+   idle.notify_all();
+   threads.join_all();
+   workers.clear();
+   queued = 0;
+
+   std::lock_guard<std::mutex> lock(stats_lock);
+   queued_accounts.clear();
+}
+
+bool preload_scheduler::schedule(uint64_t account, uint64_t priority, job load) {
+   if (!is_running() || stopping) {
+      return false;
+   }
+   {
+      std::lock_guard<std::mutex> lock(stats_lock);
+      if (!queued_accounts.insert(account).second) {
+         return false;
+      }
+   }
+
+   //count the job before it becomes visible so that a worker never takes a job it wasn't told about
+   {
+      std::lock_guard<std::mutex> lock(idle_lock);
+      queued++;
+   }
+   worker_queue& q = *workers[next_worker++ % workers.size()];
+   {
+      std::lock_guard<std::mutex> lock(q.lock);
+      auto it = q.tasks.begin();
+      while (it != q.tasks.end() && it->priority >= priority) {
+         ++it;
+      }
+      q.tasks.insert(it, task{account, priority, std::move(load)});
+   }
+   idle.notify_one();
+   return true;
+}
+
+bool preload_scheduler::pop(size_t index, task& t) {
+   worker_queue& q = *workers[index];
+   std::lock_guard<std::mutex> lock(q.lock);
+   if (q.tasks.empty()) {
+      return false;
+   }
+   t = std::move(q.tasks.front());
+   q.tasks.pop_front();
+   return true;
+}
+
+bool preload_scheduler::steal(size_t index, task& t) {
+   //take the most urgent job any other worker is sitting on
+   worker_queue* victim = nullptr;
+   uint64_t best = 0;
+   for (size_t i = 1; i < workers.size(); i++) {
+      worker_queue& q = *workers[(index + i) % workers.size()];
+      std::lock_guard<std::mutex> lock(q.lock);
+      if (!q.tasks.empty() && (!victim || q.tasks.front().priority > best)) {
+         victim = &q;
+         best = q.tasks.front().priority;
+      }
+   }
+   if (!victim) {
+      return false;
+   }
+   std::lock_guard<std::mutex> lock(victim->lock);
+   if (victim->tasks.empty()) {
+      return false;
+   }
+   t = std::move(victim->tasks.front());
+   victim->tasks.pop_front();
+   return true;
+}
+
+void preload_scheduler::run(size_t index) {
+   while (true) {
+      task t;
+      if (!pop(index, t) && !steal(index, t)) {
+         std::unique_lock<std::mutex> lock(idle_lock);
+         idle.wait(lock, [this]() { return stopping || queued > 0; });
+         if (stopping) {
+            return;
+         }
+         continue;
+      }
+      {
+         std::lock_guard<std::mutex> lock(idle_lock);
+         queued--;
+      }
+
+      bool failed = false;
+      auto start = std::chrono::steady_clock::now();
+      try {
+         t.load();
+      } catch ( const fc::exception& e ) {
+         failed = true;
+         elog("preloading ${a} failed: ${e}", ("a", name(t.account))("e", e.to_detail_string()));
+      } catch ( const std::exception& e ) {
+         failed = true;
+         elog("preloading ${a} failed: ${e}", ("a", name(t.account))("e", e.what()));
+      } catch ( ... ) {
+         failed = true;
+         elog("preloading ${a} failed", ("a", name(t.account)));
+      }
+      uint64_t cost = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+      std::lock_guard<std::mutex> lock(stats_lock);
+      queued_accounts.erase(t.account);
+      account_stats& s = stats[t.account];
+      s.loads++;
+      s.last_load_us = cost;
+      s.total_load_us += cost;
+      if (cost > s.max_load_us) {
+         s.max_load_us = cost;
+      }
+      s.failed = failed;
+   }
+}
+
+bool preload_scheduler::is_queued(uint64_t account) {
+   std::lock_guard<std::mutex> lock(stats_lock);
+   return queued_accounts.find(account) != queued_accounts.end();
+}
+
+std::map<uint64_t, preload_scheduler::account_stats> preload_scheduler::get_stats() {
+   std::lock_guard<std::mutex> lock(stats_lock);
+   return stats;
+}
+
+}
+}
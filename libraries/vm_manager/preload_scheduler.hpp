@@ -0,0 +1,86 @@
+#pragma once
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+namespace eosio {
+namespace chain {
+
+/**
+ * @class preload_scheduler
+ *
+ * Persistent pool that loads contracts ahead of their first apply.
+ *
+ * Every worker owns a queue ordered by priority and takes the most urgent job from it, an idle worker
+ * steals the most urgent job of the other queues. Jobs must carry everything they need, workers never
+ * touch chain state.
+ */
+class preload_scheduler {
+public:
+   struct account_stats {
+      uint64_t loads = 0;
+      uint64_t last_load_us = 0;
+      uint64_t max_load_us = 0;
+      uint64_t total_load_us = 0;
+      bool     failed = false;
+   };
+
+   typedef std::function<void()> job;
+
+   ~preload_scheduler();
+
+   void start(int threads);
+   void stop();
+   bool is_running() const { return !workers.empty(); }
+
+   /**
+    * Queues the load of account, an account that is already queued keeps its place
+    * @return false if the account is already queued or the scheduler isn't running
+    */
+   bool schedule(uint64_t account, uint64_t priority, job load);
+
+   bool is_queued(uint64_t account);
+   std::map<uint64_t, account_stats> get_stats();
+
+private:
+   struct task {
+      uint64_t account;
+      uint64_t priority;
+      job      load;
+   };
+
+   struct worker_queue {
+      std::mutex       lock;
+      std::deque<task> tasks; //highest priority first
+   };
+
+   void run(size_t index);
+   bool pop(size_t index, task& t);
+   bool steal(size_t index, task& t);
+
+   std::vector<std::unique_ptr<worker_queue>> workers;
+   boost::thread_group threads;
+   std::atomic<size_t> next_worker{0};
+   std::atomic<bool> stopping{false};
+
+   std::mutex idle_lock;
+   std::condition_variable idle;
+   size_t queued = 0; //guarded by idle_lock
+
+   std::mutex stats_lock;
+   std::set<uint64_t> queued_accounts;
+   std::map<uint64_t, account_stats> stats;
+};
+
+}
+}
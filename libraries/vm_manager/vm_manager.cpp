@@ -34,8 +34,7 @@ namespace chain {
 }
 }
 
-#define WAVM_VM_START_INDEX (0x10000)
-#define VM_WASM_WAVM_COUNT (1)
+static const uint64_t apply_decay_interval = 10000;
 
 typedef void (*fn_on_boost_account)(void* v, uint64_t account, uint64_t expiration);
 void visit_boost_account(fn_on_boost_account fn, void* param);
@@ -163,20 +162,6 @@ vm_manager& vm_manager::get() {
    return *mngr;
 }
 
-class time_counter {
-public:
-   time_counter(uint64_t _account) {
-      account = _account;
-      start = get_microseconds();
-   }
-   ~time_counter() {
-      wlog("loading ${n1} cost ${n2}", ("n1", name(account))("n2", get_microseconds()-start));
-   }
-private:
-   uint64_t account;
-   uint64_t start;
-};
-
 bool vm_manager::init() {
    static bool init = false;
    if (init) {
@@ -237,96 +222,98 @@ int vm_manager::load_vm_wavm() {
 #else
     load_vm_from_path(default_wavm_index, vm_libs_path[default_wavm_index]);
 #endif
-   char _path[128];
-   const char* _format = "../libs/libvm_wasm_wavm-%d" DYLIB_SUFFIX;
 
-   for (int i=1;i<=VM_WASM_WAVM_COUNT;i++) {
-      snprintf(_path, sizeof(_path), _format, i);
-      load_vm_from_path(WAVM_VM_START_INDEX|i, _path);
+   //the WAVM runtime compiles one module at a time, extra workers only overlap the rest of a load with it
+   int threads = 1;
+   char option[16] = {0};
+   if (get_vm_api()->get_option("preload-threads", option, sizeof(option) - 1) > 0) {
+      threads = atoi(option);
    }
-
-   visit_boost_account(_on_boost_account, this);
-
-   auto itr = vm_map.find(3);
-   if (itr != vm_map.end()) {
-      for (uint64_t account : {N(eosio.token), N(eosio)}) {
-         if (db_api::get().is_account(account) && db_api::get().get_code(account).size() > 0) {
-            if (db_api::get().get_code_type(account) == 0) {
-               auto t = time_counter(account);
-               itr->second->preload(account);
-               std::unique_ptr<vm_calls> calls = std::make_unique<vm_calls>();
-               *calls = *itr->second;
-               preload_account_map[account] = std::move(calls);
-            }
-         }
-      }
+   if (threads > 0) {
+      scheduler.start(threads);
+      wlog("preloading code in ${n} threads", ("n", threads));
    }
 
-   if (boost_accounts.size() > 0) {
-      boost::thread_group g;
+   //system contracts go first, the boost accounts are ordered by how often they have been applied so far.
+   //Nothing has been applied yet at startup, accounts with the same count keep the order they are listed in
+   for (uint64_t account : {N(eosio.token), N(eosio)}) {
+      schedule_preload(account, UINT64_MAX);
+   }
 
-      int cpu_num = std::thread::hardware_concurrency();
-      if (cpu_num <= 0) {
-         cpu_num = 1;
-      }
+   visit_boost_account(_on_boost_account, this);
+   for (uint64_t account : boost_accounts) {
+      schedule_preload(account, apply_counts[account]);
+   }
+   boost_accounts.clear();
+   return 1;
+}
 
-      wlog("preloading code in ${n} threads", ("n", cpu_num));
+bool vm_manager::schedule_preload(uint64_t account, uint64_t priority) {
+   auto itr = vm_map.find(VM_TYPE_WAVM);
+   if (itr == vm_map.end() || !itr->second->load_code) {
+      return false;
+   }
+   if (scheduler.is_queued(account)) {
+      return false;
+   }
+   if (!db_api::get().is_account(account) || db_api::get().get_code_type(account) != 0) {
+      return false;
+   }
 
-      for (int i=1;i<=cpu_num;i++) {//TODO: 10 --> number of CPU cores
-         auto itr = vm_map.find(WAVM_VM_START_INDEX|i);
-         if (itr == vm_map.end()) {
-            continue;
-         }
-         if (!itr->second->preload) {
-            continue;
-         }
+   //workers must not read chainbase while blocks are applied, hand them a copy of the code
+   const auto& code = db_api::get().get_code(account);
+   if (code.size() == 0) {
+      return false;
+   }
+   auto code_id = db_api::get().get_code_id(account);
+   fn_load_code load_code = itr->second->load_code;
+   return scheduler.schedule(account, priority,
+         [load_code, account, code_id, bytes = std::vector<char>(code.data(), code.data() + code.size())]() {
+      load_code(account, code_id.data(), code_id.data_size(), bytes.data(), bytes.size());
+   });
+}
 
-         const auto _calls = itr->second.get();
-         g.create_thread( boost::bind( &vm_manager::preload_accounts,this, _calls ) );
-      }
-      g.join_all();
+vector<preload_stats> vm_manager::get_preload_stats() {
+   vector<preload_stats> result;
+   for (auto& s : scheduler.get_stats()) {
+      auto it = apply_counts.find(s.first);
+      result.push_back(preload_stats{s.first, it != apply_counts.end() ? it->second : 0,
+                                     s.second.loads, s.second.last_load_us, s.second.max_load_us,
+                                     s.second.total_load_us, s.second.failed});
    }
-   return 1;
+   return result;
 }
 
-void vm_manager::preload_accounts(vm_calls* _calls) {
-   static std::mutex m1, m2;
-   while(true) {
-      uint64_t account;
-      {
-         std::lock_guard<std::mutex> lock(m1);
-         if (boost_accounts.empty()) {
-            break;
+void vm_manager::on_apply(uint64_t receiver, uint64_t act) {
+   apply_counts[receiver]++;
+   if (++applies_since_decay >= apply_decay_interval) {
+      //keep the counters about recent traffic only
+      applies_since_decay = 0;
+      for (auto it = apply_counts.begin(); it != apply_counts.end();) {
+         it->second /= 2;
+         if (it->second == 0) {
+            it = apply_counts.erase(it);
+         } else {
+            ++it;
          }
-         account = boost_accounts.back();
-         boost_accounts.pop_back();
       }
-      {
-         if (account == N(eosio) || account == N(eosio.token)) {
-            continue;//already loaded in vm type 3
-         }
-         {
-            auto t = time_counter(account);
-            _calls->preload(account);
-         }
+   }
 
-         std::unique_ptr<vm_calls> calls = std::make_unique<vm_calls>();
-         *calls = *_calls;
-         {
-            std::lock_guard<std::mutex> lock(m2);
-            preload_account_map[account] = std::move(calls);
-         }
-      }
+   if (receiver != N(eosio.prods) || act != N(votejit)) {
+      return;
+   }
+   //votejit(producer, account, last_code_update), the vote that activates an account makes it a jit account
+   uint64_t args[2];
+   if (this->api->action_data_size() < sizeof(args)) {
+      return;
+   }
+   this->api->read_action_data(args, sizeof(args));
+   if (is_jit_account_activated(args[1])) {
+      schedule_preload(args[1], apply_counts[args[1]]);
    }
 }
 
 void vm_manager::unload_account(uint64_t account) {
-   auto itr = preload_account_map.find(account);
-   if (itr != preload_account_map.end()) {
-      itr->second->unload(account);
-      preload_account_map.erase(itr);
-   }
-
    auto _itr = vm_map.find(3);
    if (_itr != vm_map.end()) {
       _itr->second->unload(account);
@@ -389,6 +376,7 @@ int vm_manager::load_vm_from_path(int vm_type, const char* vm_path) {
    }
    */
    fn_unload unload = (fn_unload)dlsym(handle, "vm_unload");
+   fn_load_code load_code = (fn_load_code)dlsym(handle, "vm_load_code");
 
    auto __itr = vm_map.find(vm_type);
    if (__itr != vm_map.end()) {
@@ -409,6 +397,7 @@ int vm_manager::load_vm_from_path(int vm_type, const char* vm_path) {
    calls->call = _call;
    calls->preload = preload;
    calls->unload = unload;
+   calls->load_code = load_code;
 
    vm_map[vm_type] = std::move(calls);
    return 1;
@@ -584,7 +573,9 @@ int vm_manager::apply(int type, uint64_t receiver, uint64_t account, uint64_t ac
          type = VM_TYPE_IPC;
       }
    }
-   return local_apply(type, receiver, account, act);
+   int ret = local_apply(type, receiver, account, act);
+   on_apply(receiver, act);
+   return ret;
 }
 
 int vm_manager::call(uint64_t account, uint64_t func) {
@@ -641,6 +632,7 @@ uint64_t vm_manager::wasm_call(const string& func, vector<uint64_t> args) {
 }
 
 int vm_manager::vm_deinit_all() {
+   scheduler.stop();
    for (auto itr = vm_map.begin();itr != vm_map.end();itr++) {
       itr->second->vm_deinit();
    }
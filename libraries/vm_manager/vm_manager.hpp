@@ -13,6 +13,8 @@
 
 #include <eosio/chain/db_api.hpp>
 
+#include "preload_scheduler.hpp"
+
 
 using namespace std;
 
@@ -31,6 +33,17 @@ struct vm_calls {
    fn_call call;
    fn_preload preload;
    fn_unload unload;
+   fn_load_code load_code;
+};
+
+struct preload_stats {
+   uint64_t account;
+   uint64_t applies;       //recent applies, halved every apply_decay_interval applies
+   uint64_t loads;
+   uint64_t last_load_us;
+   uint64_t max_load_us;
+   uint64_t total_load_us;
+   bool     failed;
 };
 
 
@@ -59,7 +72,8 @@ public:
 
    uint64_t wasm_call(const string& func, vector<uint64_t> args);
    void on_boost_account(uint64_t account);
-   void preload_accounts(vm_calls* _calls);
+   bool schedule_preload(uint64_t account, uint64_t priority);
+   vector<preload_stats> get_preload_stats();
 
    void unload_account(uint64_t account);
    bool is_trusted_account(uint64_t account);
@@ -70,10 +84,15 @@ public:
 private:
    vm_manager();
    struct vm_api* api;
+   void on_apply(uint64_t receiver, uint64_t act);
+
    vector<uint64_t> boost_accounts;
    map<uint64_t, uint64_t> trusted_accounts;
    map<int, std::unique_ptr<vm_calls>> vm_map;
-   map<uint64_t, std::unique_ptr<vm_calls>> preload_account_map;
+
+   preload_scheduler scheduler;
+   map<uint64_t, uint64_t> apply_counts;
+   uint64_t applies_since_decay = 0;
 };
 
 }
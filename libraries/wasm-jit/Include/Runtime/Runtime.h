@@ -210,9 +210,14 @@ namespace Runtime
 	RUNTIME_API uint64_t getDefaultMemorySize(ModuleInstance* moduleInstance);
 	RUNTIME_API TableInstance* getDefaultTable(ModuleInstance* moduleInstance);
 
+	// Gets the number of bytes of the image the JIT compiled a ModuleInstance's code into.
+	RUNTIME_API Uptr getJITCodeSize(ModuleInstance* moduleInstance);
+
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
+	// Resizes the memory to newMemoryType's minimum size without zeroing the pages that remain committed.
+	RUNTIME_API void resizeMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
 
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
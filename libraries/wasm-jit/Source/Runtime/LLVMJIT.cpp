@@ -169,6 +169,7 @@ namespace LLVMJIT
 		}
 
 		U8* getImageBaseAddress() const { return imageBaseAddress; }
+		Uptr getNumImageBytes() const { return numAllocatedImagePages << Platform::getPageSizeLog2(); }
 
 	private:
 		struct Section
@@ -240,6 +241,8 @@ namespace LLVMJIT
 
 		void compile(llvm::Module* llvmModule);
 
+		Uptr getNumImageBytes() const { return memoryManager.getNumImageBytes(); }
+
 		virtual void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) = 0;
 
 	private:
@@ -294,6 +297,8 @@ namespace LLVMJIT
 		std::vector<JITSymbol*> functionDefSymbols;
 
 		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance) {}
+
+		Uptr getCodeSize() const override { return getNumImageBytes(); }
 		~JITModule() override
 		{
 			// Delete the module's symbols, and remove them from the global address-to-symbol map.
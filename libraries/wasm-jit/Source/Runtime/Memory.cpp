@@ -98,6 +98,32 @@ namespace Runtime
 			causeException(Exception::Cause::outOfMemory);
    }
 
+	void resizeMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
+		// Unlike resetMemory this leaves the contents of the committed pages alone, the caller restores them.
+		const Uptr numPages = memory->numPages;
+		const Uptr minPages = Uptr(newMemoryType.size.min);
+		memory->type = newMemoryType;
+		if(numPages > minPages)
+		{
+			memory->numPages = minPages;
+			Platform::decommitVirtualPages(
+				memory->baseAddress + (minPages << IR::numBytesPerPageLog2),
+				(numPages - minPages) << getPlatformPagesPerWebAssemblyPageLog2()
+				);
+		}
+		else if(numPages < minPages)
+		{
+			if(!Platform::commitVirtualPages(
+				memory->baseAddress + (numPages << IR::numBytesPerPageLog2),
+				(minPages - numPages) << getPlatformPagesPerWebAssemblyPageLog2()
+				))
+			{
+				causeException(Exception::Cause::outOfMemory);
+			}
+			memory->numPages = minPages;
+		}
+	}
+
 	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
 	{
 		const Uptr previousNumPages = memory->numPages;
@@ -17,6 +17,7 @@ namespace LLVMJIT
 	struct JITModuleBase
 	{
 		virtual ~JITModuleBase() {}
+		virtual Uptr getCodeSize() const = 0;
 	};
 
 	void init();
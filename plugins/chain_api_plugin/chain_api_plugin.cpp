@@ -4,6 +4,7 @@
  */
 #include <eosio/chain_api_plugin/chain_api_plugin.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain_plugin/read_only_call.hpp>
 
 #include <fc/io/json.hpp>
 
@@ -68,7 +69,8 @@ struct async_result_visitor : public fc::visitor<std::string> {
    }\
 }
 
-#define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL(call_name, http_response_code) CALL_READ_ONLY(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL_MAIN(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
@@ -84,7 +86,7 @@ void chain_api_plugin::plugin_startup() {
 
    _http_plugin.add_api({
       CHAIN_RO_CALL(get_info, 200l),
-      CHAIN_RO_CALL(get_block, 200),
+      CHAIN_RO_CALL_MAIN(get_block, 200), // reads share the stream of the block log
       CHAIN_RO_CALL(get_block_header_state, 200),
       CHAIN_RO_CALL(get_account, 200),
       CHAIN_RO_CALL(get_code, 200),
@@ -3,6 +3,7 @@
  *  @copyright defined in eos/LICENSE.txt
  */
 #include <eosio/chain_plugin/chain_plugin.hpp>
+#include <eosio/chain_plugin/read_only_pool.hpp>
 #include <eosio/chain/fork_database.hpp>
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/exceptions.hpp>
@@ -110,6 +111,39 @@ void validate(boost::any& v,
   }
 }
 
+std::ostream& operator<<(std::ostream& osm, eosio::chain::trace_verbosity v) {
+   if ( v == eosio::chain::trace_verbosity::FULL ) {
+      osm << "full";
+   } else if ( v == eosio::chain::trace_verbosity::MINIMAL ) {
+      osm << "minimal";
+   }
+
+   return osm;
+}
+
+void validate(boost::any& v,
+              const std::vector<std::string>& values,
+              eosio::chain::trace_verbosity* /* target_type */,
+              int)
+{
+  using namespace boost::program_options;
+
+  // Make sure no previous assignment to 'v' was made.
+  validators::check_first_occurrence(v);
+
+  // Extract the first string from 'values'. If there is more than
+  // one string, it's an error, and exception will be thrown.
+  std::string const& s = validators::get_single_string(values);
+
+  if ( s == "full" ) {
+     v = boost::any(eosio::chain::trace_verbosity::FULL);
+  } else if ( s == "minimal" ) {
+     v = boost::any(eosio::chain::trace_verbosity::MINIMAL);
+  } else {
+     throw validation_error(validation_error::invalid_option_value);
+  }
+}
+
 }
 
 using namespace eosio;
@@ -169,6 +203,9 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
    fc::optional<bfs::path>          snapshot_path;
+   uint32_t                         read_only_threads = 0;
+   uint32_t                         read_only_window_us = 0;
+   read_only_pool                   read_pool{app().get_io_service()};
 
 
    // retained references to channels for easy publication
@@ -217,6 +254,28 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "the location of the blocks directory (absolute path or relative to application data dir)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<eosio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("wasm-memory-reset", bpo::value<string>()->default_value("cow")->value_name("cow/copy"),
+          "How WASM linear memory is restored between applies, \"cow\" drops only the pages touched by the previous apply, \"copy\" zeroes and recopies the whole memory")
+         ("wasm-module-cache-dir", bpo::value<string>()->value_name("dir"),
+          "Directory of the on-disk cache of injected WASM modules, defaults to wasm_cache in the data directory")
+         ("wasm-cache-size-mb", bpo::value<uint64_t>()->default_value(1024),
+          "Approximate memory budget (in MiB) of the instantiated WASM module cache, counting code, jitted code and linear memory. Least recently used modules are evicted past it. 0 for no limit")
+         ("wasm-compile-threads", bpo::value<uint32_t>()->default_value(1),
+          "Compile the WAVM modules of new code in a background thread (1) or on the apply thread (0). WAVM compiles one module at a time, higher values are rejected")
+         ("preload-threads", bpo::value<uint32_t>()->default_value(1),
+          "Number of threads preloading the jit contracts listed in eosio.prods, each keeps its own queue and steals from the others when it runs dry. WAVM compiles one module at a time, so more threads only overlap the rest of a load with the compile. 0 disables preloading")
+         ("python-sandbox-pool-size", bpo::value<uint32_t>()->default_value(4),
+          "Number of Python sub-interpreters kept ready for contracts that haven't run yet")
+         ("python-sandbox-memory-mb", bpo::value<uint64_t>()->default_value(512),
+          "Approximate memory budget (in MiB) of Python sandboxes, the least recently used ones are torn down past it")
+         ("lua-sandbox-memory-mb", bpo::value<uint64_t>()->default_value(64),
+          "Approximate memory budget (in MiB) of Lua contract sandboxes, the least recently used ones are torn down past it")
+         ("lua-sandbox-verify", bpo::value<string>()->default_value("off")->value_name("on/off"),
+          "Fingerprint the whole state of a Lua sandbox after every apply and rebuild it if the apply changed anything. When off only the top level globals are reset between applies, which is much cheaper")
+         ("ipc-workers", bpo::value<uint32_t>()->default_value(1),
+          "Number of ipc client processes per VM type, the actions of a contract always go to the same healthy process")
+         ("ipc-write-batch", bpo::value<string>()->default_value("on")->value_name("on/off"),
+          "Buffer the db writes of contracts running in an ipc client and send them to the node in one message when the action finishes or reads them back. Writes are checked before they are buffered, those charging ram to another account than the contract are never buffered")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
@@ -225,6 +284,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
+         ("parallel-stats", bpo::bool_switch()->default_value(false),
+          "instrumentation only: record the tables every transaction reads and writes and estimate how each committed block could have been scheduled over 1 to 16 cores; transactions are still executed serially")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
           "Account added to actor whitelist (may specify multiple times)")
          ("actor-blacklist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -248,6 +309,20 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "Chain validation mode (\"full\" or \"light\").\n"
           "In \"full\" mode all incoming blocks will be fully validated.\n"
           "In \"light\" mode all incoming blocks headers will be fully validated; transactions in those validated blocks will be trusted \n")
+         ("trace-verbosity", boost::program_options::value<eosio::chain::trace_verbosity>()->default_value(eosio::chain::trace_verbosity::FULL),
+          "Action trace verbosity (\"full\" or \"minimal\").\n"
+          "In \"full\" mode action traces carry a copy of their action and the console output of the contract.\n"
+          "In \"minimal\" mode action traces only carry the account and name of their action, console output is kept only with --contracts-console. "
+          "Plugins that store traces switch the node back to \"full\".\n")
+         ("read-only-threads", bpo::value<uint32_t>()->default_value(0),
+          "Number of threads serving read only chain and history api calls. 0 to serve them on the main thread")
+         ("read-only-window-us", bpo::value<uint32_t>()->default_value(5000),
+          "Time (in microseconds) the main thread lets read only threads start reads before it goes back to applying blocks and transactions. "
+          "Reads that walk rows return what they have once it is over, the main thread waits for the reads in flight")
+         ("abi-cache-size", bpo::value<uint32_t>()->default_value(1024),
+          "Number of accounts whose parsed ABI is kept for API calls and trace serialization")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(10000),
+          "Number of public keys recovered from transaction signatures that are kept, so that a transaction received ahead of its block is not recovered again")
          ("disable-ram-billing-notify-checks", bpo::bool_switch()->default_value(false),
           "Disable the check which subjectively fails a transaction if a contract bills more RAM to another account within the context of a notification handler (i.e. when the receiver is not the code of the action).")
          ;
@@ -410,6 +485,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "chain-state-db-size-mb" ))
          my->chain_config->state_size = options.at( "chain-state-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
+      EOS_ASSERT( options.at( "wasm-compile-threads" ).as<uint32_t>() <= 1, plugin_config_exception,
+                  "wasm-compile-threads must be 0 or 1, WAVM compiles one module at a time" );
+
       if( options.count( "chain-state-db-guard-size-mb" ))
          my->chain_config->state_guard_size = options.at( "chain-state-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
@@ -426,6 +504,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
+      my->chain_config->record_parallel_stats = options.at( "parallel-stats" ).as<bool>();
       my->chain_config->skip_signature_check = options.at( "skip-signature-check" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
 
@@ -617,6 +696,15 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          my->chain_config->block_validation_mode = options.at("validation-mode").as<validation_mode>();
       }
 
+      transaction::set_recovery_cache_size( options.at( "signature-cache-size" ).as<uint32_t>() );
+      abi_cache::instance().set_max_size( options.at( "abi-cache-size" ).as<uint32_t>() );
+      my->read_only_threads = options.at( "read-only-threads" ).as<uint32_t>();
+      my->read_only_window_us = options.at( "read-only-window-us" ).as<uint32_t>();
+
+      if ( options.count("trace-verbosity") ) {
+         my->chain_config->trace_level = options.at("trace-verbosity").as<trace_verbosity>();
+      }
+
       my->chain.emplace( *my->chain_config );
       my->chain_id.emplace( my->chain->get_chain_id());
 
@@ -713,6 +801,11 @@ void chain_plugin::plugin_startup()
         ("num", my->chain->head_block_num())("ts", (std::string)my->chain_config->genesis.initial_timestamp));
 
    my->chain_config.reset();
+
+   if( my->read_only_threads > 0 ) {
+      ilog("serving read only api calls on ${n} threads in windows of ${w} us", ("n", my->read_only_threads)("w", my->read_only_window_us));
+      my->read_pool.start( my->read_only_threads, my->read_only_window_us );
+   }
 } FC_CAPTURE_AND_RETHROW() }
 
 void chain_plugin::plugin_shutdown() {
@@ -724,6 +817,7 @@ void chain_plugin::plugin_shutdown() {
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
    my->accepted_confirmation_connection.reset();
+   my->read_pool.stop();
    my->chain.reset();
 }
 
@@ -970,6 +1064,10 @@ fc::microseconds chain_plugin::get_abi_serializer_max_time() const {
    return my->abi_serializer_max_time_ms;
 }
 
+void chain_plugin::execute_read_only( std::function<void()> read ) {
+   my->read_pool.execute( std::move( read ) );
+}
+
 void chain_plugin::log_guard_exception(const chain::guard_exception&e ) const {
    if (e.code() == chain::database_guard_exception::code_value) {
       elog("Database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
@@ -1094,36 +1192,36 @@ uint64_t convert_to_type(const string& str, const string& desc) {
    return value;
 }
 
-abi_def get_abi( const controller& db, const name& account ) {
+/**
+ *  The parsed abi of account from the abi_cache, an empty one if the account has no abi
+ */
+cached_abi_ptr get_cached_abi( const controller& db, const name& account, const fc::microseconds& max_serialization_time ) {
+   static const cached_abi_ptr no_abi = std::make_shared<cached_abi>();
    const auto &d = db.db();
-   const account_object *code_accnt = d.find<account_object, by_name>(account);
-   EOS_ASSERT(code_accnt != nullptr, account_query_exception, "Fail to retrieve account for ${account}", ("account", account) );
-   abi_def abi;
-   abi_serializer::to_abi(code_accnt->abi, abi);
-   return abi;
+   EOS_ASSERT(d.find<account_object, by_name>(account) != nullptr, account_query_exception, "Fail to retrieve account for ${account}", ("account", account) );
+   auto abi = abi_cache::instance().get( d, account, max_serialization_time );
+   return abi ? abi : no_abi;
 }
 
-string get_table_type( const abi_def& abi, const name& table_name ) {
-   for( const auto& t : abi.tables ) {
-      if( t.name == table_name ){
-         return t.index_type;
-      }
-   }
-   EOS_ASSERT( false, contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
+string get_table_type( const cached_abi& abi, const name& table_name ) {
+   auto index_type = abi.get_table_index_type( table_name );
+   EOS_ASSERT( index_type, contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
+   return *index_type;
 }
 
 read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
+   const auto cached = get_cached_abi( db, p.code, abi_serializer_max_time );
+   const auto& abi = cached->serializer;
 
    bool primary = false;
    auto table_with_index = get_table_index_name( p, primary );
    if( primary ) {
       EOS_ASSERT( p.table == table_with_index, contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
-      auto table_type = get_table_type( abi, p.table );
+      auto table_type = get_table_type( *cached, p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
          return get_table_rows_ex<key_value_index>(p,abi);
       }
-      EOS_ASSERT( false, contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
+      EOS_ASSERT( false, contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",cached->abi));
    } else {
       EOS_ASSERT( !p.key_type.empty(), contract_table_query_exception, "key type required for non-primary index" );
 
@@ -1196,13 +1294,13 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
    read_only::get_table_by_scope_result result;
    for (; itr != upper; ++itr) {
       if (p.table && itr->table != p.table) {
-         if (fc::time_point::now() > end) {
+         if (fc::time_point::now() > end || read_only_pool::past_deadline()) {
             break;
          }
          continue;
       }
       result.rows.push_back({itr->code, itr->scope, itr->table, itr->payer, itr->count});
-      if (++count == p.limit || fc::time_point::now() > end) {
+      if (++count == p.limit || fc::time_point::now() > end || read_only_pool::past_deadline()) {
          ++itr;
          break;
       }
@@ -1215,8 +1313,8 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
 
 vector<asset> read_only::get_currency_balance( const read_only::get_currency_balance_params& p )const {
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   auto table_type = get_table_type( abi, "accounts" );
+   const auto abi = get_cached_abi( db, p.code, abi_serializer_max_time );
+   auto table_type = get_table_type( *abi, "accounts" );
 
    vector<asset> results;
    walk_key_value_table(p.code, p.account, N(accounts), [&](const key_value_object& obj){
@@ -1243,8 +1341,8 @@ vector<asset> read_only::get_currency_balance( const read_only::get_currency_bal
 fc::variant read_only::get_currency_stats( const read_only::get_currency_stats_params& p )const {
    fc::mutable_variant_object results;
 
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-   auto table_type = get_table_type( abi, "stat" );
+   const auto abi = get_cached_abi( db, p.code, abi_serializer_max_time );
+   auto table_type = get_table_type( *abi, "stat" );
 
    uint64_t scope = ( eosio::chain::string_to_symbol( 0, boost::algorithm::to_upper_copy(p.symbol).c_str() ) >> 8 );
 
@@ -1271,7 +1369,7 @@ static float64_t to_softfloat64( double d ) {
    return *reinterpret_cast<float64_t*>(&d);
 }
 
-fc::variant get_global_row( const database& db, const abi_def& abi, const abi_serializer& abis, const fc::microseconds& abi_serializer_max_time_ms, bool shorten_abi_errors ) {
+fc::variant get_global_row( const database& db, const cached_abi& abi, const abi_serializer& abis, const fc::microseconds& abi_serializer_max_time_ms, bool shorten_abi_errors ) {
    const auto table_type = get_table_type(abi, N(global));
    EOS_ASSERT(table_type == read_only::KEYi64, contract_table_query_exception, "Invalid table type ${type} for table global", ("type",table_type));
 
@@ -1288,9 +1386,10 @@ fc::variant get_global_row( const database& db, const abi_def& abi, const abi_se
 }
 
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const {
-   const abi_def abi = eosio::chain_apis::get_abi(db, config::system_account_name);
+   const auto cached = get_cached_abi(db, config::system_account_name, abi_serializer_max_time);
+   const auto& abi = *cached;
    const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const abi_serializer& abis = cached->serializer;
    EOS_ASSERT(table_type == KEYi64, contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1323,7 +1422,7 @@ read_only::get_producers_result read_only::get_producers( const read_only::get_p
    }();
 
    for( ; it != secondary_index_by_secondary.end() && it->t_id == secondary_table_id->id; ++it ) {
-      if (result.rows.size() >= p.limit || fc::time_point::now() > stopTime) {
+      if (result.rows.size() >= p.limit || fc::time_point::now() > stopTime || (!result.rows.empty() && read_only_pool::past_deadline())) {
          result.more = name{it->primary_key}.to_string();
          break;
       }
@@ -1352,16 +1451,8 @@ read_only::get_producer_schedule_result read_only::get_producer_schedule( const
 template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, const fc::microseconds& max_serialization_time) {
-      return [api, max_serialization_time](const account_name &name) -> optional<abi_serializer> {
-         const auto* accnt = api->db.db().template find<account_object, by_name>(name);
-         if (accnt != nullptr) {
-            abi_def abi;
-            if (abi_serializer::to_abi(accnt->abi, abi)) {
-               return abi_serializer(abi, max_serialization_time);
-            }
-         }
-
-         return optional<abi_serializer>();
+      return [api, max_serialization_time](const account_name &name) -> std::shared_ptr<const abi_serializer> {
+         return abi_cache::instance().get_serializer(api->db.db(), name, max_serialization_time);
       };
    }
 };
@@ -1408,7 +1499,8 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
 
    uint32_t remaining = p.limit;
    auto time_limit = fc::time_point::now() + fc::microseconds(1000 * 10); /// 10ms max time
-   while (itr != idx_by_delay.end() && remaining > 0 && time_limit > fc::time_point::now()) {
+   while (itr != idx_by_delay.end() && remaining > 0 && time_limit > fc::time_point::now()
+          && (remaining == p.limit || !read_only_pool::past_deadline())) {
       auto row = fc::mutable_variant_object()
               ("trx_id", itr->trx_id)
               ("sender", itr->sender)
@@ -1690,11 +1782,9 @@ read_only::get_account_results read_only::get_account( const get_account_params&
       ++perm;
    }
 
-   const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
-
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   const auto system_abi = abi_cache::instance().get( db.db(), config::system_account_name, abi_serializer_max_time );
+   if( system_abi ) {
+      const abi_serializer& abis = system_abi->serializer;
 
       const auto token_code = N(eosio.token);
 
@@ -1778,9 +1868,10 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   const auto cached = abi_cache::instance().get( db.db(), params.code, abi_serializer_max_time );
+   if( cached ) {
+      const abi_def& abi = cached->abi;
+      const abi_serializer& abis = cached->serializer;
       auto action_type = abis.get_action_type(params.action);
       EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
@@ -1797,10 +1888,10 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
-   const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   db.db().get<account_object,by_name>( params.code ); // throws if there is no such account
+   const auto cached = abi_cache::instance().get( db.db(), params.code, abi_serializer_max_time );
+   if( cached ) {
+      const abi_serializer& abis = cached->serializer;
       result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
    } else {
       EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
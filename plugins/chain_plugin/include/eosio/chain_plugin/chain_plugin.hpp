@@ -15,6 +15,7 @@
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/chain/types.hpp>
+#include <eosio/chain_plugin/read_only_pool.hpp>
 
 #include <boost/container/flat_set.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -386,14 +387,12 @@ public:
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
    template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
+   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_serializer& abis, ConvFn conv )const {
       read_only::get_table_rows_result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -444,7 +443,7 @@ public:
                result.rows.emplace_back(fc::variant(data));
             }
 
-            if (++count == p.limit || fc::time_point::now() > end) {
+            if (++count == p.limit || fc::time_point::now() > end || read_only_pool::past_deadline()) {
                break;
             }
          }
@@ -456,14 +455,12 @@ public:
    }
 
    template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
+   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_serializer& abis )const {
       read_only::get_table_rows_result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if (t_id != nullptr) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -505,7 +502,7 @@ public:
                result.rows.emplace_back(fc::variant(data));
             }
 
-            if (++count == p.limit || fc::time_point::now() > end) {
+            if (++count == p.limit || fc::time_point::now() > end || read_only_pool::past_deadline()) {
                ++itr;
                break;
             }
@@ -664,6 +661,13 @@ public:
 
    fc::microseconds get_abi_serializer_max_time() const;
 
+   /**
+    *  Runs read on a read-only thread while the main thread leaves the chain state alone, or right away if
+    *  there are no read-only threads. read must not modify the chain state and must post its response back
+    *  to the main thread.
+    */
+   void execute_read_only( std::function<void()> read );
+
    void handle_guard_exception(const chain::guard_exception& e) const;
 
    static void handle_db_exhaustion();
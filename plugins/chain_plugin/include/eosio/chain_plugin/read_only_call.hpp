@@ -0,0 +1,29 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain_plugin/chain_plugin.hpp>
+
+#include <fc/io/json.hpp>
+
+/**
+ *  http_plugin api entry for a read only call that runs on a read-only thread of chain_plugin, see
+ *  read_only_pool. The response is sent from the main thread. The api plugin using it includes http_plugin.
+ */
+#define CALL_READ_ONLY(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_callback cb) mutable { \
+      app().get_plugin<chain_plugin>().execute_read_only([api_handle, body, cb]() mutable { \
+          int code = http_response_code; \
+          string response; \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto result = api_handle.call_name(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
+             response = fc::json::to_string(result); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, [&](int c, string r) { code = c; response = std::move(r); }); \
+          } \
+          app().get_io_service().post([cb, code, response]() { cb(code, response); }); \
+      }); \
+   }}
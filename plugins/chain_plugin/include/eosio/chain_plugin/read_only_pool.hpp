@@ -0,0 +1,80 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <boost/asio/io_service.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    *  Threads serving read only api calls while the main thread leaves the chain state alone.
+    *
+    *  chainbase is modified in place, so readers can't run next to block application. Instead the main thread
+    *  opens a read window when reads are queued: it stops in between two of its own handlers, lets the pool
+    *  run the queued reads for at most window_us and waits for the ones in flight before it goes back to
+    *  applying blocks and transactions. Every read sees the state at the last applied block or transaction.
+    *
+    *  A read can't be stopped from the outside, so a block waits one window plus the rest of the reads in
+    *  flight. Reads that walk rows check past_deadline() and return what they have, the tail is then about
+    *  one row and its abi serialization, which abi-serializer-max-time-ms bounds.
+    */
+   class read_only_pool {
+      public:
+         using read_function = std::function<void()>;
+
+         read_only_pool( boost::asio::io_service& main_ios ) : _main_ios( main_ios ) {}
+         ~read_only_pool() { stop(); }
+
+         void start( uint32_t threads, uint32_t window_us );
+         void stop();
+
+         bool is_running()const { return !_threads.empty(); }
+
+         /**
+          *  Called on the main thread, runs read on the pool during the next read window, or right away if
+          *  the pool isn't running.
+          */
+         void execute( read_function read );
+
+         /**
+          *  True on a read-only thread once the window its read runs in has closed, always false elsewhere.
+          */
+         static bool past_deadline();
+
+         struct stats {
+            uint64_t windows = 0;
+            uint64_t reads = 0;
+            uint64_t window_us = 0;  ///< total time the main thread spent in read windows
+         };
+         stats get_stats();
+
+      private:
+         void open_window();
+         void run();
+
+         boost::asio::io_service&    _main_ios;
+         std::vector<std::thread>    _threads;
+         std::chrono::microseconds   _window{0};
+         std::chrono::steady_clock::time_point _deadline;
+
+         std::mutex                  _mtx;
+         std::condition_variable     _work_cv;   ///< signals readers that reads can run
+         std::condition_variable     _done_cv;   ///< signals the main thread that a read has finished
+         std::deque<read_function>   _queue;
+         uint32_t                    _running = 0;
+         bool                        _window_open = false;
+         bool                        _window_scheduled = false;
+         bool                        _stopping = false;
+         stats                       _stats;
+   };
+
+}
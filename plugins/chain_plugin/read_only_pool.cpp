@@ -0,0 +1,117 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain_plugin/read_only_pool.hpp>
+
+namespace eosio {
+
+namespace {
+   // deadline of the window the read on this thread runs in
+   thread_local std::chrono::steady_clock::time_point read_deadline = std::chrono::steady_clock::time_point::max();
+}
+
+void read_only_pool::start( uint32_t threads, uint32_t window_us ) {
+   std::lock_guard<std::mutex> g( _mtx );
+   _window = std::chrono::microseconds( window_us );
+   _stopping = false;
+   for( uint32_t i = 0; i < threads; ++i ) {
+      _threads.emplace_back( [this]() { run(); } );
+   }
+}
+
+void read_only_pool::stop() {
+   {
+      std::lock_guard<std::mutex> g( _mtx );
+      _stopping = true;
+      _queue.clear();
+   }
+   _work_cv.notify_all();
+   _done_cv.notify_all();
+   for( auto& t : _threads ) {
+      t.join();
+   }
+   _threads.clear();
+}
+
+void read_only_pool::execute( read_function read ) {
+   if( !is_running() ) {
+      read();
+      return;
+   }
+
+   std::lock_guard<std::mutex> g( _mtx );
+   _queue.emplace_back( std::move( read ) );
+   if( !_window_scheduled ) {
+      _window_scheduled = true;
+      // behind whatever the main thread has queued already, a burst of reads doesn't jump ahead of a block
+      _main_ios.post( [this]() { open_window(); } );
+   }
+}
+
+void read_only_pool::open_window() {
+   const auto start = std::chrono::steady_clock::now();
+   const auto deadline = start + _window;
+
+   std::unique_lock<std::mutex> lk( _mtx );
+   _window_scheduled = false;
+   if( _stopping ) {
+      return;
+   }
+   _window_open = true;
+   _deadline = deadline;
+   _stats.windows++;
+   _work_cv.notify_all();
+
+   _done_cv.wait_until( lk, deadline, [this]() { return _stopping || (_queue.empty() && _running == 0); } );
+
+   // reads in flight still see the state they started on, the ones that walk rows stop at the deadline
+   _window_open = false;
+   _done_cv.wait( lk, [this]() { return _stopping || _running == 0; } );
+
+   _stats.window_us += std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - start ).count();
+
+   if( !_queue.empty() && !_stopping ) {
+      _window_scheduled = true;
+      _main_ios.post( [this]() { open_window(); } );
+   }
+}
+
+void read_only_pool::run() {
+   std::unique_lock<std::mutex> lk( _mtx );
+   while( true ) {
+      _work_cv.wait( lk, [this]() { return _stopping || (_window_open && !_queue.empty()); } );
+      if( _stopping ) {
+         return;
+      }
+
+      auto read = std::move( _queue.front() );
+      _queue.pop_front();
+      _running++;
+      _stats.reads++;
+      read_deadline = _deadline;
+      lk.unlock();
+
+      try {
+         read();
+      } catch( ... ) {
+         // a read reports its own errors to its caller
+      }
+
+      lk.lock();
+      read_deadline = std::chrono::steady_clock::time_point::max();
+      _running--;
+      _done_cv.notify_all();
+   }
+}
+
+bool read_only_pool::past_deadline() {
+   return std::chrono::steady_clock::now() > read_deadline;
+}
+
+read_only_pool::stats read_only_pool::get_stats() {
+   std::lock_guard<std::mutex> g( _mtx );
+   return _stats;
+}
+
+}
@@ -4,6 +4,7 @@
  */
 #include <eosio/history_api_plugin/history_api_plugin.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <eosio/chain_plugin/read_only_call.hpp>
 
 #include <fc/io/json.hpp>
 
@@ -31,7 +32,8 @@ void history_api_plugin::plugin_initialize(const variables_map&) {}
           } \
        }}
 
-#define CHAIN_RO_CALL(call_name) CALL(history, ro_api, history_apis::read_only, call_name)
+#define CHAIN_RO_CALL(call_name) CALL_READ_ONLY(history, ro_api, history_apis::read_only, call_name, 200)
+#define CHAIN_RO_CALL_MAIN(call_name) CALL(history, ro_api, history_apis::read_only, call_name)
 //#define CHAIN_RW_CALL(call_name) CALL(history, rw_api, history_apis::read_write, call_name)
 
 void history_api_plugin::plugin_startup() {
@@ -42,7 +44,7 @@ void history_api_plugin::plugin_startup() {
    app().get_plugin<http_plugin>().add_api({
 //      CHAIN_RO_CALL(get_transaction),
       CHAIN_RO_CALL(get_actions),
-      CHAIN_RO_CALL(get_transaction),
+      CHAIN_RO_CALL_MAIN(get_transaction), // reads blocks from the block log
       CHAIN_RO_CALL(get_key_accounts),
       CHAIN_RO_CALL(get_controlled_accounts)
    });
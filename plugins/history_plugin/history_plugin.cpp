@@ -10,6 +10,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <algorithm>
+#include <limits>
+
 namespace eosio {
    using namespace chain;
    using boost::signals2::scoped_connection;
@@ -37,10 +40,25 @@ namespace eosio {
       uint32_t             block_num;
       block_timestamp_type block_time;
       transaction_id_type  trx_id;
+      uint32_t             trx_index = no_trx_index; ///< position of the transaction receipt in the block
+
+      static constexpr uint32_t no_trx_index = std::numeric_limits<uint32_t>::max(); ///< implicit transactions have no receipt
    };
    using account_history_id_type = account_history_object::id_type;
    using action_history_id_type  = action_history_object::id_type;
 
+   /**
+    *  Kept next to the indices in the state file. chainbase finds an index by the name of its type only, so
+    *  a state directory written with another layout of action_history_object would be read as this one.
+    */
+   struct history_layout {
+      uint32_t version = 0;
+      uint32_t action_history_size = 0;
+   };
+
+   static constexpr uint32_t history_layout_version = 1; ///< 1: action_history_object has trx_index
+   static constexpr const char* history_layout_name = "eosio::history_layout";
+
 
    struct by_action_sequence_num;
    struct by_account_action_seq;
@@ -253,7 +271,7 @@ namespace eosio {
             }
          }
 
-         void on_action_trace( const action_trace& at ) {
+         void on_action_trace( const action_trace& at, uint32_t trx_index ) {
             if( filter( at ) ) {
                //idump((fc::json::to_pretty_string(at)));
                auto& chain = chain_plug->chain();
@@ -268,6 +286,7 @@ namespace eosio {
                   aho.block_num = chain.pending_block_state()->block_num;
                   aho.block_time = chain.pending_block_time();
                   aho.trx_id     = at.trx_id;
+                  aho.trx_index  = trx_index;
                });
 
                auto aset = account_set( at );
@@ -278,13 +297,34 @@ namespace eosio {
             if( at.receipt.receiver == chain::config::system_account_name )
                on_system_action( at );
             for( const auto& iline : at.inline_traces ) {
-               on_action_trace( iline );
+               on_action_trace( iline, trx_index );
+            }
+         }
+
+         /**
+          *  The receipt of an applied transaction is the last one pushed to the pending block, so its position is
+          *  known here and get_transaction doesn't have to search the block for it later.
+          */
+         uint32_t pending_trx_index( const transaction_trace_ptr& trace ) {
+            auto& chain = chain_plug->chain();
+            const auto& pbs = chain.pending_block_state();
+            if( !trace->receipt || !pbs || pbs->block->transactions.empty() )
+               return action_history_object::no_trx_index;
+
+            const auto& receipt = pbs->block->transactions.back();
+            if( receipt.trx.contains<transaction_id_type>() ) {
+               if( receipt.trx.get<transaction_id_type>() != trace->id )
+                  return action_history_object::no_trx_index;
+            } else if( pbs->trxs.empty() || pbs->trxs.back()->id != trace->id ) {
+               return action_history_object::no_trx_index;
             }
+            return pbs->block->transactions.size() - 1;
          }
 
          void on_applied_transaction( const transaction_trace_ptr& trace ) {
+            const auto trx_index = pending_trx_index( trace );
             for( const auto& atrace : trace->action_traces ) {
-               on_action_trace( atrace );
+               on_action_trace( atrace, trx_index );
             }
          }
    };
@@ -353,6 +393,23 @@ namespace eosio {
          db.add_index<account_control_history_multi_index>();
          db.add_index<public_key_history_multi_index>();
 
+         auto* segment = db.get_segment_manager();
+         auto* layout = segment->find<history_layout>( history_layout_name ).first;
+         if( !layout ) {
+            EOS_ASSERT( db.get_index<action_history_index>().indices().empty(), plugin_config_exception,
+                        "history in the state directory predates the layout check, replay with --replay-blockchain or --hard-replay-blockchain" );
+            layout = segment->construct<history_layout>( history_layout_name )( history_layout{ history_layout_version, sizeof(action_history_object) } );
+         }
+         EOS_ASSERT( layout->version == history_layout_version && layout->action_history_size == sizeof(action_history_object),
+                     plugin_config_exception,
+                     "history in the state directory has layout ${v} (${s} byte actions), this build expects ${ev} (${es} byte actions), "
+                     "replay with --replay-blockchain or --hard-replay-blockchain",
+                     ("v", layout->version)("s", layout->action_history_size)
+                     ("ev", history_layout_version)("es", sizeof(action_history_object)) );
+
+         // action data and console output of the traces are stored
+         chain.set_trace_verbosity( trace_verbosity::FULL );
+
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( const transaction_trace_ptr& p ) {
                   my->on_applied_transaction( p );
@@ -372,10 +429,10 @@ namespace eosio {
 
    namespace history_apis {
       read_only::get_actions_result read_only::get_actions( const read_only::get_actions_params& params )const {
-         edump((params));
         auto& chain = history->chain_plug->chain();
         const auto& db = chain.db();
         const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
+        const bool raw = params.raw && *params.raw;
 
         const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
 
@@ -384,7 +441,6 @@ namespace eosio {
         int32_t end = 0;
         int32_t offset = params.offset ? *params.offset : -20;
         auto n = params.account_name;
-        idump((pos));
         if( pos == -1 ) {
             auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
             if( itr == idx.begin() ) {
@@ -408,34 +464,54 @@ namespace eosio {
         }
         EOS_ASSERT( end >= start, plugin_exception, "end position is earlier than start position" );
 
-        idump((start)(end));
-
         auto start_itr = idx.lower_bound( boost::make_tuple( n, start ) );
         auto end_itr = idx.upper_bound( boost::make_tuple( n, end) );
 
         auto start_time = fc::time_point::now();
-        auto end_time = start_time;
 
         get_actions_result result;
         result.last_irreversible_block = chain.last_irreversible_block_num();
-        while( start_itr != end_itr ) {
-           const auto& a = db.get<action_history_object, by_action_sequence_num>( start_itr->action_sequence_num );
-           fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
-           action_trace t;
-           fc::raw::unpack( ds, t );
+
+        auto append = [&]( const account_history_object& aho ) {
+           const auto& a = db.get<action_history_object, by_action_sequence_num>( aho.action_sequence_num );
+           fc::variant trace;
+           if( raw ) {
+              trace = fc::variant( bytes( a.packed_action_trace.begin(), a.packed_action_trace.end() ) );
+           } else {
+              fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
+              action_trace t;
+              fc::raw::unpack( ds, t );
+              trace = chain.to_variant_with_abi(t, abi_serializer_max_time);
+           }
            result.actions.emplace_back( ordered_action_result{
-                                 start_itr->action_sequence_num,
-                                 start_itr->account_sequence_num,
+                                 aho.action_sequence_num,
+                                 aho.account_sequence_num,
                                  a.block_num, a.block_time,
-                                 chain.to_variant_with_abi(t, abi_serializer_max_time)
+                                 std::move(trace)
                                  });
 
-           end_time = fc::time_point::now();
-           if( end_time - start_time > fc::microseconds(100000) ) {
+           if( fc::time_point::now() - start_time > fc::microseconds(100000) || read_only_pool::past_deadline() ) {
               result.time_limit_exceeded_error = true;
-              break;
+              return false;
            }
-           ++start_itr;
+           return true;
+        };
+
+        // walk away from pos, so a page cut short by the time limit still ends where the next one has to start
+        if( offset > 0 ) {
+           for( auto itr = start_itr; itr != end_itr && append( *itr ); ++itr );
+
+           if( !result.actions.empty() ) {
+              int32_t next = result.actions.back().account_action_seq + 1;
+              if( idx.find( boost::make_tuple( n, next ) ) != idx.end() )
+                 result.cursor = next;
+           }
+        } else {
+           for( auto itr = end_itr; itr != start_itr && append( *(--itr) ); );
+           std::reverse( result.actions.begin(), result.actions.end() );
+
+           if( !result.actions.empty() && result.actions.front().account_action_seq > 0 )
+              result.cursor = result.actions.front().account_action_seq - 1;
         }
         return result;
       }
@@ -444,6 +520,7 @@ namespace eosio {
       read_only::get_transaction_result read_only::get_transaction( const read_only::get_transaction_params& p )const {
          auto& chain = history->chain_plug->chain();
          const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
+         const bool raw = p.raw && *p.raw;
 
          transaction_id_type input_id;
          auto input_id_length = p.id.size();
@@ -464,6 +541,20 @@ namespace eosio {
             return (*(input_id.data() + input_id_size) & 0xF0) == (*(id.data() + input_id_size) & 0xF0);
          };
 
+         auto receipt_id = []( const transaction_receipt& receipt ) -> transaction_id_type {
+            if( receipt.trx.contains<packed_transaction>() )
+               return receipt.trx.get<packed_transaction>().get_uncached_id();
+            return receipt.trx.get<transaction_id_type>();
+         };
+
+         auto receipt_to_variant = [&]( const transaction_receipt& receipt ) -> fc::variant {
+            fc::mutable_variant_object r("receipt", receipt);
+            if( !raw && receipt.trx.contains<packed_transaction>() ) {
+               r("trx", chain.to_variant_with_abi(receipt.trx.get<packed_transaction>().get_signed_transaction(), abi_serializer_max_time));
+            }
+            return fc::variant( std::move(r) );
+         };
+
          const auto& db = chain.db();
          const auto& idx = db.get_index<action_history_index, by_trx_id>();
          auto itr = idx.lower_bound( boost::make_tuple( input_id ) );
@@ -481,13 +572,17 @@ namespace eosio {
             result.last_irreversible_block = chain.last_irreversible_block_num();
             result.block_num  = itr->block_num;
             result.block_time = itr->block_time;
+            const uint32_t trx_index = itr->trx_index;
 
             while( itr != idx.end() && itr->trx_id == result.id ) {
-
-              fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
-              action_trace t;
-              fc::raw::unpack( ds, t );
-              result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
+              if( raw ) {
+                 result.traces.emplace_back( bytes( itr->packed_action_trace.begin(), itr->packed_action_trace.end() ) );
+              } else {
+                 fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
+                 action_trace t;
+                 fc::raw::unpack( ds, t );
+                 result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
+              }
 
               ++itr;
             }
@@ -500,21 +595,12 @@ namespace eosio {
                 }
             }
             if( blk != nullptr ) {
-                for (const auto &receipt: blk->transactions) {
-                    if (receipt.trx.contains<packed_transaction>()) {
-                        auto &pt = receipt.trx.get<packed_transaction>();
-                        auto mtrx = transaction_metadata(pt);
-                        if (mtrx.id == result.id) {
-                            fc::mutable_variant_object r("receipt", receipt);
-                            r("trx", chain.to_variant_with_abi(mtrx.trx, abi_serializer_max_time));
-                            result.trx = move(r);
-                            break;
-                        }
-                    } else {
-                        auto &id = receipt.trx.get<transaction_id_type>();
-                        if (id == result.id) {
-                            fc::mutable_variant_object r("receipt", receipt);
-                            result.trx = move(r);
+                if( trx_index < blk->transactions.size() && receipt_id( blk->transactions[trx_index] ) == result.id ) {
+                    result.trx = receipt_to_variant( blk->transactions[trx_index] );
+                } else { // recorded before the position of the receipt was kept
+                    for (const auto &receipt: blk->transactions) {
+                        if (receipt_id(receipt) == result.id) {
+                            result.trx = receipt_to_variant(receipt);
                             break;
                         }
                     }
@@ -525,32 +611,15 @@ namespace eosio {
             bool found = false;
             if (blk) {
                for (const auto& receipt: blk->transactions) {
-                  if (receipt.trx.contains<packed_transaction>()) {
-                     auto& pt = receipt.trx.get<packed_transaction>();
-                     auto mtrx = transaction_metadata(pt);
-                     if( txn_id_matched(mtrx.id) ) {
-                        result.id = mtrx.id;
-                        result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
-                        result.block_time = blk->timestamp;
-                        fc::mutable_variant_object r("receipt", receipt);
-                        r("trx", chain.to_variant_with_abi(mtrx.trx, abi_serializer_max_time));
-                        result.trx = move(r);
-                        found = true;
-                        break;
-                     }
-                  } else {
-                     auto& id = receipt.trx.get<transaction_id_type>();
-                     if( txn_id_matched(id) ) {
-                        result.id = id;
-                        result.last_irreversible_block = chain.last_irreversible_block_num();
-                        result.block_num = *p.block_num_hint;
-                        result.block_time = blk->timestamp;
-                        fc::mutable_variant_object r("receipt", receipt);
-                        result.trx = move(r);
-                        found = true;
-                        break;
-                     }
+                  auto id = receipt_id(receipt);
+                  if( txn_id_matched(id) ) {
+                     result.id = id;
+                     result.last_irreversible_block = chain.last_irreversible_block_num();
+                     result.block_num = *p.block_num_hint;
+                     result.block_time = blk->timestamp;
+                     result.trx = receipt_to_variant(receipt);
+                     found = true;
+                     break;
                   }
                }
             }
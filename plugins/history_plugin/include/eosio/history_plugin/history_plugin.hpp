@@ -34,6 +34,7 @@ class read_only {
          chain::account_name account_name;
          optional<int32_t>   pos; /// a absolute sequence positon -1 is the end/last action
          optional<int32_t>   offset; ///< the number of actions relative to pos, negative numbers return [pos-offset,pos), positive numbers return [pos,pos+offset)
+         optional<bool>      raw; ///< return each action_trace as the hex of its packed bytes instead of abi decoded json
       };
 
       struct ordered_action_result {
@@ -48,6 +49,7 @@ class read_only {
          vector<ordered_action_result> actions;
          uint32_t                      last_irreversible_block;
          optional<bool>                time_limit_exceeded_error;
+         optional<int32_t>             cursor; ///< pos of the next page with the same offset, unset when there is nothing left in that direction
       };
 
 
@@ -57,6 +59,7 @@ class read_only {
       struct get_transaction_params {
          string                        id;
          optional<uint32_t>            block_num_hint;
+         optional<bool>                raw; ///< return traces as the hex of the packed action_traces and trx as its receipt only
       };
 
       struct get_transaction_result {
@@ -138,11 +141,11 @@ class history_plugin : public plugin<history_plugin> {
 
 } /// namespace eosio
 
-FC_REFLECT( eosio::history_apis::read_only::get_actions_params, (account_name)(pos)(offset) )
-FC_REFLECT( eosio::history_apis::read_only::get_actions_result, (actions)(last_irreversible_block)(time_limit_exceeded_error) )
+FC_REFLECT( eosio::history_apis::read_only::get_actions_params, (account_name)(pos)(offset)(raw) )
+FC_REFLECT( eosio::history_apis::read_only::get_actions_result, (actions)(last_irreversible_block)(time_limit_exceeded_error)(cursor) )
 FC_REFLECT( eosio::history_apis::read_only::ordered_action_result, (global_action_seq)(account_action_seq)(block_num)(block_time)(action_trace) )
 
-FC_REFLECT( eosio::history_apis::read_only::get_transaction_params, (id)(block_num_hint) )
+FC_REFLECT( eosio::history_apis::read_only::get_transaction_params, (id)(block_num_hint)(raw) )
 FC_REFLECT( eosio::history_apis::read_only::get_transaction_result, (id)(trx)(block_time)(block_num)(last_irreversible_block)(traces) )
 /*
 FC_REFLECT(eosio::history_apis::read_only::get_transaction_params, (transaction_id) )
@@ -91,7 +91,7 @@ public:
    void process_irreversible_block(const chain::block_state_ptr&);
    void _process_irreversible_block(const chain::block_state_ptr&);
 
-   optional<abi_serializer> get_abi_serializer( account_name n );
+   std::shared_ptr<const abi_serializer> get_abi_serializer( account_name n );
    template<typename T> fc::variant to_variant_with_abi( const T& obj );
 
    void purge_abi_cache();
@@ -173,9 +173,9 @@ public:
    struct by_last_access;
 
    struct abi_cache {
-      account_name                     account;
-      fc::time_point                   last_accessed;
-      fc::optional<abi_serializer>     serializer;
+      account_name                           account;
+      fc::time_point                         last_accessed;
+      std::shared_ptr<const abi_serializer>  serializer; ///< handed out to the resolver, not copied
    };
 
    typedef boost::multi_index_container<abi_cache,
@@ -582,7 +582,7 @@ void mongo_db_plugin_impl::purge_abi_cache() {
    }
 }
 
-optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
+std::shared_ptr<const abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
    if( n.good()) {
@@ -606,7 +606,7 @@ optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name
                   abi = fc::json::from_string( bsoncxx::to_json( view["abi"].get_document())).as<abi_def>();
                } catch (...) {
                   ilog( "Unable to convert account abi to abi_def for ${n}", ( "n", n ));
-                  return optional<abi_serializer>();
+                  return std::shared_ptr<const abi_serializer>();
                }
 
                purge_abi_cache(); // make room if necessary
@@ -643,14 +643,14 @@ optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name
                   }
                }
                abis.set_abi( abi, abi_serializer_max_time );
-               entry.serializer.emplace( std::move( abis ) );
+               entry.serializer = std::make_shared<const abi_serializer>( std::move( abis ) );
                abi_cache_index.insert( entry );
                return entry.serializer;
             }
          }
       } FC_CAPTURE_AND_LOG((n))
    }
-   return optional<abi_serializer>();
+   return std::shared_ptr<const abi_serializer>();
 }
 
 template<typename T>
@@ -1607,6 +1607,8 @@ void mongo_db_plugin::plugin_initialize(const variables_map& options)
                chain.accepted_transaction.connect( [&]( const chain::transaction_metadata_ptr& t ) {
                   my->accepted_transaction( t );
                } ));
+         // action data and console output of the traces are stored
+         chain.set_trace_verbosity( chain::trace_verbosity::FULL );
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( const chain::transaction_trace_ptr& t ) {
                   my->applied_transaction( t );
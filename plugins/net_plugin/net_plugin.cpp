@@ -62,6 +62,7 @@ namespace eosio {
    using socket_ptr = std::shared_ptr<tcp::socket>;
 
    using net_message_ptr = shared_ptr<net_message>;
+   using send_buffer_ptr = std::shared_ptr<const vector<char>>; ///< a framed message, shared by every connection it is queued on
 
    struct node_transaction_state {
       transaction_id_type id;
@@ -69,7 +70,7 @@ namespace eosio {
                                 /// Expires increased while the txn is
                                 /// "in flight" to anoher peer
       packed_transaction packed_txn;
-      vector<char>    serialized_txn; /// the received raw bundle
+      send_buffer_ptr serialized_txn; /// the received raw bundle
       uint32_t        block_num = 0; /// block transaction was included in
       uint32_t        true_block = 0; /// used to reset block_uum when request is 0
       uint16_t        requests = 0; /// the number of "in flight" requests for this txn
@@ -185,6 +186,8 @@ namespace eosio {
 
       template<typename VerifierFunc>
       void send_all( const net_message &msg, VerifierFunc verify );
+      template<typename VerifierFunc>
+      void send_all( const send_buffer_ptr& send_buffer, VerifierFunc verify );
 
       void accepted_block_header(const block_state_ptr&);
       void accepted_block(const block_state_ptr&);
@@ -471,7 +474,7 @@ namespace eosio {
       vector<char>            blk_buffer;
 
       struct queued_write {
-         std::shared_ptr<vector<char>> buff;
+         send_buffer_ptr buff;
          std::function<void(boost::system::error_code, std::size_t)> callback;
       };
       deque<queued_write>     write_queue;
@@ -559,6 +562,8 @@ namespace eosio {
       void stop_send();
 
       void enqueue( const net_message &msg, bool trigger_send = true );
+      void enqueue_block( const signed_block_ptr& sb, bool trigger_send = true );
+      void enqueue_buffer( const send_buffer_ptr& send_buffer, bool trigger_send, go_away_reason close_after_send );
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -570,7 +575,7 @@ namespace eosio {
       void sync_timeout(boost::system::error_code ec);
       void fetch_timeout(boost::system::error_code ec);
 
-      void queue_write(std::shared_ptr<vector<char>> buff,
+      void queue_write(const send_buffer_ptr& buff,
                        bool trigger_send,
                        std::function<void(boost::system::error_code, std::size_t)> callback);
       void do_queue_write();
@@ -784,7 +789,7 @@ namespace eosio {
 
    void connection::txn_send_pending(const vector<transaction_id_type> &ids) {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
-         if(tx->serialized_txn.size() && tx->block_num == 0) {
+         if(tx->serialized_txn && tx->block_num == 0) {
             bool found = false;
             for(auto known : ids) {
                if( known == tx->id) {
@@ -794,7 +799,7 @@ namespace eosio {
             }
             if(!found) {
                my_impl->local_txns.modify(tx,incr_in_flight);
-               queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+               queue_write(tx->serialized_txn,
                            true,
                            [tx_id=tx->id](boost::system::error_code ec, std::size_t ) {
                               auto& local_txns = my_impl->local_txns;
@@ -813,9 +818,9 @@ namespace eosio {
    void connection::txn_send(const vector<transaction_id_type> &ids) {
       for(auto t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
-         if( tx != my_impl->local_txns.end() && tx->serialized_txn.size()) {
+         if( tx != my_impl->local_txns.end() && tx->serialized_txn) {
             my_impl->local_txns.modify( tx,incr_in_flight);
-            queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+            queue_write(tx->serialized_txn,
                         true,
                         [t](boost::system::error_code ec, std::size_t ) {
                            auto& local_txns = my_impl->local_txns;
@@ -899,7 +904,7 @@ namespace eosio {
          if (bstack.back()->previous == lib_id || bstack.back()->previous == remote_head_id) {
             count = bstack.size();
             while (bstack.size()) {
-               enqueue(*bstack.back());
+               enqueue_block(bstack.back());
                bstack.pop_back();
             }
          }
@@ -920,7 +925,7 @@ namespace eosio {
             signed_block_ptr b = cc.fetch_block_by_id(blkid);
             if(b) {
                fc_dlog(logger,"found block for id at num ${n}",("n",b->block_num()));
-               enqueue(net_message(*b));
+               enqueue_block(b);
             }
             else {
                ilog("fetch block by id returned null, id ${id} on block ${c} of ${s} for ${p}",
@@ -980,7 +985,7 @@ namespace eosio {
       enqueue(xpkt);
    }
 
-   void connection::queue_write(std::shared_ptr<vector<char>> buff,
+   void connection::queue_write(const send_buffer_ptr& buff,
                                 bool trigger_send,
                                 std::function<void(boost::system::error_code, std::size_t)> callback) {
       write_queue.push_back({buff, callback});
@@ -1079,7 +1084,7 @@ namespace eosio {
       try {
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
-            enqueue( *sb, trigger_send);
+            enqueue_block( sb, trigger_send);
             return true;
          }
       } catch ( ... ) {
@@ -1088,12 +1093,27 @@ namespace eosio {
       return false;
    }
 
-   void connection::enqueue( const net_message &m, bool trigger_send ) {
-      go_away_reason close_after_send = no_reason;
-      if (m.contains<go_away_message>()) {
-         close_after_send = m.get<go_away_message>().reason;
-      }
+   /**
+    *  Packs v the way net_message packs its alternative with index which, framed by the payload size. Packing a
+    *  member type directly spares the copy of a block or transaction into a net_message.
+    */
+   template<typename T>
+   static send_buffer_ptr create_send_buffer( uint32_t which, const T& v ) {
+      uint32_t payload_size = fc::raw::pack_size( unsigned_int( which ) ) + fc::raw::pack_size( v );
+      char * header = reinterpret_cast<char*>(&payload_size);
+      size_t header_size = sizeof(payload_size);
 
+      size_t buffer_size = header_size + payload_size;
+
+      auto send_buffer = std::make_shared<vector<char>>(buffer_size);
+      fc::datastream<char*> ds( send_buffer->data(), buffer_size);
+      ds.write( header, header_size );
+      fc::raw::pack( ds, unsigned_int( which ) );
+      fc::raw::pack( ds, v );
+      return send_buffer;
+   }
+
+   static send_buffer_ptr create_send_buffer( const net_message& m ) {
       uint32_t payload_size = fc::raw::pack_size( m );
       char * header = reinterpret_cast<char*>(&payload_size);
       size_t header_size = sizeof(payload_size);
@@ -1104,6 +1124,22 @@ namespace eosio {
       fc::datastream<char*> ds( send_buffer->data(), buffer_size);
       ds.write( header, header_size );
       fc::raw::pack( ds, m );
+      return send_buffer;
+   }
+
+   static go_away_reason go_away_reason_of( const net_message& m ) {
+      return m.contains<go_away_message>() ? m.get<go_away_message>().reason : no_reason;
+   }
+
+   void connection::enqueue( const net_message &m, bool trigger_send ) {
+      enqueue_buffer( create_send_buffer( m ), trigger_send, go_away_reason_of( m ) );
+   }
+
+   void connection::enqueue_block( const signed_block_ptr& sb, bool trigger_send ) {
+      enqueue_buffer( create_send_buffer( net_message::tag<signed_block>::value, *sb ), trigger_send, no_reason );
+   }
+
+   void connection::enqueue_buffer( const send_buffer_ptr& send_buffer, bool trigger_send, go_away_reason close_after_send ) {
       connection_wptr weak_this = shared_from_this();
       queue_write(send_buffer,trigger_send,
                   [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
@@ -1616,8 +1652,8 @@ namespace eosio {
       }
       received_blocks.erase(range.first, range.second);
 
-      net_message msg(bsum);
-      uint32_t packsiz = fc::raw::pack_size(msg);
+      const uint32_t which = net_message::tag<signed_block>::value;
+      uint32_t packsiz = fc::raw::pack_size(unsigned_int(which)) + fc::raw::pack_size(bsum);
       uint32_t msgsiz = packsiz + sizeof(packsiz);
       notice_message pending_notify;
       block_id_type bid = bsum.id();
@@ -1643,12 +1679,15 @@ namespace eosio {
       }
       else {
          pbstate.is_known = true;
+         send_buffer_ptr send_buffer;
          for (auto cp : my_impl->connections) {
             if (skips.find(cp) != skips.end() || !cp->current()) {
                continue;
             }
             cp->add_peer_block(pbstate);
-            cp->enqueue( bsum );
+            if (!send_buffer)
+               send_buffer = create_send_buffer(which, bsum);
+            cp->enqueue_buffer(send_buffer, true, no_reason);
          }
       }
    }
@@ -1695,27 +1734,19 @@ namespace eosio {
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
       }
-      uint32_t packsiz = 0;
-      uint32_t bufsiz = 0;
-
       time_point_sec trx_expiration = trx.expiration();
 
-      net_message msg(trx);
-      packsiz = fc::raw::pack_size(msg);
-      bufsiz = packsiz + sizeof(packsiz);
-      vector<char> buff(bufsiz);
-      fc::datastream<char*> ds( buff.data(), bufsiz);
-      ds.write( reinterpret_cast<char*>(&packsiz), sizeof(packsiz) );
-      fc::raw::pack( ds, msg );
+      auto send_buffer = create_send_buffer( net_message::tag<packed_transaction>::value, trx );
+      uint32_t bufsiz = send_buffer->size();
       node_transaction_state nts = {id,
                                     trx_expiration,
                                     trx,
-                                    std::move(buff),
+                                    send_buffer,
                                     0, 0, 0};
       my_impl->local_txns.insert(std::move(nts));
 
       if( !large_msg_notify || bufsiz <= just_send_it_max) {
-         my_impl->send_all( trx, [id, &skips, trx_expiration](connection_ptr c) -> bool {
+         my_impl->send_all( send_buffer, [id, &skips, trx_expiration](connection_ptr c) -> bool {
                if( skips.find(c) != skips.end() || c->syncing ) {
                   return false;
                }
@@ -2180,9 +2211,23 @@ namespace eosio {
 
    template<typename VerifierFunc>
    void net_plugin_impl::send_all( const net_message &msg, VerifierFunc verify) {
+      // packed for the first connection that takes it and shared with the rest
+      send_buffer_ptr send_buffer;
+      const go_away_reason close_after = go_away_reason_of( msg );
+      for( auto &c : connections) {
+         if( c->current() && verify( c)) {
+            if( !send_buffer )
+               send_buffer = create_send_buffer( msg );
+            c->enqueue_buffer( send_buffer, true, close_after );
+         }
+      }
+   }
+
+   template<typename VerifierFunc>
+   void net_plugin_impl::send_all( const send_buffer_ptr& send_buffer, VerifierFunc verify) {
       for( auto &c : connections) {
          if( c->current() && verify( c)) {
-            c->enqueue( msg );
+            c->enqueue_buffer( send_buffer, true, no_reason );
          }
       }
    }
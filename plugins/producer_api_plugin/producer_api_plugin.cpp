@@ -90,6 +90,10 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_R_V(producer, get_integrity_hash), 201),
        CALL(producer, producer, create_snapshot,
             INVOKE_R_V(producer, create_snapshot), 201),
+       CALL(producer, producer, get_conflict_stats,
+            INVOKE_R_V(producer, get_conflict_stats), 201),
+       CALL(producer, producer, reset_conflict_stats,
+            INVOKE_V_V(producer, reset_conflict_stats), 201),
    });
 }
 
@@ -50,6 +50,20 @@ public:
       std::string          snapshot_name;
    };
 
+   struct contract_conflicts {
+      account_name contract;
+      uint64_t     conflicts = 0; ///< transactions that shared a table of the contract another one wrote
+   };
+
+   /**
+    * Collected while pending transactions are packed, only with producer-parallel-lanes > 0
+    */
+   struct conflict_stats {
+      uint32_t                        parallel_lanes = 0;
+      uint64_t                        packed_runs = 0;
+      std::vector<contract_conflicts> contracts; ///< most conflicts first
+   };
+
    producer_plugin();
 
    virtual int produce_block(){return 0;};
@@ -86,6 +100,9 @@ public:
    integrity_hash_information get_integrity_hash() const;
    snapshot_information create_snapshot() const;
 
+   conflict_stats get_conflict_stats() const;
+   void reset_conflict_stats();
+
    signal<void(const chain::producer_confirmation&)> confirmed_block;
 private:
    std::shared_ptr<class producer_plugin_impl> my;
@@ -98,4 +115,6 @@ FC_REFLECT(eosio::producer_plugin::greylist_params, (accounts));
 FC_REFLECT(eosio::producer_plugin::whitelist_blacklist, (actor_whitelist)(actor_blacklist)(contract_whitelist)(contract_blacklist)(action_blacklist)(key_blacklist) )
 FC_REFLECT(eosio::producer_plugin::integrity_hash_information, (head_block_id)(integrity_hash))
 FC_REFLECT(eosio::producer_plugin::snapshot_information, (head_block_id)(snapshot_name))
+FC_REFLECT(eosio::producer_plugin::contract_conflicts, (contract)(conflicts))
+FC_REFLECT(eosio::producer_plugin::conflict_stats, (parallel_lanes)(packed_runs)(contracts))
 
@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <thread>
 #include <boost/algorithm/string.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/function_output_iterator.hpp>
@@ -75,6 +76,123 @@ namespace {
              (code == block_net_usage_exceeded::code_value) ||
              (code == deadline_exception::code_value && deadline_is_subjective);
    }
+
+   struct pack_result {
+      size_t groups = 0;
+      size_t largest_group = 0;
+   };
+
+   /**
+    * Reorders a run of transactions that may be moved past each other: transactions that conflict go to the same
+    * lane in their original order, the groups are balanced over the lanes by execution time and the lanes are
+    * interleaved, so that a validator running the block on `lanes` cores rarely waits on an earlier transaction.
+    * Every transaction but the first one using a table somebody writes is counted in conflicts, under the contract
+    * that owns the table
+    */
+   pack_result pack_segment(vector<transaction_metadata_ptr>::iterator first, vector<transaction_metadata_ptr>::iterator last, uint32_t lanes,
+                            std::map<account_name, uint64_t>& conflicts) {
+      pack_result result;
+      const size_t n = last - first;
+      if (n < 2) {
+         result.groups = n;
+         result.largest_group = n;
+         return result;
+      }
+
+      vector<size_t> parent(n);
+      for (size_t i = 0; i < n; i++) parent[i] = i;
+      auto root = [&](size_t i) {
+         while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+         }
+         return i;
+      };
+      auto join = [&](size_t a, size_t b) {
+         a = root(a);
+         b = root(b);
+         if (a != b) parent[std::max(a, b)] = std::min(a, b);
+      };
+
+      // a table only links its users together when somebody writes it
+      std::map<table_access_key, std::pair<vector<size_t>, bool>> users;
+      for (size_t i = 0; i < n; i++) {
+         const auto& fp = *first[i]->footprint;
+         for (const auto& key : fp.reads) users[key].first.push_back(i);
+         for (const auto& key : fp.writes) {
+            auto& u = users[key];
+            u.first.push_back(i);
+            u.second = true;
+         }
+      }
+      for (const auto& u : users) {
+         if (!u.second.second) continue;
+         const auto& members = u.second.first;
+         for (size_t j = 0; j < members.size(); j++) {
+            join(members.front(), members[j]);
+            // a transaction that reads and writes the table is listed twice, next to itself
+            if (j > 0 && members[j] != members[j - 1]) conflicts[u.first.code]++;
+         }
+      }
+
+      // groups in order of their first transaction, members in block order
+      std::map<size_t, vector<size_t>> groups;
+      std::map<size_t, int64_t> cost;
+      for (size_t i = 0; i < n; i++) {
+         size_t r = root(i);
+         groups[r].push_back(i);
+         cost[r] += std::max<int64_t>(first[i]->elapsed.count(), 1);
+      }
+
+      vector<size_t> order;
+      for (const auto& g : groups) {
+         order.push_back(g.first);
+         result.largest_group = std::max(result.largest_group, g.second.size());
+      }
+      result.groups = order.size();
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return cost[a] > cost[b]; });
+
+      vector<vector<size_t>> lane_trxs(std::max<uint32_t>(lanes, 1));
+      vector<int64_t> lane_cost(lane_trxs.size(), 0);
+      for (size_t g : order) {
+         size_t lane = std::min_element(lane_cost.begin(), lane_cost.end()) - lane_cost.begin();
+         lane_cost[lane] += cost[g];
+         auto& l = lane_trxs[lane];
+         l.insert(l.end(), groups[g].begin(), groups[g].end());
+      }
+
+      vector<transaction_metadata_ptr> packed;
+      packed.reserve(n);
+      for (auto& l : lane_trxs) std::sort(l.begin(), l.end());
+      for (size_t pos = 0; packed.size() < n; pos++) {
+         for (const auto& l : lane_trxs) {
+            if (pos < l.size()) packed.push_back(first[l[pos]]);
+         }
+      }
+      std::move(packed.begin(), packed.end(), first);
+      return result;
+   }
+
+   /**
+    * Packs transactions that already ran once, transactions that ran a native handler or were never applied keep
+    * their position and split the list in runs that are packed on their own
+    */
+   pack_result pack_transactions(vector<transaction_metadata_ptr>& trxs, uint32_t lanes, std::map<account_name, uint64_t>& conflicts) {
+      pack_result result;
+      auto begin = trxs.begin();
+      for (auto itr = trxs.begin(); ; ++itr) {
+         if (itr == trxs.end() || !(*itr)->footprint || (*itr)->footprint->exclusive) {
+            auto r = pack_segment(begin, itr, lanes, conflicts);
+            result.groups += r.groups;
+            result.largest_group = std::max(result.largest_group, r.largest_group);
+            if (itr == trxs.end()) break;
+            result.groups++;
+            result.largest_group = std::max<size_t>(result.largest_group, 1);
+            begin = itr + 1;
+         }
+      }
+      return result;
+   }
 }
 
 struct transaction_id_with_expiry {
@@ -145,6 +263,10 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       transaction_id_with_expiry_index                          _persistent_transactions;
 
       int32_t                                                   _max_transaction_time_ms;
+      uint32_t                                                  _parallel_lanes = 0;
+      std::map<account_name, uint64_t>                          _contract_conflicts;
+      uint64_t                                                  _packed_runs = 0;
+      uint32_t                                                  _signature_recovery_threads = 0;
       fc::microseconds                                          _max_irreversible_block_age_us;
       int32_t                                                   _produce_time_offset_us = 0;
       int32_t                                                   _last_block_time_offset_us = 0;
@@ -189,6 +311,74 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // incoming transactions whose keys are recovered off the main thread, pushed to the chain in arrival order
+      struct recovering_transaction {
+         packed_transaction_ptr                trx;
+         bool                                  persist_until_expired = false;
+         next_function<transaction_trace_ptr>  next;
+         transaction_metadata_ptr              mtrx; ///< null if the transaction could not be unpacked or recovered
+         bool                                  ready = false;
+      };
+
+      boost::asio::io_service                                  _recovery_ios;
+      fc::optional<boost::asio::io_service::work>              _recovery_work;
+      std::vector<std::thread>                                 _recovery_threads;
+      std::deque<std::shared_ptr<recovering_transaction>>      _recovering_transactions;
+
+      void start_signature_recovery( uint32_t threads ) {
+         _recovery_work.emplace( _recovery_ios );
+         for( uint32_t i = 0; i < threads; ++i ) {
+            _recovery_threads.emplace_back( [this]() { _recovery_ios.run(); } );
+         }
+      }
+
+      void stop_signature_recovery() {
+         _recovery_work.reset();
+         _recovery_ios.stop();
+         for( auto& t : _recovery_threads ) {
+            t.join();
+         }
+         _recovery_threads.clear();
+      }
+
+      void on_incoming_transaction(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         if( _recovery_threads.empty() ) {
+            on_incoming_transaction_async(trx, persist_until_expired, next);
+            return;
+         }
+
+         auto entry = std::make_shared<recovering_transaction>();
+         entry->trx = trx;
+         entry->persist_until_expired = persist_until_expired;
+         entry->next = next;
+         _recovering_transactions.push_back(entry);
+
+         auto chain_id = app().get_plugin<chain_plugin>().chain().get_chain_id();
+         _recovery_ios.post( [this, entry, chain_id]() {
+            try {
+               auto mtrx = std::make_shared<transaction_metadata>(*entry->trx);
+               mtrx->recover_keys(chain_id);
+               entry->mtrx = mtrx;
+            } catch( ... ) {
+               // pushed without metadata, the chain reports the error to next
+            }
+            app().get_io_service().post( [this, entry]() {
+               entry->ready = true;
+               push_recovered_transactions();
+            });
+         });
+      }
+
+      void push_recovered_transactions() {
+         while( !_recovering_transactions.empty() && _recovering_transactions.front()->ready ) {
+            auto entry = _recovering_transactions.front();
+            _recovering_transactions.pop_front();
+            try {
+               on_incoming_transaction_async(entry->trx, entry->persist_until_expired, entry->next, entry->mtrx);
+            } FC_LOG_AND_DROP();
+         }
+      }
+
 
       void on_block( const block_state_ptr& bsp ) {
          if( bsp->header.timestamp <= _last_signed_block_time ) return;
@@ -351,12 +541,14 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
       }
 
-      std::deque<std::tuple<packed_transaction_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+      //the metadata is kept along, a transaction that is retried doesn't recover its signing keys again
+      std::deque<std::tuple<packed_transaction_ptr, bool, next_function<transaction_trace_ptr>, transaction_metadata_ptr>> _pending_incoming_transactions;
 
-      void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+      void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next,
+                                         const transaction_metadata_ptr& mtrx = transaction_metadata_ptr()) {
          chain::controller& chain = app().get_plugin<chain_plugin>().chain();
          if (!chain.pending_block_state()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next, mtrx);
             return;
          }
 
@@ -410,10 +602,11 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
 
          try {
-            auto trace = chain.push_transaction(std::make_shared<transaction_metadata>(*trx), deadline);
+            auto meta = mtrx ? mtrx : std::make_shared<transaction_metadata>(*trx);
+            auto trace = chain.push_transaction(meta, deadline);
             if (trace->except) {
                if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next, meta);
                   if (_pending_block_mode == pending_block_mode::producing) {
                      fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} COULD NOT FIT, tx: ${txid} RETRYING ",
                              ("block_num", chain.head_block_num() + 1)
@@ -517,6 +710,10 @@ void producer_plugin::set_program_options(
          ("pause-on-startup,x", boost::program_options::bool_switch()->notifier([this](bool p){my->_pause_production = p;}), "Start this node in a state where production is paused")
          ("max-transaction-time", bpo::value<int32_t>()->default_value(30),
           "Limits the maximum time (in milliseconds) that is allowed a pushed transaction's code to execute before being considered invalid")
+         ("producer-parallel-lanes", bpo::value<uint32_t>()->default_value(0),
+          "Number of cores produced blocks are packed for: transactions that don't touch the same tables are spread over them, conflicting ones stay in arrival order. Defaults to 0, packing is off and pending transactions are applied in arrival order. Per contract conflict counts are available from /v1/producer/get_conflict_stats once it is on")
+         ("signature-recovery-threads", bpo::value<uint32_t>()->default_value(2),
+          "Number of threads that unpack incoming transactions and recover their signing keys before they are pushed to the chain, in arrival order. 0 to recover them on the main thread")
          ("max-irreversible-block-age", bpo::value<int32_t>()->default_value( -1 ),
           "Limits the maximum age (in seconds) of the DPOS Irreversible Block for a chain this node will produce blocks on (use negative value to indicate unlimited)")
          ("producer-name,p", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -672,6 +869,10 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_max_transaction_time_ms = options.at("max-transaction-time").as<int32_t>();
 
+   my->_parallel_lanes = options.at("producer-parallel-lanes").as<uint32_t>();
+
+   my->_signature_recovery_threads = options.at("signature-recovery-threads").as<uint32_t>();
+
    my->_max_irreversible_block_age_us = fc::seconds(options.at("max-irreversible-block-age").as<int32_t>());
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
@@ -699,7 +900,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_transaction_subscription = app().get_channel<incoming::channels::transaction>().subscribe([this](const packed_transaction_ptr& trx){
       try {
-         my->on_incoming_transaction_async(trx, false, [](const auto&){});
+         my->on_incoming_transaction(trx, false, [](const auto&){});
       } FC_LOG_AND_DROP();
    });
 
@@ -708,7 +909,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    });
 
    my->_incoming_transaction_async_provider = app().get_method<incoming::methods::transaction_async>().register_provider([this](const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) -> void {
-      return my->on_incoming_transaction_async(trx, persist_until_expired, next );
+      return my->on_incoming_transaction(trx, persist_until_expired, next );
    });
 
    if (options.count("greylist-account")) {
@@ -746,6 +947,10 @@ void producer_plugin::plugin_startup()
    my->_accepted_block_connection.emplace(chain.accepted_block.connect( [this]( const auto& bsp ){ my->on_block( bsp ); } ));
    my->_irreversible_block_connection.emplace(chain.irreversible_block.connect( [this]( const auto& bsp ){ my->on_irreversible_block( bsp->block ); } ));
 
+   if( my->_parallel_lanes > 0 ) {
+      chain.set_record_footprints( true );
+   }
+
    const auto lib_num = chain.last_irreversible_block_num();
    const auto lib = chain.fetch_block_by_number(lib_num);
    if (lib) {
@@ -765,6 +970,10 @@ void producer_plugin::plugin_startup()
       }
    }
 
+   if (my->_signature_recovery_threads > 0) {
+      my->start_signature_recovery(my->_signature_recovery_threads);
+   }
+
    if (!my->_manual_gen_block) {
       my->schedule_production_loop();
    }
@@ -778,6 +987,8 @@ void producer_plugin::plugin_shutdown() {
       edump((e.to_detail_string()));
    }
 
+   my->stop_signature_recovery();
+
    my->_accepted_block_connection.reset();
    my->_irreversible_block_connection.reset();
 }
@@ -942,6 +1153,25 @@ producer_plugin::snapshot_information producer_plugin::create_snapshot() const {
    return {head_id, snapshot_path};
 }
 
+producer_plugin::conflict_stats producer_plugin::get_conflict_stats() const {
+   conflict_stats result;
+   result.parallel_lanes = my->_parallel_lanes;
+   result.packed_runs = my->_packed_runs;
+   result.contracts.reserve(my->_contract_conflicts.size());
+   for (const auto& c : my->_contract_conflicts) {
+      result.contracts.push_back(contract_conflicts{c.first, c.second});
+   }
+   std::stable_sort(result.contracts.begin(), result.contracts.end(), [](const auto& a, const auto& b) {
+      return a.conflicts > b.conflicts;
+   });
+   return result;
+}
+
+void producer_plugin::reset_conflict_stats() {
+   my->_contract_conflicts.clear();
+   my->_packed_runs = 0;
+}
+
 optional<fc::time_point> producer_plugin_impl::calculate_next_block_time(const account_name& producer_name, const block_timestamp_type& current_block_time) const {
    chain::controller& chain = app().get_plugin<chain_plugin>().chain();
    const auto& hbs = chain.head_block_state();
@@ -1177,6 +1407,13 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                }
             }
 
+            if (_parallel_lanes > 0 && _pending_block_mode == pending_block_mode::producing && apply_trxs.size() > 1) {
+               auto packed = pack_transactions(apply_trxs, _parallel_lanes, _contract_conflicts);
+               _packed_runs++;
+               fc_dlog(_log, "Packed ${n} transactions in ${g} conflict groups over ${l} lanes, largest group ${m}",
+                      ("n", apply_trxs.size())("g", packed.groups)("l", _parallel_lanes)("m", packed.largest_group));
+            }
+
             if (!apply_trxs.empty()) {
                int num_applied = 0;
                int num_failed = 0;
@@ -1262,7 +1499,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                      _pending_incoming_transactions.pop_front();
                      --orig_pending_txn_size;
                      _incoming_trx_weight -= 1.0;
-                     on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                     on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e), std::get<3>(e));
                   }
 
                   if (block_time <= fc::time_point::now()) {
@@ -1325,7 +1562,7 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                   auto e = _pending_incoming_transactions.front();
                   _pending_incoming_transactions.pop_front();
                   --orig_pending_txn_size;
-                  on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                  on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e), std::get<3>(e));
                   if (block_time <= fc::time_point::now()) return start_block_result::exhausted;
                }
             }
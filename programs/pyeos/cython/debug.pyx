@@ -49,6 +49,9 @@ cdef extern from "../interface/debug_.hpp":
 
     void add_trusted_account_(uint64_t account);
     void remove_trusted_account_(uint64_t account);
+    void get_preload_stats_(vector[uint64_t]& accounts, vector[uint64_t]& applies, vector[uint64_t]& loads, vector[uint64_t]& last_load_us, vector[uint64_t]& max_load_us);
+    void get_parallel_stats_(uint64_t& blocks, uint64_t& transactions, uint64_t& conflicts, uint64_t& serial_us, vector[uint32_t]& cores, vector[uint64_t]& makespan_us);
+    void reset_parallel_stats_();
 
     int vm_run_script_(const char* str);
 
@@ -153,6 +156,35 @@ def remove_trusted_account(account):
         account = eosapi.s2n(account)
     remove_trusted_account_(account);
 
+def get_preload_stats():
+    '''
+    returns a list of (account, recent applies, loads, last load us, max load us) of preloaded accounts
+    '''
+    cdef vector[uint64_t] accounts
+    cdef vector[uint64_t] applies
+    cdef vector[uint64_t] loads
+    cdef vector[uint64_t] last_load_us
+    cdef vector[uint64_t] max_load_us
+    get_preload_stats_(accounts, applies, loads, last_load_us, max_load_us)
+    return [(eosapi.n2s(accounts[i]), applies[i], loads[i], last_load_us[i], max_load_us[i]) for i in range(accounts.size())]
+
+def get_parallel_stats():
+    '''
+    returns (blocks, transactions, conflicts, serial us, {cores: us}) of the blocks committed since the last reset,
+    the time the transactions would have taken on a number of cores given the tables they read and wrote
+    '''
+    cdef uint64_t blocks = 0
+    cdef uint64_t transactions = 0
+    cdef uint64_t conflicts = 0
+    cdef uint64_t serial_us = 0
+    cdef vector[uint32_t] cores
+    cdef vector[uint64_t] makespan_us
+    get_parallel_stats_(blocks, transactions, conflicts, serial_us, cores, makespan_us)
+    return (blocks, transactions, conflicts, serial_us, {cores[i]: makespan_us[i] for i in range(cores.size())})
+
+def reset_parallel_stats():
+    reset_parallel_stats_()
+
 def vm_run_script(_str):
     return vm_run_script_(_str)
 
@@ -313,6 +313,39 @@ void remove_trusted_account_(uint64_t account) {
    vm_manager::get().remove_trusted_account(account);
 }
 
+void get_preload_stats_(vector<uint64_t>& accounts, vector<uint64_t>& applies, vector<uint64_t>& loads, vector<uint64_t>& last_load_us, vector<uint64_t>& max_load_us) {
+   for (auto& s : vm_manager::get().get_preload_stats()) {
+      accounts.push_back(s.account);
+      applies.push_back(s.applies);
+      loads.push_back(s.loads);
+      last_load_us.push_back(s.last_load_us);
+      max_load_us.push_back(s.max_load_us);
+   }
+}
+
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/parallel_schedule.hpp>
+
+namespace eosio {
+namespace chain {
+   controller& get_chain_controller();
+}
+}
+
+void get_parallel_stats_(uint64_t& blocks, uint64_t& transactions, uint64_t& conflicts, uint64_t& serial_us, vector<uint32_t>& cores, vector<uint64_t>& makespan_us) {
+   const auto& s = eosio::chain::get_chain_controller().get_parallel_stats();
+   blocks = s.blocks;
+   transactions = s.transactions;
+   conflicts = s.conflicts;
+   serial_us = s.serial_us;
+   cores = s.cores;
+   makespan_us = s.makespan_us;
+}
+
+void reset_parallel_stats_() {
+   eosio::chain::get_chain_controller().reset_parallel_stats();
+}
+
 namespace eosio {
 namespace chain {
    int vm_run_script(const char* str);
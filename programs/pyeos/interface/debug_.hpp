@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <vector>
 //#include <micropython/mpeoslib.h>
 #include <Python.h>
 
@@ -56,6 +57,9 @@ uint64_t acc_get_used_(uint64_t value_ex);
 
 void add_trusted_account_(uint64_t account);
 void remove_trusted_account_(uint64_t account);
+void get_preload_stats_(vector<uint64_t>& accounts, vector<uint64_t>& applies, vector<uint64_t>& loads, vector<uint64_t>& last_load_us, vector<uint64_t>& max_load_us);
+void get_parallel_stats_(uint64_t& blocks, uint64_t& transactions, uint64_t& conflicts, uint64_t& serial_us, vector<uint32_t>& cores, vector<uint64_t>& makespan_us);
+void reset_parallel_stats_();
 int vm_run_script_(const char* str);
 
 void softfloat_test_();
@@ -0,0 +1,39 @@
+pragma solidity ^0.4.8;
+contract Arith {
+    uint result;
+
+    function Arith() {
+    }
+
+    // the operands are kept full width so that every op runs on all four limbs
+    function mulLoop(uint count) payable public {
+        uint x = uint(keccak256(count));
+        uint acc = x | 1;
+        for (uint i = 0; i < count; i++) {
+            acc = acc * x + i;
+        }
+        result = acc;
+    }
+
+    function expLoop(uint count) payable public {
+        uint x = uint(keccak256(count));
+        uint acc = x;
+        for (uint i = 0; i < count; i++) {
+            acc = (acc + i) ** x;
+        }
+        result = acc;
+    }
+
+    function mulmodLoop(uint count) payable public {
+        uint x = uint(keccak256(count));
+        uint acc = x;
+        for (uint i = 0; i < count; i++) {
+            acc = mulmod(acc, x, x | i | 1);
+        }
+        result = acc;
+    }
+
+    function getResult() payable public returns (uint) {
+        return result;
+    }
+}
@@ -0,0 +1,20 @@
+pragma solidity ^0.4.8;
+contract Storage {
+    mapping (uint => uint) values;
+    uint total;
+
+    function Storage() {
+    }
+
+    // every iteration reads and writes two slots, the same ones again and again
+    function update(uint count, uint slots) payable public {
+        for (uint i = 0; i < count; i++) {
+            values[i % slots] += i;
+            total += i;
+        }
+    }
+
+    function getTotal() payable public returns (uint) {
+        return total;
+    }
+}
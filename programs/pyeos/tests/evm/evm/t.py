@@ -353,6 +353,83 @@ def test3(count=200):
     assert ret
     print('total cost time:%.3f s, cost per action: %.3f ms, actions per second: %.3f'%(cost/1e6, cost/count/1000, 1*1e6/(cost/count)))
 
+def deploy_storage(vmtype=2):
+    return deploy_source('storage.sol', '<stdin>:Storage', vmtype)
+
+def deploy_source(file_name, main_class, vmtype=2):
+    '''
+    vmtype 2 runs the contract on vm_eth2 (EosVM and EosState), vmtype 8 on vm_eth, which runs LegacyVM of libevm4eos
+    and is called through ethtransfer instead of transfer
+    '''
+    src = os.path.join(os.path.dirname(__file__), file_name)
+    with open(src, 'r') as f:
+        contract_interface = compile(f.read(), main_class)
+
+    account = 'evm'
+    actions = []
+    abi_file = os.path.join(os.path.dirname(__file__), 'evm.abi')
+    setabi = eosapi.pack_setabi(abi_file, eosapi.N(account))
+    actions.append(['eosio', 'setabi', setabi, {account:'active'}])
+    args = eosapi.pack_args("eosio", 'setcode', {'account':account,'vmtype':vmtype, 'vmversion':0, 'code':contract_interface['bin']})
+    actions.append(['eosio', 'setcode', args, {account:'active'}])
+    r, cost = eosapi.push_actions(actions)
+    assert not r['except']
+    return contract_interface['abi']
+
+def encode_call(contract_abi, fn_identifier, args):
+    for abi in contract_abi:
+        if 'name' in abi and abi['name'] == fn_identifier:
+            fn_abi = abi
+            break
+    data = web3.utils.contracts.encode_transaction_data(web3, fn_identifier, contract_abi, fn_abi, args, {})
+    return data[2:]
+
+def call_action(vmtype):
+    return 'ethtransfer' if vmtype == 8 else 'transfer'
+
+@init
+def bench_storage(count=100, loops=100, slots=10, vmtype=2):
+    '''
+    storage heavy evm calls: each call runs `loops` iterations that load and store two slots.
+    The default vmtype 2 measures EosState, vmtype 8 the program cache LegacyVM shares with VM. vm_eth meters no gas,
+    so block gas is not exercised by either
+    '''
+    contract_abi = deploy_storage(vmtype)
+    data = encode_call(contract_abi, 'update', (loops, slots))
+
+    action = call_action(vmtype)
+    transactions = []
+    for i in range(count):
+        args = {'from':'eosio', 'to':'evm', 'amount':i, 'data':data}
+        args = eosapi.pack_args('evm', action, args)
+        transactions.append([['evm', action, args, {'eosio':'active'}],])
+    ret, cost = eosapi.push_transactions(transactions)
+    assert ret
+    print('total cost time:%.3f s, cost per call: %.3f ms, storage ops per second: %.3f'%(cost/1e6, cost/count/1000, loops*4*1e6/(cost/count)))
+    eosapi.produce_block()
+
+@init
+def bench_arith(count=100, loops=200):
+    '''
+    arithmetic bound evm calls, each one runs `loops` iterations of MUL, EXP or MULMOD over full width words.
+    MULMOD always runs on cpp_int, build libevm4eos with -DEVM_FIXED_ARITH=0 to get boost numbers for MUL and EXP.
+    The contract is deployed with vmtype 8, vm_eth runs it on LegacyVM whose MUL and EXP use the fixed width kernels
+    '''
+    vmtype = 8
+    contract_abi = deploy_source('arith.sol', '<stdin>:Arith', vmtype)
+    action = call_action(vmtype)
+    for fn_identifier in ('mulLoop', 'expLoop', 'mulmodLoop'):
+        data = encode_call(contract_abi, fn_identifier, (loops,))
+        transactions = []
+        for i in range(count):
+            args = {'from':'eosio', 'to':'evm', 'amount':i, 'data':data}
+            args = eosapi.pack_args('evm', action, args)
+            transactions.append([['evm', action, args, {'eosio':'active'}],])
+        ret, cost = eosapi.push_transactions(transactions)
+        assert ret
+        print('%s: total cost time:%.3f s, cost per call: %.3f ms, ops per second: %.3f'%(fn_identifier, cost/1e6, cost/count/1000, loops*1e6/(cost/count)))
+        eosapi.produce_block()
+
 @init
 def test4():
     main_class = '<stdin>:KittyCore'
@@ -8,4 +8,9 @@ contract Callee {
         myvalue = v;
         return v+1;
     }
+
+    function setValueAndThrow(uint v) public returns(uint) {
+        myvalue = v;
+        throw;
+    }
 }
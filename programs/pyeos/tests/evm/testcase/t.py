@@ -149,8 +149,9 @@ def test_memory():
 def test_memory2():
     call('testMemory2', ())
 
-@init
-def test_call():
+CALLEE_ADDRESS = '0x00000000000000000000000041a3152800000000'
+
+def deploy_callee():
     src_file = 'callee.sol'
     main_class = '<stdin>:Callee'
     account = 'callee'
@@ -165,11 +166,45 @@ def test_call():
     if last_update < modify_time:
         contract_abi, bin = compile(src_file, main_class)
         deploy(account, bin)
-    call('testCall', ('0x00000000000000000000000041a3152800000000', 120))
+
+def get_value(account):
     n = eosapi.N(account)
     itr = rodb.find_i256(n, n, n, 0)
-    assert itr >= 0
-    assert rodb.get_i256(itr) == 120
+    if itr < 0:
+        return 0
+    return rodb.get_i256(itr)
+
+@init
+def test_call():
+    deploy_callee()
+    call('testCall', (CALLEE_ADDRESS, 120))
+    assert get_value('callee') == 120
+
+@init
+def test_call_revert():
+    '''
+    testCallThrow stores a value, then calls the callee, which stores it too and throws.
+    Old result: the callee's SSTORE went straight to the database and was kept when its frame reverted.
+    The exception still reached the top and failed the action, so the database was rolled back with it.
+    New result: revert() rolls the callee's SSTORE back from the storage cache, then the action fails the
+    same way. Either way both slots keep their previous values.
+    '''
+    deploy_callee()
+    call('testSetValue', (1,))
+    call('testCall', (CALLEE_ADDRESS, 2))
+
+    data = generate_call_params('testCallThrow', (CALLEE_ADDRESS, 3))
+    args = {'from':'eosio', 'to':'evm', 'amount':0, 'data':data}
+    failed = False
+    try:
+        eosapi.push_action('evm', 'transfer', args, {'eosio':'active'})
+    except Exception as e:
+        print(e)
+        failed = True
+    assert failed, 'a throwing sub-call should fail the action'
+
+    assert get_value('evm') == 1
+    assert get_value('callee') == 2
 
 @init
 def test_suicide():
@@ -236,6 +271,9 @@ class EVMTestCase(unittest.TestCase):
     def test_call(self):
         test_call()
 
+    def test_call_revert(self):
+        test_call_revert()
+
     def test_suicide(self):
         test_suicide()
 
@@ -1,6 +1,7 @@
 pragma solidity ^0.4.8;
 contract Callee {
     function setValue(uint) public returns (uint) {}
+    function setValueAndThrow(uint) public returns (uint) {}
 }
 
 contract Tester {
@@ -43,6 +44,11 @@ contract Tester {
         return Callee(a).setValue(v);
     }
 
+    function testCallThrow(address a, uint v) public returns (uint) {
+        myvalue = v;
+        return Callee(a).setValueAndThrow(v);
+    }
+
     function testSuicide() public {
        if (owner == msg.sender) { // We check who is calling
           selfdestruct(owner); //Destruct the contract
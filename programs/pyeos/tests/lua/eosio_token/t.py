@@ -72,3 +72,18 @@ def test2(count=100):
 
     print('total cost time:%.3f s, cost per action: %.3f ms, actions per second: %.3f'%(cost/1e6, cost/count/1000, 1*1e6/(cost/count)))
 
+@init
+def bench(count=200, rounds=5):
+    '''
+    apply latency of transfers, the first round after a restart or setcode includes loading the contract into a sandbox
+    '''
+    _from = 'eosio'
+    _to = 'hello'
+    for r in range(rounds):
+        actions = []
+        for i in range(count):
+            action = ['tokentest','transfer',{"from":_from, "to":_to, "quantity":"0.0010 EOS", "memo":'%d-%d'%(r, i)},{_from:'active'}]
+            actions.append(action)
+        ret, cost = eosapi.push_actions(actions)
+        assert not ret['except']
+        print('round %d: cost per action: %.3f ms, actions per second: %.3f'%(r, cost/count/1000, 1*1e6/(cost/count)))
@@ -115,3 +115,39 @@ def apply(receiver, code, action):
             print(e)
         sl.append(msg)
         sl[0] = msg
+    elif action == N('fill'):
+        count = int(read_action())
+        table = N('rows')
+        for i in range(count):
+            if db.find_i64(code, code, table, i) < 0:
+                db.store_i64(code, table, code, i, bytes([i & 0xff]) * 64)
+                db.db_idx64_store(code, N('rowsidx'), code, i, count - i)
+    elif action == N('scan'):
+        total = 0
+        itr = db.lowerbound_i64(code, code, N('rows'), 0)
+        while itr >= 0:
+            total += db.get_i64(itr)[0]
+            itr, primary = db.next_i64(itr)
+        print('scan:', total)
+    elif action == N('scanview'):
+        total = 0
+        for primary, row in db.rows_i64(code, code, N('rows')):
+            total += memoryview(row)[0]
+        print('scanview:', total)
+    elif action == N('idxscan'):
+        # secondary range and the rows it points to, two calls whatever the size of the range
+        entries = db.db_idx64_range(code, code, N('rowsidx'), 0, 0xffffffffffffffff, 1000)
+        rows = db.get_i64_many(code, code, N('rows'), [primary for secondary, primary in entries])
+        total = 0
+        for row in rows:
+            total += row[0]
+        print('idxscan:', len(entries), total)
+    elif action == N('iterate'):
+        # find every row then walk the table, mostly iterator cache and table lookups
+        table = N('rows')
+        count = db.get_table_item_count(code, code, table)
+        for i in range(count):
+            db.find_i64(code, code, table, i)
+        itr = db.lowerbound_i64(code, code, table, 0)
+        while itr >= 0:
+            itr, primary = db.next_i64(itr)
@@ -50,3 +50,25 @@ def debug(msg='hello,world\n'):
     r = eosapi.push_action('db', 'sayhello', msg, {'db':'active'})
     assert r
 
+@init()
+def bench_scan(count=500, rounds=20):
+    r = eosapi.push_action('db', 'fill', str(count), {'db':'active'})
+    assert r
+    for action in ('scan', 'scanview', 'idxscan'):
+        actions = []
+        for i in range(rounds):
+            actions.append(['db', action, str(i), {'db':'active'}])
+        ret, cost = eosapi.push_actions(actions, True)
+        assert ret
+        print('%s: %d rows, cost per action: %.3f ms'%(action, count, cost/rounds/1000))
+
+@init()
+def bench_iterate(count=1000, rounds=20):
+    r = eosapi.push_action('db', 'fill', str(count), {'db':'active'})
+    assert r
+    actions = []
+    for i in range(rounds):
+        actions.append(['db', 'iterate', str(i), {'db':'active'}])
+    ret, cost = eosapi.push_actions(actions, True)
+    assert ret
+    print('iterate: %d rows, cost per db call: %.3f us'%(count, cost/rounds/(count*2)))
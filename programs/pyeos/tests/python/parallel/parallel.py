@@ -0,0 +1,17 @@
+from eoslib import *
+
+def inc(code):
+    # bumps a counter in the scope given by the action, transactions with different scopes don't conflict
+    scope = int.from_bytes(read_action()[:8], 'little')
+    table = N('counter')
+    id = N('count')
+    itr = db_find_i64(code, scope, table, id)
+    if itr >= 0:
+        count = int.from_bytes(db_get_i64(itr), 'little') + 1
+        db_update_i64(itr, code, int.to_bytes(count, 8, 'little'))
+    else:
+        db_store_i64(scope, table, code, id, int.to_bytes(1, 8, 'little'))
+
+def apply(receiver, code, action):
+    if action == N('inc'):
+        inc(code)
@@ -0,0 +1,39 @@
+import random
+import debug
+import eosapi
+import initeos
+from eosapi import N
+
+from common import prepare, producer
+
+def init(func):
+    def func_wrapper(*args, **kwargs):
+        prepare('parallel', 'parallel.py', 'parallel.abi', __file__)
+        return func(*args, **kwargs)
+    return func_wrapper
+
+def report():
+    blocks, transactions, conflicts, serial_us, makespan = debug.get_parallel_stats()
+    print('blocks: %d, transactions: %d, conflicting: %d, serial: %.3f ms'%(blocks, transactions, conflicts, serial_us/1000))
+    for cores in sorted(makespan):
+        us = makespan[cores]
+        print('%2d cores: %.3f ms, speedup %.2f'%(cores, us/1000, serial_us/us if us else 0))
+
+@init
+def bench(count=1000, conflict=0.0, blocks=5):
+    '''
+    pushes transactions bumping counters of `count` different scopes, `conflict` of them share one scope.
+    The node executes them serially, the makespans reported are simulated from their footprints.
+    The node has to run with --parallel-stats.
+    To measure a replay, run this on a fresh node, restart it with --replay-blockchain and call report()
+    '''
+    debug.reset_parallel_stats()
+    for b in range(blocks):
+        trxs = []
+        for i in range(count):
+            scope = N('shared') if random.random() < conflict else b*count + i + 1
+            act = ['parallel', 'inc', int.to_bytes(scope, 8, 'little'), {'parallel':'active'}]
+            trxs.append([act])
+        r, cost = eosapi.push_transactions(trxs, True)
+        eosapi.produce_block()
+    report()
@@ -30,8 +30,22 @@ def test():
     else:
         print('not found!')
 
+def bench(code):
+    # writes `count` rows and reads each one back, the pattern a batched ipc client has to serve from its overlay
+    count = int.from_bytes(read_action()[:4], 'little')
+    table = N('bench')
+    for id in range(count):
+        itr = db_find_i64(code, code, table, id)
+        if itr >= 0:
+            db_update_i64(itr, code, db_get_i64(itr))
+        else:
+            itr = db_store_i64(code, table, code, id, b'%d'%(id,))
+        db_get_i64(itr)
+
 def apply(receiver, code, action):
-    if action == N('sayhello'):
+    if action == N('bench'):
+        bench(code)
+    elif action == N('sayhello'):
         msg = read_action()
         key = N('hellooo')
 
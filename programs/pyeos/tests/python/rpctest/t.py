@@ -34,3 +34,20 @@ def test2(count):
     eosapi.produce_block()
 
 
+
+@init
+def bench(count=100, rows=100):
+    '''
+    rows written per second by a contract running in an ipc client, start the node with
+    --use-ipc --ipc-write-batch on, then again with --ipc-write-batch off to compare
+    '''
+    actions = []
+    for i in range(count):
+        action = ['rpctest', 'bench', int.to_bytes(rows, 4, 'little'), {'rpctest':'active'}]
+        actions.append(action)
+
+    ret, cost = eosapi.push_actions(actions, True)
+    assert ret
+    print('ipc-write-batch: %s'%(eosapi.get_opt('ipc-write-batch'),))
+    print('total cost time:%.3f s, cost per action: %.3f ms, rows per second per action: %.3f'%(cost/1e6, cost/count/1000, rows*1e6/(cost/count)))
+    eosapi.produce_block()
@@ -0,0 +1,22 @@
+'''Compares the WASM linear memory reset modes on eosio.token transfers.
+
+Start pyeos once with --wasm-memory-reset copy and once with --wasm-memory-reset cow,
+then run test(count) in both sessions and compare the per action cost.
+'''
+import eosapi
+
+def test(count=1000):
+    _from = 'eosio'
+    _to = 'hello'
+    mode = eosapi.get_opt('wasm-memory-reset') or 'cow'
+
+    actions = []
+    for i in range(count):
+        action = ['eosio.token','transfer',{"from":_from, "to":_to, "quantity":"0.0001 EOS", "memo":str(i)},{_from:'active'}]
+        actions.append(action)
+
+    ret, cost = eosapi.push_actions(actions)
+    assert ret and not ret['except']
+
+    print('memory reset mode: %s'%(mode,))
+    print('total cost time:%.3f s, cost per action: %.3f ms, actions per second: %.3f'%(cost/1e6, cost/count/1000, 1*1e6/(cost/count)))
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+import os
+import socket
+import struct
+import threading
+import time
+import urllib.request
+
+###############################################################
+# p2p_fanout_bench
+#  Benchmark of the block relay fan-out of net_plugin. Connects a number of simulated peers to the p2p port
+#  of a producing node over loopback, each claiming to be in sync with it, and records when every peer has
+#  received each new block. Reports how long the node takes from the first to the last peer per block and,
+#  given its pid, the cpu time it spent over the run.
+#  The node has to accept that many connections from one host, e.g.
+#  nodeos -e -p eosio --p2p-max-nodes-per-host 100 --max-clients 0 ...
+#  p2p_fanout_bench.py --pid $(pidof nodeos) --peers 10,50,100 --seconds 20
+###############################################################
+
+NET_VERSION = 0x04b5 + 1
+SIGNED_BLOCK = 7
+
+def varint(v):
+    out = b""
+    while True:
+        b = v & 0x7f
+        v >>= 7
+        out += bytes([b | (0x80 if v else 0)])
+        if not v:
+            return out
+
+def string(s):
+    return varint(len(s)) + s.encode()
+
+def get_info(url):
+    req = urllib.request.Request(url + "/v1/chain/get_info", data=b"{}")
+    with urllib.request.urlopen(req, timeout=10) as resp:
+        return json.loads(resp.read().decode())
+
+def handshake(info, i):
+    body = struct.pack("<H", NET_VERSION)
+    body += bytes.fromhex(info["chain_id"])
+    body += os.urandom(32)                           # node_id
+    body += varint(0) + bytes(33)                    # no key
+    body += struct.pack("<q", int(time.time() * 1e9))
+    body += bytes(32)                                # token
+    body += varint(0) + bytes(65)                    # no signature
+    body += string("fanout-peer-%d:0" % i)
+    body += struct.pack("<I", info["last_irreversible_block_num"]) + bytes.fromhex(info["last_irreversible_block_id"])
+    body += struct.pack("<I", info["head_block_num"]) + bytes.fromhex(info["head_block_id"])
+    body += string("bench") + string("p2p_fanout_bench")
+    body += struct.pack("<h", 1)
+    msg = varint(0) + body
+    return struct.pack("<I", len(msg)) + msg
+
+def recv_exact(sock, n):
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise EOFError()
+        buf += chunk
+    return buf
+
+class Peer:
+    def __init__(self, args, info, i, received, lock, stop):
+        self.sock = socket.create_connection((args.host, args.port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.sock.sendall(handshake(info, i))
+        self.received = received
+        self.lock = lock
+        self.stop = stop
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def run(self):
+        try:
+            while not self.stop.is_set():
+                size = struct.unpack("<I", recv_exact(self.sock, 4))[0]
+                msg = recv_exact(self.sock, size)
+                now = time.time()
+                if msg[0] != SIGNED_BLOCK:
+                    continue
+                # header: timestamp, producer, confirmed, then the id of the previous block whose first 4 bytes
+                # hold its number big endian
+                block_num = struct.unpack(">I", bytes(msg[1 + 14:1 + 18]))[0] + 1
+                with self.lock:
+                    self.received.setdefault(block_num, []).append(now)
+        except (EOFError, OSError):
+            pass
+
+    def close(self):
+        try:
+            self.sock.shutdown(socket.SHUT_RDWR)
+        except OSError:
+            pass
+        self.sock.close()
+
+def cpu_seconds(pid):
+    if not pid:
+        return 0.0
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+def run(args, peers):
+    info = get_info(args.url)
+    received = {}
+    lock = threading.Lock()
+    stop = threading.Event()
+    conns = [Peer(args, info, i, received, lock, stop) for i in range(peers)]
+
+    time.sleep(1)    # let the handshakes settle
+    with lock:
+        received.clear()
+    cpu_start = cpu_seconds(args.pid)
+    time.sleep(args.seconds)
+    cpu = cpu_seconds(args.pid) - cpu_start
+
+    stop.set()
+    for c in conns:
+        c.close()
+    for c in conns:
+        c.thread.join()
+
+    spreads = sorted((max(t) - min(t)) * 1000 for t in received.values() if len(t) == peers)
+    p50 = spreads[len(spreads) // 2] if spreads else 0
+    p99 = spreads[min(len(spreads) - 1, int(len(spreads) * 0.99))] if spreads else 0
+    print("%8d %8d %12.2f %12.2f %10.2f" % (peers, len(spreads), p50, p99, cpu))
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--url", default="http://127.0.0.1:8888")
+parser.add_argument("--host", default="127.0.0.1")
+parser.add_argument("--port", type=int, default=9876)
+parser.add_argument("--pid", type=int, default=0, help="pid of the node, to report its cpu time")
+parser.add_argument("--peers", default="10,50", help="comma separated numbers of simulated peers")
+parser.add_argument("--seconds", type=int, default=10)
+args = parser.parse_args()
+
+print("%8s %8s %12s %12s %10s" % ("peers", "blocks", "spread p50ms", "spread p99ms", "node cpu s"))
+for p in args.peers.split(","):
+    run(args, int(p))
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+
+import argparse
+import json
+import threading
+import time
+import urllib.request
+from datetime import datetime
+
+###############################################################
+# read_only_load
+#  Load harness for the read only api threads of chain_plugin. Fires get_table_rows calls from a number of
+#  client threads at a running node and samples how far its head block falls behind the wall clock.
+#  Run it once against a node started with --read-only-threads 0 and once with some threads, e.g.
+#  read_only_load.py --url http://127.0.0.1:8888 --clients 1,8,32 --seconds 20
+###############################################################
+
+def post(url, path, body):
+    req = urllib.request.Request(url + path, data=json.dumps(body).encode(), headers={"Content-Type": "application/json"})
+    with urllib.request.urlopen(req, timeout=10) as resp:
+        return json.loads(resp.read().decode())
+
+def head_lag_ms(url):
+    info = post(url, "/v1/chain/get_info", {})
+    head = datetime.strptime(info["head_block_time"], "%Y-%m-%dT%H:%M:%S.%f")
+    return (datetime.utcnow() - head).total_seconds() * 1000, info["head_block_num"]
+
+def run(args, clients):
+    stop = threading.Event()
+    counts = [0] * clients
+    errors = [0] * clients
+    query = {"code": args.code, "scope": args.scope, "table": args.table, "json": True, "limit": args.limit}
+
+    def reader(i):
+        while not stop.is_set():
+            try:
+                post(args.url, "/v1/chain/get_table_rows", query)
+                counts[i] += 1
+            except Exception:
+                errors[i] += 1
+
+    threads = [threading.Thread(target=reader, args=(i,)) for i in range(clients)]
+    for t in threads:
+        t.start()
+
+    lags = []
+    start = time.time()
+    _, first_block = head_lag_ms(args.url)
+    last_block = first_block
+    while time.time() - start < args.seconds:
+        time.sleep(0.5)
+        lag, last_block = head_lag_ms(args.url)
+        lags.append(lag)
+    stop.set()
+    for t in threads:
+        t.join()
+    elapsed = time.time() - start
+
+    lags.sort()
+    p50 = lags[len(lags) // 2] if lags else 0
+    p99 = lags[min(len(lags) - 1, int(len(lags) * 0.99))] if lags else 0
+    print("%8d %12.1f %8d %10.1f %10.1f %8d" % (clients, sum(counts) / elapsed, sum(errors), p50, p99, last_block - first_block))
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--url", default="http://127.0.0.1:8888")
+parser.add_argument("--clients", default="1,4,16", help="comma separated numbers of concurrent clients")
+parser.add_argument("--seconds", type=int, default=10)
+parser.add_argument("--code", default="eosio")
+parser.add_argument("--scope", default="eosio")
+parser.add_argument("--table", default="producers")
+parser.add_argument("--limit", type=int, default=100)
+args = parser.parse_args()
+
+print("%8s %12s %8s %10s %10s %8s" % ("clients", "reads/s", "errors", "lag p50ms", "lag p99ms", "blocks"))
+for c in args.clients.split(","):
+    run(args, int(c))
@@ -0,0 +1,193 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <VMArith.h>
+#include <VMFactory.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace dev;
+using namespace dev::eth;
+using boost::multiprecision::cpp_int;
+
+namespace {
+
+const cpp_int modulus = cpp_int(1) << 256;
+
+u256 reference_mul( const u256& a, const u256& b ) {
+   return u256( (cpp_int(a) * cpp_int(b)) % modulus );
+}
+
+u256 reference_exp( const u256& base, const u256& exponent ) {
+   return u256( boost::multiprecision::powm(cpp_int(base), cpp_int(exponent), modulus) );
+}
+
+u256 random_word( boost::random::mt19937_64& gen ) {
+   // mostly full words, with runs of zero and all-ones limbs mixed in
+   boost::random::uniform_int_distribution<uint64_t> limb;
+   boost::random::uniform_int_distribution<int> kind(0, 7);
+   arith::Limbs l;
+   for( auto& v : l ) {
+      switch( kind(gen) ) {
+         case 0:  v = 0; break;
+         case 1:  v = ~uint64_t(0); break;
+         case 2:  v = limb(gen) & 0xff; break;
+         default: v = limb(gen);
+      }
+   }
+   return arith::fromLimbs(l);
+}
+
+std::vector<u256> edge_words() {
+   const u256 ones = ~u256(0);
+   std::vector<u256> words = { 0, 1, 2, 3, u256(1) << 255, ones, ones - 1, u256(1) << 64, u256(1) << 128, u256(1) << 192,
+                              (u256(1) << 64) - 1, (u256(1) << 128) - 1, (u256(1) << 192) - 1, ones >> 1 };
+   return words;
+}
+
+/// exponents whose low limbs are all zero
+std::vector<u256> high_limb_exponents() {
+   std::vector<u256> exponents;
+   for( unsigned shift : {64u, 128u, 192u, 255u} ) {
+      exponents.push_back( u256(1) << shift );
+      exponents.push_back( u256(3) << (shift == 255 ? 254 : shift) );
+   }
+   exponents.push_back( ~u256(0) << 192 );
+   exponents.push_back( ~u256(0) << 64 );
+   return exponents;
+}
+
+class null_ext : public ExtVMFace {
+   public:
+      null_ext( EnvInfo const& env, bytes code )
+      :ExtVMFace( env, Address(), Address(), Address(), 0, 0, bytesConstRef(), std::move(code), h256(), 0, false, false ) {}
+
+      CreateResult create( u256, u256&, bytesConstRef, Instruction, u256, OnOpFunc const& ) override {
+         BOOST_FAIL( "unexpected create" );
+         return CreateResult( EVMC_FAILURE, owning_bytes_ref(), h160() );
+      }
+      CallResult call( CallParameters& ) override {
+         BOOST_FAIL( "unexpected call" );
+         return CallResult( EVMC_FAILURE, owning_bytes_ref() );
+      }
+      h256 blockHash( u256 ) override { return h256(); }
+};
+
+/// runs `op(a, b)` on the vm vm_eth creates and returns the word it leaves on the stack
+u256 run_op( Instruction op, const u256& a, const u256& b ) {
+   bytes code;
+   for( const u256& v : {b, a} ) {
+      code.push_back( (byte)Instruction::PUSH32 );
+      const bytes word = toBigEndian(v);
+      code.insert( code.end(), word.begin(), word.end() );
+   }
+   code.push_back( (byte)op );
+   for( byte c : {(byte)Instruction::PUSH1, byte(0), (byte)Instruction::MSTORE,
+                  (byte)Instruction::PUSH1, byte(32), (byte)Instruction::PUSH1, byte(0), (byte)Instruction::RETURN} ) {
+      code.push_back( c );
+   }
+
+   EnvInfo env;
+   null_ext ext( env, std::move(code) );
+   u256 gas = 1000000;
+   auto out = VMFactory::create()->exec( gas, ext, OnOpFunc() );
+   return fromBigEndian<u256>( out );
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(evm_arith_tests)
+
+BOOST_AUTO_TEST_CASE(mul_edges) {
+   for( const char* k : arith::supportedKernels() ) {
+      BOOST_TEST_CONTEXT("kernels " << k) {
+         for( const auto& a : edge_words() ) {
+            for( const auto& b : edge_words() ) {
+               BOOST_REQUIRE( arith::mul(a, b, k) == reference_mul(a, b) );
+            }
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(mul_random) {
+   boost::random::mt19937_64 gen(1);
+   for( const char* k : arith::supportedKernels() ) {
+      BOOST_TEST_CONTEXT("kernels " << k) {
+         for( int i = 0; i < 20000; i++ ) {
+            const u256 a = random_word(gen);
+            const u256 b = random_word(gen);
+            BOOST_REQUIRE( arith::mul(a, b, k) == reference_mul(a, b) );
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(exp_edges) {
+   auto exponents = edge_words();
+   auto high = high_limb_exponents();
+   exponents.insert( exponents.end(), high.begin(), high.end() );
+
+   for( const char* k : arith::supportedKernels() ) {
+      BOOST_TEST_CONTEXT("kernels " << k) {
+         for( const auto& base : edge_words() ) {
+            for( const auto& e : exponents ) {
+               BOOST_REQUIRE( arith::exp(base, e, k) == reference_exp(base, e) );
+            }
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(exp_random) {
+   boost::random::mt19937_64 gen(2);
+   const auto high = high_limb_exponents();
+   for( const char* k : arith::supportedKernels() ) {
+      BOOST_TEST_CONTEXT("kernels " << k) {
+         for( int i = 0; i < 2000; i++ ) {
+            const u256 base = random_word(gen);
+            const u256 e = i % 4 == 0 ? high[i / 4 % high.size()] : random_word(gen);
+            BOOST_REQUIRE( arith::exp(base, e, k) == reference_exp(base, e) );
+         }
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE(selected_kernels) {
+   // the kernels the vm uses are one of the tested ones and agree with them
+   const auto names = arith::supportedKernels();
+   BOOST_REQUIRE( std::find_if(names.begin(), names.end(), [](const char* n) { return !strcmp(n, arith::kernels()); }) != names.end() );
+
+   boost::random::mt19937_64 gen(3);
+   for( int i = 0; i < 1000; i++ ) {
+      const u256 a = random_word(gen);
+      const u256 b = random_word(gen);
+      BOOST_REQUIRE( arith::mul(a, b) == reference_mul(a, b) );
+      BOOST_REQUIRE( arith::exp(a, b) == reference_exp(a, b) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(vm_eth_interpreter) {
+   // MUL and EXP as vm_eth runs them, through the vm VMFactory hands out
+   boost::random::mt19937_64 gen(4);
+   for( const auto& a : edge_words() ) {
+      for( const auto& b : edge_words() ) {
+         BOOST_REQUIRE( run_op(Instruction::MUL, a, b) == reference_mul(a, b) );
+         BOOST_REQUIRE( run_op(Instruction::EXP, a, b) == reference_exp(a, b) );
+      }
+   }
+   for( int i = 0; i < 200; i++ ) {
+      const u256 a = random_word(gen);
+      const u256 b = random_word(gen);
+      BOOST_REQUIRE( run_op(Instruction::MUL, a, b) == reference_mul(a, b) );
+      BOOST_REQUIRE( run_op(Instruction::EXP, a, b) == reference_exp(a, b) );
+   }
+}
+
+BOOST_AUTO_TEST_SUITE_END()